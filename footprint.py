@@ -0,0 +1,217 @@
+#!/usr/bin/env python3
+"""Flash and RAM footprint of every firmware in a QMK build directory, and
+the host timings of the hot path benchmarks in test/.
+
+For each tmp_*.elf the compile targets leave behind, the report holds the
+firmware's text, data and bss, and the same for every object built from
+the keyboard directory, so a feature's cost shows up under its own file.
+Everything else is summed as core:
+
+    python3 footprint.py src/qmk/qmk_firmware/.build test > before.json
+    python3 footprint.py src/qmk/qmk_firmware/.build test > after.json
+    python3 footprint.py --compare before.json after.json 10 25
+
+Objects of an LTO build hold compiler IR, not code, so their sizes say
+nothing. For those firmwares, such as the lskbd Vial builds, each object
+is sized by the symbols of the ELF it defines instead, and the report
+marks them. Code inlined across files counts where it was inlined.
+
+With the test directory given, its benchmarks are run a few times with
+TEST_BENCH set and the fastest time of each is kept, in ns.
+
+The comparison lists what changed and fails when a firmware's flash
+(text + data) or RAM (data + bss) grew by more than the first percent, or
+a benchmark got slower by more than the second, 25 if not given.
+"""
+
+import glob
+import json
+import os
+import subprocess
+import sys
+
+# ELF e_machine values
+SIZE_TOOLS = {0x28: 'arm-none-eabi-size', 0x53: 'avr-size'}
+
+# nm symbol types, by the part of the image they take
+SYMBOL_SECTIONS = {'t': 'text', 'r': 'text', 'd': 'data', 'b': 'bss'}
+
+BENCH_RUNS = 3
+
+
+def size_tool(elf):
+    if 'SIZE' in os.environ:
+        return os.environ['SIZE']
+    with open(elf, 'rb') as f:
+        header = f.read(20)
+    machine = int.from_bytes(header[18:20], 'little')
+    if machine not in SIZE_TOOLS:
+        sys.exit(f'{elf}: unknown machine 0x{machine:x}')
+    return SIZE_TOOLS[machine]
+
+
+def sizes(tool, files):
+    out = subprocess.run([tool, '-B'] + files, check=True, capture_output=True, text=True).stdout
+    result = {}
+    for line in out.splitlines()[1:]:
+        text, data, bss, _, _, name = line.split(None, 5)
+        result[name] = {'text': int(text), 'data': int(data), 'bss': int(bss)}
+    return result
+
+
+def is_lto(path):
+    with open(path, 'rb') as f:
+        return b'.gnu.lto_' in f.read()
+
+
+# Name, type and size of each defined symbol, with the source file of
+# those the debug info places
+def symbols(nm, path, sized):
+    args = [nm, '--defined-only'] + (['-S', '-l'] if sized else []) + [path]
+    out = subprocess.run(args, check=True, capture_output=True, text=True).stdout
+    result = []
+    for line in out.splitlines():
+        symbol, _, source = line.partition('\t')
+        fields = symbol.split()
+        source = source.rpartition(':')[0]
+        if sized and len(fields) == 4:
+            result.append((fields[3], fields[2].lower(), int(fields[1], 16), source))
+        elif not sized and len(fields) == 3:
+            result.append((fields[2], fields[1].lower(), 0, source))
+    return result
+
+
+# Sizes of the ELF symbols each object defines: by the source file the
+# debug info gives, else by the names the object exports. LTO renames
+# what it keeps static or clones, foo.lto_priv.0 or foo.constprop.0,
+# after the source name. Static data has neither and counts as core.
+def lto_sizes(tool, elf, keyboard, files):
+    prefix = tool[:-len('size')]
+    nm = os.environ.get('NM', prefix + 'nm')
+    gcc_nm = os.environ.get('GCC_NM', prefix + 'gcc-nm')
+    owner = {}
+    sources = {}
+    result = {}
+    for path in files:
+        result[path] = {'text': 0, 'data': 0, 'bss': 0}
+        sources[os.path.relpath(path, keyboard)[:-len('.o')] + '.c'] = path
+        for name, _, _, _ in symbols(gcc_nm, path, False):
+            owner.setdefault(name, path)
+    for name, kind, size, source in symbols(nm, elf, True):
+        path = next((sources[rel] for rel in sources if source == rel or source.endswith('/' + rel)), None)
+        path = path or owner.get(name.split('.')[0])
+        if path is not None and kind in SYMBOL_SECTIONS:
+            result[path][SYMBOL_SECTIONS[kind]] += size
+    return result
+
+
+def measure(build):
+    report = {}
+    for elf in sorted(glob.glob(os.path.join(build, 'tmp_*.elf'))):
+        target = os.path.basename(elf)[len('tmp_'):-len('.elf')]
+        tool = size_tool(elf)
+        total = sizes(tool, [elf])[elf]
+
+        objects = {}
+        keyboard = os.path.join(build, f'obj_tmp_{target}', 'keyboards', 'tmp')
+        files = sorted(glob.glob(os.path.join(keyboard, '**', '*.o'), recursive=True))
+        lto = any(is_lto(path) for path in files)
+        if lto:
+            print(f'{target}: LTO build, objects sized by the ELF symbols they define', file=sys.stderr)
+        if files:
+            for path, size in (lto_sizes(tool, elf, keyboard, files) if lto else sizes(tool, files)).items():
+                objects[os.path.relpath(path, keyboard)[:-len('.o')]] = size
+        # Object sizes are from before the linker drops unused sections, so
+        # core, what the objects do not cover, is a lower bound
+        objects['core'] = {key: max(0, total[key] - sum(o[key] for o in objects.values())) for key in total}
+        report[target] = {'total': total, 'objects': objects, 'lto': lto}
+    return report
+
+
+def benchmarks(tests):
+    env = dict(os.environ, TEST_BENCH='1')
+    result = {}
+    for _ in range(BENCH_RUNS):
+        run = subprocess.run(['make', '-s', '-C', tests], env=env, capture_output=True, text=True)
+        if run.returncode != 0:
+            sys.exit(f'{tests}: tests failed\n{run.stdout}{run.stderr}')
+        for line in run.stdout.splitlines():
+            if line.startswith('bench '):
+                _, name, ns = line.split()
+                result[name] = min(result.get(name, float('inf')), float(ns))
+    return result
+
+
+def flash(size):
+    return size['text'] + size['data']
+
+
+def ram(size):
+    return size['data'] + size['bss']
+
+
+def compare(before_path, after_path, limit, bench_limit):
+    with open(before_path, encoding='utf-8') as f:
+        before_report = json.load(f)
+    with open(after_path, encoding='utf-8') as f:
+        after_report = json.load(f)
+    before, after = before_report['firmware'], after_report['firmware']
+
+    failed = False
+    for target in sorted(set(before) | set(after)):
+        if target not in before or target not in after:
+            print(f'{target}: only in {before_path if target in before else after_path}')
+            continue
+        old, new = before[target], after[target]
+        if old.get('lto') or new.get('lto'):
+            print(f'{target}: LTO build, objects sized by the ELF symbols they define')
+        for name, measure_of in (('flash', flash), ('ram', ram)):
+            a, b = measure_of(old['total']), measure_of(new['total'])
+            growth = (b - a) * 100 / a if a else 0
+            mark = ''
+            if growth > limit:
+                mark = f'  over {limit}%'
+                failed = True
+            if a != b:
+                print(f'{target}: {name} {a} -> {b} ({growth:+.1f}%){mark}')
+        for obj in sorted(set(old['objects']) | set(new['objects'])):
+            a = old['objects'].get(obj, {'text': 0, 'data': 0, 'bss': 0})
+            b = new['objects'].get(obj, {'text': 0, 'data': 0, 'bss': 0})
+            if a != b:
+                print(f'    {obj}: flash {flash(b) - flash(a):+d}, ram {ram(b) - ram(a):+d}')
+
+    before, after = before_report.get('bench', {}), after_report.get('bench', {})
+    for name in sorted(set(before) | set(after)):
+        if name not in before or name not in after:
+            print(f'bench {name}: only in {before_path if name in before else after_path}')
+            continue
+        a, b = before[name], after[name]
+        growth = (b - a) * 100 / a if a else 0
+        mark = ''
+        if growth > bench_limit:
+            mark = f'  over {bench_limit}%'
+            failed = True
+        print(f'bench {name}: {a:.2f} -> {b:.2f} ns ({growth:+.1f}%){mark}')
+    return failed
+
+
+def main():
+    if len(sys.argv) in (5, 6) and sys.argv[1] == '--compare':
+        bench_limit = float(sys.argv[5]) if len(sys.argv) == 6 else 25
+        sys.exit(1 if compare(sys.argv[2], sys.argv[3], float(sys.argv[4]), bench_limit) else 0)
+    if len(sys.argv) not in (2, 3):
+        sys.exit(f'usage: {sys.argv[0]} build_dir [test_dir]\n'
+                 f'       {sys.argv[0]} --compare before.json after.json percent [bench_percent]')
+
+    firmware = measure(sys.argv[1])
+    if not firmware:
+        sys.exit(f'no firmware in {sys.argv[1]}')
+    report = {'firmware': firmware}
+    if len(sys.argv) == 3:
+        report['bench'] = benchmarks(sys.argv[2])
+    json.dump(report, sys.stdout, indent=2, sort_keys=True)
+    print()
+
+
+if __name__ == '__main__':
+    main()
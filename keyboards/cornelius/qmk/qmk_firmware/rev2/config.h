@@ -1 +1,9 @@
 #define DYNAMIC_KEYMAP_LAYER_COUNT 6
+
+// Print the time taken by every 1000 matrix scans on the console
+// #define MATRIX_BANK_STATS
+
+// Settle profile version, clock and one wait per row, see matrix.c
+#ifdef MATRIX_SETTLE
+#    define EECONFIG_KB_DATA_SIZE 8
+#endif
@@ -0,0 +1,303 @@
+#include "quantum.h"
+#include "matrix.h"
+#include "atomic_util.h"
+#include "eeconfig.h"
+#include "matrix_bank.h"
+#ifdef MATRIX_SETTLE
+#    include "hardware/clocks.h"
+#endif
+
+// Each row is driven low and all columns are read with one GPIO bank
+// read, then moved to their columns by the tables matrix_bank.py builds
+// from info.json. Instead of waiting MATRIX_IO_DELAY after every row, a
+// row only waits when it had a key down, and only until the columns read
+// high again.
+//
+// With MATRIX_SETTLE the wait after selecting a row is a number of bank
+// reads measured for each row of this board. Until a profile is stored
+// every row waits MATRIX_SETTLE_MAX reads, and any row read with keys
+// down is sampled again at shorter waits. A row is done once its
+// shortest wait that read the same as the long one has done so
+// MATRIX_SETTLE_PASSES times. Only a row with a key down can be sampled,
+// so the profile is saved once every row is done, and until then every
+// row keeps waiting as it did. MATRIX_SETTLE_MARGIN_US is added to each
+// measured wait, in reads timed at startup.
+//
+// A read takes a fixed number of CPU cycles, so the profile is stored with
+// the clk_sys it was measured at and a different clock starts a new
+// calibration, as does clearing EEPROM. With MATRIX_SETTLE_REPORT the
+// profile and the calibration are reported on the console.
+
+#ifndef MATRIX_IO_DELAY
+#    define MATRIX_IO_DELAY 30
+#endif
+
+#ifndef MATRIX_SETTLE_MAX
+#    define MATRIX_SETTLE_MAX 64
+#endif
+#ifndef MATRIX_SETTLE_SAMPLES
+#    define MATRIX_SETTLE_SAMPLES 8
+#endif
+#ifndef MATRIX_SETTLE_PASSES
+#    define MATRIX_SETTLE_PASSES 32
+#endif
+// Added to the measured wait
+#ifndef MATRIX_SETTLE_MARGIN_US
+#    define MATRIX_SETTLE_MARGIN_US 1
+#endif
+#define MATRIX_SETTLE_VERSION 2
+
+// Copied to SRAM at boot with the RP2040 time critical code, so every scan
+// runs without XIP cache misses
+#ifdef MATRIX_BANK_SRAM
+#    define MATRIX_BANK_HOT __attribute__((noinline, section(".time_critical.matrix_bank")))
+#else
+#    define MATRIX_BANK_HOT
+#endif
+
+static const pin_t row_pins[MATRIX_ROWS] = MATRIX_ROW_PINS;
+static const pin_t col_pins[MATRIX_COLS] = MATRIX_COL_PINS;
+
+#ifdef MATRIX_SETTLE
+typedef struct {
+    uint8_t version;
+    uint8_t clock_mhz; // clk_sys the waits were measured at
+    uint8_t settle[MATRIX_ROWS];
+} matrix_settle_profile_t;
+
+_Static_assert(sizeof(matrix_settle_profile_t) <= EECONFIG_KB_DATA_SIZE, "Settle profile does not fit the EEPROM block");
+
+static uint8_t settle[MATRIX_ROWS];
+static uint8_t settle_trial[MATRIX_ROWS];
+static uint8_t settle_passes[MATRIX_ROWS];
+static uint8_t settle_rows_left;
+static uint8_t settle_margin;
+static bool    settle_calibrating;
+#    ifdef MATRIX_SETTLE_REPORT
+static bool settle_report;
+#    endif
+#endif
+
+#ifdef MATRIX_BANK_STATS
+static uint32_t bank_stats_us;
+static uint16_t bank_stats_scans;
+#endif
+
+MATRIX_BANK_HOT static void matrix_bank_recover(void) {
+    systime_t start = chVTGetSystemTimeX();
+
+    while ((palReadPort(IOPORT1) & MATRIX_BANK_COL_MASK) != MATRIX_BANK_COL_MASK) {
+        if (TIME_I2US(chVTTimeElapsedSinceX(start)) >= MATRIX_IO_DELAY) {
+            return;
+        }
+    }
+}
+
+// The output latch goes low before the pin turns output, so a row is never
+// driven high on the way, and a scan interrupted here leaves no row half set
+static inline void gpio_atomic_set_pin_output_low(pin_t pin) {
+    ATOMIC_BLOCK_FORCEON {
+        writePinLow(pin);
+        setPinOutput(pin);
+    }
+}
+
+static inline void gpio_atomic_set_pin_input_high(pin_t pin) {
+    ATOMIC_BLOCK_FORCEON {
+        setPinInputHigh(pin);
+    }
+}
+
+static inline void select_row(uint8_t row) {
+    gpio_atomic_set_pin_output_low(row_pins[row]);
+}
+
+static inline void unselect_row(uint8_t row) {
+    gpio_atomic_set_pin_input_high(row_pins[row]);
+}
+
+#ifdef MATRIX_SETTLE
+static inline void matrix_settle_wait(uint8_t reads) {
+    while (reads--) {
+        (void)palReadPort(IOPORT1);
+    }
+}
+#endif
+
+// Selects row, waits for it to settle and reads every column at once
+static uint32_t matrix_bank_read(uint8_t row, uint8_t reads) {
+    select_row(row);
+#ifdef MATRIX_SETTLE
+    matrix_settle_wait(reads);
+#else
+    waitInputPinDelay();
+#endif
+
+    uint32_t bank = ~palReadPort(IOPORT1) & MATRIX_BANK_COL_MASK;
+    unselect_row(row);
+    if (bank) {
+        matrix_bank_recover();
+    }
+    return bank;
+}
+
+#ifdef MATRIX_SETTLE
+static uint8_t matrix_settle_clock_mhz(void) {
+    return clock_get_hz(clk_sys) / 1000000;
+}
+
+// Reads in MATRIX_SETTLE_MARGIN_US, from the time a run of long waits takes
+static uint8_t matrix_settle_margin(void) {
+    enum { WAITS = 16 };
+    systime_t start = chVTGetSystemTimeX();
+
+    for (uint8_t n = 0; n < WAITS; n++) {
+        matrix_settle_wait(MATRIX_SETTLE_MAX);
+    }
+    uint32_t us    = MAX(TIME_I2US(chVTTimeElapsedSinceX(start)), 1);
+    uint32_t reads = ((uint32_t)MATRIX_SETTLE_MARGIN_US * WAITS * MATRIX_SETTLE_MAX + us - 1) / us;
+    return MIN(reads, MATRIX_SETTLE_MAX);
+}
+
+// At the first matrix change after boot, as the console is seldom open
+// before, and when a calibration is saved
+static void matrix_settle_print(void) {
+#    ifdef MATRIX_SETTLE_REPORT
+    settle_report = false;
+    if (settle_calibrating) {
+        uprintf("matrix settle: no profile for %u MHz, calibrating while keys are pressed, margin %u reads\n", matrix_settle_clock_mhz(), settle_margin);
+        return;
+    }
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        uprintf("matrix settle: row %u waits %u reads at %u MHz\n", row, settle[row], matrix_settle_clock_mhz());
+    }
+#    endif
+}
+
+static void matrix_settle_save(void) {
+    matrix_settle_profile_t profile = {.version = MATRIX_SETTLE_VERSION, .clock_mhz = matrix_settle_clock_mhz()};
+
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        settle[row]         = MIN(settle_trial[row] + settle_margin, MATRIX_SETTLE_MAX);
+        profile.settle[row] = settle[row];
+    }
+    settle_calibrating = false;
+    eeconfig_update_kb_datablock(&profile, 0, sizeof(profile));
+    matrix_settle_print();
+}
+
+// The profile is saved when the last row is done, never with fewer
+static void matrix_settle_row_done(uint8_t row) {
+    settle_passes[row] = MATRIX_SETTLE_PASSES;
+#    ifdef MATRIX_SETTLE_REPORT
+    uprintf("matrix settle: row %u stable after %u reads, %u rows left\n", row, settle_trial[row], settle_rows_left - 1);
+#    endif
+    if (--settle_rows_left == 0) {
+        matrix_settle_save();
+    }
+}
+
+// reference was read after the long wait
+static void matrix_settle_calibrate(uint8_t row, uint32_t reference) {
+    if (settle_passes[row] == MATRIX_SETTLE_PASSES) {
+        return;
+    }
+    for (uint8_t n = 0; n < MATRIX_SETTLE_SAMPLES; n++) {
+        if (matrix_bank_read(row, settle_trial[row]) == reference) {
+            continue;
+        }
+        // A key that changed in between says nothing about the wait
+        if (matrix_bank_read(row, MATRIX_SETTLE_MAX) != reference) {
+            return;
+        }
+        settle_passes[row] = 0;
+        if (++settle_trial[row] == MATRIX_SETTLE_MAX) {
+            matrix_settle_row_done(row);
+        }
+        return;
+    }
+    if (++settle_passes[row] == MATRIX_SETTLE_PASSES) {
+        matrix_settle_row_done(row);
+    }
+}
+
+// EEPROM is up from keyboard_setup, before the matrix is. A profile from
+// another build or another clock is not used.
+static void matrix_settle_load(void) {
+    matrix_settle_profile_t profile;
+    bool                    valid = false;
+
+    if (eeconfig_is_kb_datablock_valid()) {
+        eeconfig_read_kb_datablock(&profile, 0, sizeof(profile));
+        valid = profile.version == MATRIX_SETTLE_VERSION && profile.clock_mhz == matrix_settle_clock_mhz();
+        for (uint8_t row = 0; valid && row < MATRIX_ROWS; row++) {
+            valid = profile.settle[row] <= MATRIX_SETTLE_MAX;
+        }
+    }
+#    ifdef MATRIX_SETTLE_REPORT
+    settle_report = true;
+#    endif
+    if (valid) {
+        memcpy(settle, profile.settle, MATRIX_ROWS);
+        settle_calibrating = false;
+        return;
+    }
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        settle[row]        = MATRIX_SETTLE_MAX;
+        settle_trial[row]  = 0;
+        settle_passes[row] = 0;
+    }
+    settle_rows_left   = MATRIX_ROWS;
+    settle_margin      = matrix_settle_margin();
+    settle_calibrating = true;
+}
+#endif
+
+void matrix_init_custom(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        unselect_row(row);
+    }
+    for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+        setPinInputHigh(col_pins[col]);
+    }
+#ifdef MATRIX_SETTLE
+    matrix_settle_load();
+#endif
+}
+
+MATRIX_BANK_HOT bool matrix_scan_custom(matrix_row_t current_matrix[]) {
+    bool changed = false;
+#ifdef MATRIX_BANK_STATS
+    systime_t start = chVTGetSystemTimeX();
+#endif
+
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+#ifdef MATRIX_SETTLE
+        uint32_t bank = matrix_bank_read(row, settle[row]);
+        if (settle_calibrating && bank) {
+            matrix_settle_calibrate(row, bank);
+        }
+#else
+        uint32_t bank = matrix_bank_read(row, 0);
+#endif
+
+        matrix_row_t cols = matrix_bank_permute(bank);
+        changed |= current_matrix[row] != cols;
+        current_matrix[row] = cols;
+    }
+#ifdef MATRIX_SETTLE_REPORT
+    if (settle_report && changed) {
+        matrix_settle_print();
+    }
+#endif
+
+#ifdef MATRIX_BANK_STATS
+    bank_stats_us += TIME_I2US(chVTTimeElapsedSinceX(start));
+    if (++bank_stats_scans == 1000) {
+        dprintf("matrix bank: 1000 scans in %lu us\n", bank_stats_us);
+        bank_stats_us    = 0;
+        bank_stats_scans = 0;
+    }
+#endif
+    return changed;
+}
@@ -0,0 +1,55 @@
+#!/usr/bin/env python3
+"""Generate the column permutation used by matrix.c from info.json.
+
+All column pins sit on the one RP2040 GPIO bank, so a row is read with a
+single bank read. The bits of that read are moved to their columns with
+one 16 entry table per nibble that holds column pins:
+
+    columns = matrix_bank_lut_0[bank & 0xF] | matrix_bank_lut_1[(bank >> 4) & 0xF] | ...
+"""
+
+import json
+import sys
+
+
+def gpio(pin):
+    if not pin.startswith('GP') or not 0 <= int(pin[2:]) <= 29:
+        sys.exit(f'{pin} is not a bank 0 GPIO')
+    return int(pin[2:])
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(f'usage: {sys.argv[0]} info.json matrix_bank.h')
+
+    with open(sys.argv[1], encoding='utf-8') as f:
+        info = json.load(f)
+    if info.get('diode_direction') != 'COL2ROW':
+        sys.exit('the bank scanner drives rows and reads columns, COL2ROW only')
+    cols = [gpio(pin) for pin in info['matrix_pins']['cols']]
+    if len(set(cols)) != len(cols):
+        sys.exit('duplicate column pin')
+
+    mask = 0
+    luts = {}
+    for col, bit in enumerate(cols):
+        mask |= 1 << bit
+        lut = luts.setdefault(bit // 4, [0] * 16)
+        for value in range(16):
+            if value & (1 << (bit % 4)):
+                lut[value] |= 1 << col
+
+    with open(sys.argv[2], 'w', encoding='utf-8') as f:
+        f.write(f'// Generated by matrix_bank.py from {sys.argv[1]}, do not edit\n')
+        f.write('#pragma once\n\n')
+        f.write(f'#define MATRIX_BANK_COL_MASK 0x{mask:08X}\n\n')
+        for nibble, lut in sorted(luts.items()):
+            f.write(f'static const matrix_row_t matrix_bank_lut_{nibble}[16] = {{'
+                    + ', '.join(f'0x{v:04X}' for v in lut) + '};\n')
+        terms = [f'matrix_bank_lut_{n}[(bank >> {4 * n}) & 0xF]' for n in sorted(luts)]
+        f.write('\nstatic inline matrix_row_t matrix_bank_permute(uint32_t bank) {\n')
+        f.write('    return ' + ' |\n           '.join(terms) + ';\n}\n')
+
+
+if __name__ == '__main__':
+    main()
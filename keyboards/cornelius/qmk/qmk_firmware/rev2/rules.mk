@@ -0,0 +1,24 @@
+# Bank read scanner specialised from the info.json pins, see matrix.c
+REV2_PATH := $(patsubst %/,%,$(dir $(lastword $(MAKEFILE_LIST))))
+CUSTOM_MATRIX = lite
+SRC += matrix.c
+$(shell mkdir -p $(INTERMEDIATE_OUTPUT)/src && python3 $(REV2_PATH)/matrix_bank.py $(REV2_PATH)/info.json $(INTERMEDIATE_OUTPUT)/src/matrix_bank.h)
+VPATH += $(INTERMEDIATE_OUTPUT)/src
+
+# Scanner in SRAM instead of XIP flash
+MATRIX_BANK_SRAM ?= no
+ifeq ($(strip $(MATRIX_BANK_SRAM)), yes)
+    OPT_DEFS += -DMATRIX_BANK_SRAM
+endif
+
+# Row settle wait calibrated on this board and kept in EEPROM
+MATRIX_SETTLE ?= yes
+# Settle profile and calibration progress on the console
+MATRIX_SETTLE_REPORT ?= no
+ifeq ($(strip $(MATRIX_SETTLE)), yes)
+    OPT_DEFS += -DMATRIX_SETTLE
+    ifeq ($(strip $(MATRIX_SETTLE_REPORT)), yes)
+        OPT_DEFS += -DMATRIX_SETTLE_REPORT
+        CONSOLE_ENABLE = yes
+    endif
+endif
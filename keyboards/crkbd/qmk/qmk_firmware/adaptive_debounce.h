@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Window every key starts with, and returns to on reset
+#ifndef DEBOUNCE
+#    define DEBOUNCE 5
+#endif
+
+#ifndef ADAPTIVE_DEBOUNCE_MIN
+#    define ADAPTIVE_DEBOUNCE_MIN 1
+#endif
+
+#ifndef ADAPTIVE_DEBOUNCE_MAX
+#    define ADAPTIVE_DEBOUNCE_MAX 20
+#endif
+
+// Bounce closer than this to the window grows it
+#ifndef ADAPTIVE_DEBOUNCE_MARGIN
+#    define ADAPTIVE_DEBOUNCE_MARGIN 2
+#endif
+
+// Clean settles in a row before the window shrinks by 1 ms
+#ifndef ADAPTIVE_DEBOUNCE_CLEAN_COUNT
+#    define ADAPTIVE_DEBOUNCE_CLEAN_COUNT 32
+#endif
+
+// Two changes of the debounced state closer than this are chatter
+#ifndef ADAPTIVE_DEBOUNCE_CHATTER_TERM
+#    define ADAPTIVE_DEBOUNCE_CHATTER_TERM 15
+#endif
+
+// Value ids on the VIA custom channel. Rows count over both halves as in
+// the keymap, the other half answers for its own rows over the split link,
+// and reset and save apply to both halves.
+enum adaptive_debounce_value_id {
+    id_adaptive_debounce_row = 0x40, // get: row in data[3], window and chatter count per column from data[4]
+    id_adaptive_debounce_reset,      // set: every window back to DEBOUNCE
+};
+
+// Bounds the windows are tuned within, ADAPTIVE_DEBOUNCE_MIN and _MAX
+// until changed at runtime
+extern uint8_t adaptive_debounce_min;
+extern uint8_t adaptive_debounce_max;
+
+// Loads the saved table, and on a split takes requests from the master
+void adaptive_debounce_init(void);
+void adaptive_debounce_task(void);
+void adaptive_debounce_load(void);
+void adaptive_debounce_save(void);
+void adaptive_debounce_reset(void);
+bool adaptive_debounce_via_command(uint8_t *data, uint8_t length);
@@ -0,0 +1,306 @@
+#include "quantum.h"
+#include "host.h"
+#include "hardware/clocks.h"
+#include "hardware/structs/i2c.h"
+#include "hardware/structs/pio.h"
+#include "hardware/structs/uart.h"
+#include "hardware/structs/vreg_and_chip_reset.h"
+#include "hardware/timer.h"
+#include "clock_governor.h"
+
+// clk_sys is divided down from the system PLL while the board is idle and
+// goes back to full speed on the first input. The timer and USB run from
+// their own clocks. What runs from clk_sys and has to keep its timing is
+// rescaled with it: the PIO state machines (split serial, WS2812,
+// encoders), the UART baud divisors while clk_peri follows clk_sys, and the
+// I2C SCL counts, which are in clk_sys cycles, so the OLED bus keeps its
+// rate.
+//
+// Only the master switches. Its transport and LED transfers are started
+// from the main loop, so no transaction is in flight while it switches,
+// and the state machines are stopped across the switch so an LED frame
+// still going out pauses instead of running at the wrong rate. The slave
+// answers the master whenever it asks and stays at full speed.
+//
+// A wake is timed from the start of the loop that saw the input to the
+// first report handed to the host driver, which is wrapped for that from
+// housekeeping: the protocol sets the driver after keyboard init.
+
+// VREG VSEL values, 1.10 V is the reset default
+#define CLOCK_GOVERNOR_VSEL_1_10 0xB
+#define CLOCK_GOVERNOR_VSEL_1_00 0x9
+
+typedef struct {
+    uint8_t         div;
+    uint8_t         vsel;
+    const uint16_t *idle;
+} clock_governor_level_t;
+
+uint16_t clock_governor_half_idle    = CLOCK_GOVERNOR_HALF_IDLE;
+uint16_t clock_governor_quarter_idle = CLOCK_GOVERNOR_QUARTER_IDLE;
+
+static const uint16_t               governor_no_idle = 0;
+static const clock_governor_level_t governor_levels[CLOCK_GOVERNOR_LEVELS] = {
+    {1, CLOCK_GOVERNOR_VSEL_1_10, &governor_no_idle},
+    {2, CLOCK_GOVERNOR_VSEL_1_10, &clock_governor_half_idle},
+    {4, CLOCK_GOVERNOR_VSEL_1_00, &clock_governor_quarter_idle},
+};
+
+static uint32_t               governor_full_hz;
+static uint8_t                governor_level;
+static uint32_t               governor_level_since;
+static uint32_t               governor_loop_start;
+static uint32_t               governor_wake_start;
+static bool                   governor_report_pending;
+static clock_governor_stats_t governor_stats;
+
+static host_driver_t  governor_driver;
+static host_driver_t *governor_next;
+
+// Divisors of the running state machines and UARTs at full speed, saved
+// when the clock first goes down. Every level is set from these and full
+// speed puts them back as they were.
+static uint8_t  governor_pio_enabled[2];
+static uint32_t governor_pio_clkdiv[2][NUM_PIO_STATE_MACHINES];
+static uint8_t  governor_uart_enabled;
+static uint32_t governor_uart_baud[2];
+static uint8_t  governor_i2c_enabled;
+static uint16_t governor_i2c_scl[2][4];
+static uint16_t governor_i2c_spklen[2];
+static uint16_t governor_i2c_hold[2];
+
+static pio_hw_t *const  governor_pios[]  = {pio0_hw, pio1_hw};
+static uart_hw_t *const governor_uarts[] = {uart0_hw, uart1_hw};
+static i2c_hw_t *const  governor_i2cs[]  = {i2c0_hw, i2c1_hw};
+
+// SCL high and low counts of standard and fast mode, in clk_sys cycles
+static io_rw_32 *clock_governor_i2c_scl(uint8_t i, uint8_t n) {
+    io_rw_32 *const regs[] = {&governor_i2cs[i]->ss_scl_hcnt, &governor_i2cs[i]->ss_scl_lcnt, &governor_i2cs[i]->fs_scl_hcnt, &governor_i2cs[i]->fs_scl_lcnt};
+    return regs[n];
+}
+
+// The UARTs only follow clk_sys when clk_peri is taken from it
+static bool clock_governor_peri_on_sys(void) {
+    return (clocks_hw->clk[clk_peri].ctrl & CLOCKS_CLK_PERI_CTRL_AUXSRC_BITS) == CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS << CLOCKS_CLK_PERI_CTRL_AUXSRC_LSB;
+}
+
+static void clock_governor_save(void) {
+    governor_uart_enabled = 0;
+    governor_i2c_enabled  = 0;
+    for (uint8_t p = 0; p < 2; p++) {
+        governor_pio_enabled[p] = (governor_pios[p]->ctrl & PIO_CTRL_SM_ENABLE_BITS) >> PIO_CTRL_SM_ENABLE_LSB;
+        for (uint8_t sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            governor_pio_clkdiv[p][sm] = governor_pios[p]->sm[sm].clkdiv;
+        }
+    }
+    for (uint8_t u = 0; clock_governor_peri_on_sys() && u < 2; u++) {
+        if (governor_uarts[u]->cr & UART_UARTCR_UARTEN_BITS) {
+            governor_uart_enabled |= 1 << u;
+            governor_uart_baud[u] = governor_uarts[u]->ibrd << 6 | governor_uarts[u]->fbrd;
+        }
+    }
+    for (uint8_t i = 0; i < 2; i++) {
+        if (governor_i2cs[i]->enable & I2C_IC_ENABLE_ENABLE_BITS) {
+            governor_i2c_enabled |= 1 << i;
+            for (uint8_t n = 0; n < 4; n++) {
+                governor_i2c_scl[i][n] = *clock_governor_i2c_scl(i, n);
+            }
+            governor_i2c_spklen[i] = governor_i2cs[i]->fs_spklen;
+            governor_i2c_hold[i]   = governor_i2cs[i]->sda_hold & I2C_IC_SDA_HOLD_IC_SDA_TX_HOLD_BITS;
+        }
+    }
+}
+
+// Whether every saved divisor can be divided by div and keep its rate.
+// CLKDIV is 16.8 fixed point in its top 24 bits and the baud divisor is
+// 16.6, both 1.0 at the least. The I2C counts have to stay above the spike
+// filter, high by 5 and low by 7 cycles.
+static bool clock_governor_fits(uint8_t div) {
+    for (uint8_t p = 0; p < 2; p++) {
+        for (uint8_t sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            if ((governor_pio_enabled[p] & 1 << sm) && governor_pio_clkdiv[p][sm] >> PIO_SM0_CLKDIV_FRAC_LSB < (uint32_t)div << 8) {
+                return false;
+            }
+        }
+    }
+    for (uint8_t u = 0; u < 2; u++) {
+        if ((governor_uart_enabled & 1 << u) && governor_uart_baud[u] < (uint32_t)div << 6) {
+            return false;
+        }
+    }
+    for (uint8_t i = 0; i < 2; i++) {
+        uint16_t spklen = MAX(governor_i2c_spklen[i] / div, 1);
+
+        for (uint8_t n = 0; (governor_i2c_enabled & 1 << i) && n < 4; n++) {
+            if (governor_i2c_scl[i][n] / div < spklen + (n & 1 ? 7 : 5)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static void clock_governor_rescale(uint8_t div) {
+    for (uint8_t p = 0; p < 2; p++) {
+        for (uint8_t sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            if (governor_pio_enabled[p] & 1 << sm) {
+                uint32_t clkdiv                 = governor_pio_clkdiv[p][sm];
+                governor_pios[p]->sm[sm].clkdiv = div == 1 ? clkdiv : (clkdiv >> PIO_SM0_CLKDIV_FRAC_LSB) / div << PIO_SM0_CLKDIV_FRAC_LSB;
+            }
+        }
+    }
+    // Latched by the LCR_H write
+    for (uint8_t u = 0; u < 2; u++) {
+        if (governor_uart_enabled & 1 << u) {
+            uint32_t baud            = governor_uart_baud[u] / div;
+            governor_uarts[u]->ibrd  = baud >> 6;
+            governor_uarts[u]->fbrd  = baud & 0x3F;
+            governor_uarts[u]->lcr_h = governor_uarts[u]->lcr_h;
+        }
+    }
+    // Only written while the block is disabled, no transfer is in flight
+    // between main loop steps
+    for (uint8_t i = 0; i < 2; i++) {
+        if (governor_i2c_enabled & 1 << i) {
+            governor_i2cs[i]->enable = 0;
+            for (uint8_t n = 0; n < 4; n++) {
+                *clock_governor_i2c_scl(i, n) = governor_i2c_scl[i][n] / div;
+            }
+            governor_i2cs[i]->fs_spklen = MAX(governor_i2c_spklen[i] / div, 1);
+            hw_write_masked(&governor_i2cs[i]->sda_hold, MAX(governor_i2c_hold[i] / div, governor_i2c_hold[i] ? 1 : 0), I2C_IC_SDA_HOLD_IC_SDA_TX_HOLD_BITS);
+            governor_i2cs[i]->enable = I2C_IC_ENABLE_ENABLE_BITS;
+        }
+    }
+}
+
+static void clock_governor_vsel(uint8_t vsel) {
+    hw_write_masked(&vreg_and_chip_reset_hw->vreg, vsel << VREG_AND_CHIP_RESET_VREG_VSEL_LSB, VREG_AND_CHIP_RESET_VREG_VSEL_BITS);
+}
+
+static void clock_governor_set(uint8_t level) {
+    const clock_governor_level_t *from  = &governor_levels[governor_level];
+    const clock_governor_level_t *to    = &governor_levels[level];
+    uint32_t                      start = time_us_32();
+
+    if (to->vsel > from->vsel) {
+        clock_governor_vsel(to->vsel);
+        wait_us(CLOCK_GOVERNOR_VREG_SETTLE_US);
+    }
+    for (uint8_t p = 0; p < 2; p++) {
+        hw_clear_bits(&governor_pios[p]->ctrl, governor_pio_enabled[p] << PIO_CTRL_SM_ENABLE_LSB);
+    }
+    clock_configure(clk_sys, CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX, CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS, governor_full_hz, governor_full_hz / to->div);
+    clock_governor_rescale(to->div);
+    for (uint8_t p = 0; p < 2; p++) {
+        hw_set_bits(&governor_pios[p]->ctrl, governor_pio_enabled[p] << PIO_CTRL_SM_ENABLE_LSB);
+    }
+    if (to->vsel < from->vsel) {
+        clock_governor_vsel(to->vsel);
+    }
+
+    dprintf("clock governor: level %u, %lu MHz after %lu ms at %lu MHz, switch %lu us\n", level, governor_full_hz / to->div / 1000000, timer_elapsed32(governor_level_since), governor_full_hz / from->div / 1000000, time_us_32() - start);
+    governor_stats.level_ms[governor_level] += timer_elapsed32(governor_level_since);
+    governor_level       = level;
+    governor_level_since = timer_read32();
+    if (level > 0) {
+        // Input that never led to a report
+        governor_report_pending = false;
+    }
+}
+
+// The first report after a wake
+static void clock_governor_reported(void) {
+    if (!governor_report_pending) {
+        return;
+    }
+    uint32_t latency        = time_us_32() - governor_wake_start;
+    uint8_t  from           = governor_stats.wake_last_level;
+    governor_report_pending = false;
+
+    governor_stats.wake_last_us      = MIN(latency, UINT16_MAX);
+    governor_stats.wake_max_us[from] = MAX(governor_stats.wake_max_us[from], governor_stats.wake_last_us);
+    dprintf("clock governor: first report %lu us after input at level %u\n", latency, from);
+}
+
+static void clock_governor_send_keyboard(report_keyboard_t *report) {
+    clock_governor_reported();
+    governor_next->send_keyboard(report);
+}
+
+#ifdef NKRO_ENABLE
+static void clock_governor_send_nkro(report_nkro_t *report) {
+    clock_governor_reported();
+    governor_next->send_nkro(report);
+}
+#endif
+
+#ifdef EXTRAKEY_ENABLE
+static void clock_governor_send_extra(report_extra_t *report) {
+    clock_governor_reported();
+    governor_next->send_extra(report);
+}
+#endif
+
+// Back to full speed in the loop that saw input, timed from its start
+void clock_governor_wake(void) {
+    if (governor_level == 0) {
+        return;
+    }
+    governor_stats.wake_last_level = governor_level;
+    governor_stats.wakes++;
+    governor_wake_start     = governor_loop_start;
+    governor_report_pending = true;
+    clock_governor_set(0);
+}
+
+void clock_governor_task(void) {
+    uint32_t idle  = last_input_activity_elapsed();
+    uint8_t  level = 0;
+
+#ifdef SPLIT_KEYBOARD
+    if (!is_keyboard_master()) {
+        return;
+    }
+#endif
+    if (governor_full_hz == 0) {
+        governor_full_hz = clock_get_hz(clk_sys);
+    }
+    host_driver_t *driver = host_get_driver();
+    if (driver != NULL && driver != &governor_driver) {
+        governor_next                 = driver;
+        governor_driver               = *driver;
+        governor_driver.send_keyboard = clock_governor_send_keyboard;
+#ifdef NKRO_ENABLE
+        governor_driver.send_nkro = clock_governor_send_nkro;
+#endif
+#ifdef EXTRAKEY_ENABLE
+        governor_driver.send_extra = clock_governor_send_extra;
+#endif
+        host_set_driver(&governor_driver);
+    }
+
+    while (level < ARRAY_SIZE(governor_levels) - 1 && idle >= *governor_levels[level + 1].idle) {
+        level++;
+    }
+    if (level == 0) {
+        // Input no hook saw, a full loop late
+        clock_governor_wake();
+    } else if (level != governor_level) {
+        if (governor_level == 0) {
+            clock_governor_save();
+        }
+        while (level > 0 && !clock_governor_fits(governor_levels[level].div)) {
+            level--;
+        }
+        if (level != governor_level) {
+            clock_governor_set(level);
+        }
+    }
+    governor_loop_start = time_us_32();
+}
+
+const clock_governor_stats_t *clock_governor_stats(void) {
+    governor_stats.level_ms[governor_level] += timer_elapsed32(governor_level_since);
+    governor_level_since = timer_read32();
+    return &governor_stats;
+}
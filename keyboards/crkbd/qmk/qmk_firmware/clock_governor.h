@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+// Power at each level is measured from outside, with a USB power meter
+// between the host and the master and the slave connected as in use:
+//
+//  1. With TUNE_ENABLE, set governor_half 60000 and governor_quarter 60000
+//     and read the meter without typing for half a minute: full speed.
+//  2. Set governor_half 100 and read it again after a second: /2.
+//  3. Set governor_quarter 100 as well: /4 at the lower core voltage.
+//
+// Every switch is logged with its level, so the console shows which
+// reading belongs to which level. level_ms in the stats is the time spent
+// at each level, which with those readings gives the energy of a session.
+
+// Idle time without input before the system clock is halved, and before
+// it is quartered at a lower core voltage
+#ifndef CLOCK_GOVERNOR_HALF_IDLE
+#    define CLOCK_GOVERNOR_HALF_IDLE 1000
+#endif
+#ifndef CLOCK_GOVERNOR_QUARTER_IDLE
+#    define CLOCK_GOVERNOR_QUARTER_IDLE 10000
+#endif
+
+// Time given to the regulator to reach a higher voltage before the clock
+// goes up
+#ifndef CLOCK_GOVERNOR_VREG_SETTLE_US
+#    define CLOCK_GOVERNOR_VREG_SETTLE_US 200
+#endif
+
+#define CLOCK_GOVERNOR_LEVELS 3
+
+typedef struct {
+    uint16_t wakes;           // returns to full speed on input
+    uint8_t  wake_last_level; // level the last wake came from
+    uint16_t wake_last_us;    // from the start of the loop that saw the input to the first report sent
+    uint16_t wake_max_us[CLOCK_GOVERNOR_LEVELS];
+    uint32_t level_ms[CLOCK_GOVERNOR_LEVELS]; // time spent at each level
+} clock_governor_stats_t;
+
+extern uint16_t clock_governor_half_idle;
+extern uint16_t clock_governor_quarter_idle;
+
+void                          clock_governor_wake(void);
+void                          clock_governor_task(void);
+const clock_governor_stats_t *clock_governor_stats(void);
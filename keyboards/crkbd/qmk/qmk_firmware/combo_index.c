@@ -0,0 +1,334 @@
+#include "quantum.h"
+#include "dynamic_keymap.h"
+#include "vial.h"
+#include "combo_index.h"
+#include "hot_path.h"
+
+// Combos are matched by the matrix positions their keys have on the
+// active layers. Each combo is a packed key set, and every position lists
+// the combos it belongs to, so a key press only looks at its own
+// candidates. A combo with a key on no position, or on more than one, is
+// left to the stock engine, which matches keycodes; combo_should_trigger
+// keeps the stock engine off the combos matched here. Positions are mapped
+// again from housekeeping after the layer state changed. Until then, and
+// until an edit is rebuilt, the stock engine matches every combo. Outputs
+// go through the same tapping and process_record path as the stock
+// engine's, so any keycode works.
+
+#define COMBO_INDEX_KEYS (MATRIX_ROWS * MATRIX_COLS)
+#define COMBO_INDEX_BIT(pos) ((combo_keys_t)1 << (pos))
+
+_Static_assert(COMBO_INDEX_KEYS <= 64, "Combo key sets are packed into 64 bits");
+
+typedef uint64_t combo_keys_t;
+
+static uint16_t     combo_input[COMBO_INDEX_MAX][4];
+static uint16_t     combo_output[COMBO_INDEX_MAX];
+static uint16_t     combo_entry[COMBO_INDEX_MAX];
+static uint16_t     combo_count;
+static combo_keys_t combo_keys[COMBO_INDEX_MAX];
+static uint16_t     combo_first[COMBO_INDEX_KEYS + 1];
+static uint16_t     combo_list[COMBO_INDEX_MAX * 4];
+static uint8_t      combo_indexed[(VIAL_COMBO_ENTRIES + 7) / 8];
+
+static layer_state_t combo_layers;
+static layer_state_t combo_default_layers;
+static bool          combo_mapped;
+
+static bool     combo_enabled = true;
+static bool     combo_dirty   = true;
+static uint16_t combo_dirty_timer;
+
+static keyevent_t   combo_buffer[COMBO_INDEX_BUFFER_SIZE];
+static uint8_t      combo_buffered;
+static combo_keys_t combo_pressed;
+static int16_t      combo_best = -1;
+static bool         combo_replaying;
+
+static combo_keys_t combo_consumed;
+static combo_keys_t combo_active_keys[COMBO_INDEX_ACTIVE_MAX];
+static uint16_t     combo_active_output[COMBO_INDEX_ACTIVE_MAX];
+
+static uint8_t combo_index_pos(keypos_t key) {
+    return key.row * MATRIX_COLS + key.col;
+}
+
+static void combo_index_load(void) {
+    combo_count = 0;
+    for (uint16_t i = 0; i < VIAL_COMBO_ENTRIES && combo_count < COMBO_INDEX_MAX; i++) {
+        vial_combo_entry_t entry;
+        uint8_t            size = 0;
+
+        if (dynamic_keymap_get_combo(i, &entry) != 0 || entry.output == KC_NO) {
+            continue;
+        }
+        for (uint8_t j = 0; j < ARRAY_SIZE(entry.input); j++) {
+            if (entry.input[j] != KC_NO) {
+                combo_input[combo_count][size++] = entry.input[j];
+            }
+        }
+        if (size < 2) {
+            continue;
+        }
+        while (size < ARRAY_SIZE(entry.input)) {
+            combo_input[combo_count][size++] = KC_NO;
+        }
+        combo_output[combo_count] = entry.output;
+        combo_entry[combo_count]  = i;
+        combo_count++;
+    }
+    combo_mapped = false;
+    combo_dirty  = false;
+}
+
+// Position of keycode among the sorted ones, or COMBO_INDEX_KEYS when it
+// is on no position or on several
+static uint8_t combo_index_find(const uint16_t *keycode, const uint8_t *pos, uint16_t wanted) {
+    uint8_t low = 0, high = COMBO_INDEX_KEYS;
+
+    while (low < high) {
+        uint8_t middle = (low + high) / 2;
+        if (keycode[middle] < wanted) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == COMBO_INDEX_KEYS || keycode[low] != wanted || (low + 1 < COMBO_INDEX_KEYS && keycode[low + 1] == wanted)) {
+        return COMBO_INDEX_KEYS;
+    }
+    return pos[low];
+}
+
+// Maps every loaded combo to positions for the current layer state
+static void combo_index_map(void) {
+    uint16_t keycode[COMBO_INDEX_KEYS];
+    uint8_t  pos[COMBO_INDEX_KEYS];
+    uint16_t cursor[COMBO_INDEX_KEYS];
+
+    // Keycodes on the active layers, sorted with their positions
+    for (uint8_t i = 0; i < COMBO_INDEX_KEYS; i++) {
+        keypos_t key = {.row = i / MATRIX_COLS, .col = i % MATRIX_COLS};
+        uint16_t code = keymap_key_to_keycode(layer_switch_get_layer(key), key);
+        uint8_t  j    = i;
+
+        while (j > 0 && keycode[j - 1] > code) {
+            keycode[j] = keycode[j - 1];
+            pos[j]     = pos[j - 1];
+            j--;
+        }
+        keycode[j] = code;
+        pos[j]     = i;
+    }
+
+    memset(combo_first, 0, sizeof(combo_first));
+    memset(combo_indexed, 0, sizeof(combo_indexed));
+    for (uint16_t c = 0; c < combo_count; c++) {
+        combo_keys_t keys = 0;
+
+        for (uint8_t j = 0; j < 4 && combo_input[c][j] != KC_NO; j++) {
+            uint8_t found = combo_index_find(keycode, pos, combo_input[c][j]);
+            if (found == COMBO_INDEX_KEYS) {
+                keys = 0;
+                break;
+            }
+            keys |= COMBO_INDEX_BIT(found);
+        }
+        combo_keys[c] = keys;
+        if (keys == 0) {
+            continue;
+        }
+        combo_indexed[combo_entry[c] / 8] |= 1 << (combo_entry[c] % 8);
+        for (uint8_t i = 0; i < COMBO_INDEX_KEYS; i++) {
+            if (keys & COMBO_INDEX_BIT(i)) {
+                combo_first[i + 1]++;
+            }
+        }
+    }
+
+    for (uint8_t i = 0; i < COMBO_INDEX_KEYS; i++) {
+        combo_first[i + 1] += combo_first[i];
+        cursor[i] = combo_first[i];
+    }
+    for (uint16_t c = 0; c < combo_count; c++) {
+        for (uint8_t i = 0; i < COMBO_INDEX_KEYS; i++) {
+            if (combo_keys[c] & COMBO_INDEX_BIT(i)) {
+                combo_list[cursor[i]++] = c;
+            }
+        }
+    }
+
+    combo_layers         = layer_state;
+    combo_default_layers = default_layer_state;
+    combo_mapped         = true;
+}
+
+static bool combo_index_current(void) {
+    return combo_mapped && layer_state == combo_layers && default_layer_state == combo_default_layers;
+}
+
+// As the stock engine sends its combo events
+static void combo_index_send(uint16_t output, bool pressed) {
+    keyrecord_t record = {
+        .event =
+            {
+                .key     = MAKE_KEYPOS(KEYLOC_COMBO, KEYLOC_COMBO),
+                .time    = timer_read() | 1,
+                .type    = COMBO_EVENT,
+                .pressed = pressed,
+            },
+        .keycode = output,
+    };
+
+#ifndef NO_ACTION_TAPPING
+    action_tapping_process(record);
+#else
+    process_record(&record);
+#endif
+}
+
+static void combo_index_fire(uint16_t combo) {
+    combo_keys_t keys = combo_keys[combo];
+
+    combo_consumed |= keys;
+    combo_index_send(combo_output[combo], true);
+    for (uint8_t i = 0; i < COMBO_INDEX_ACTIVE_MAX; i++) {
+        if (combo_active_keys[i] == 0) {
+            combo_active_keys[i]   = keys;
+            combo_active_output[i] = combo_output[combo];
+            return;
+        }
+    }
+    combo_index_send(combo_output[combo], false);
+}
+
+// Fires the best complete combo and replays every other held back key
+static void combo_index_resolve(void) {
+    keyevent_t   buffer[COMBO_INDEX_BUFFER_SIZE];
+    uint8_t      buffered = combo_buffered;
+    combo_keys_t fired    = 0;
+
+    memcpy(buffer, combo_buffer, sizeof(buffer));
+    if (combo_best >= 0) {
+        fired = combo_keys[combo_best];
+        combo_index_fire(combo_best);
+    }
+    combo_buffered = 0;
+    combo_pressed  = 0;
+    combo_best     = -1;
+
+    combo_replaying = true;
+    for (uint8_t i = 0; i < buffered; i++) {
+        if (!(fired & COMBO_INDEX_BIT(combo_index_pos(buffer[i].key)))) {
+            action_exec(buffer[i]);
+        }
+    }
+    combo_replaying = false;
+}
+
+static bool combo_index_release(uint8_t pos) {
+    combo_keys_t bit = COMBO_INDEX_BIT(pos);
+
+    if (!(combo_consumed & bit)) {
+        return true;
+    }
+    combo_consumed &= ~bit;
+    for (uint8_t i = 0; i < COMBO_INDEX_ACTIVE_MAX; i++) {
+        if (combo_active_keys[i] & bit) {
+            if (combo_active_output[i] != KC_NO) {
+                combo_index_send(combo_active_output[i], false);
+                combo_active_output[i] = KC_NO;
+            }
+            combo_active_keys[i] &= ~bit;
+        }
+    }
+    return false;
+}
+
+void combo_index_init(void) {
+    combo_index_load();
+}
+
+void combo_index_invalidate(void) {
+    combo_dirty       = true;
+    combo_dirty_timer = timer_read();
+}
+
+void combo_index_task(void) {
+    if (combo_buffered && timer_elapsed(combo_buffer[0].time) >= COMBO_TERM) {
+        combo_index_resolve();
+    }
+    if (combo_dirty && !combo_buffered && timer_elapsed(combo_dirty_timer) >= COMBO_INDEX_REBUILD_DELAY) {
+        combo_index_load();
+    }
+    if (!combo_dirty && !combo_buffered && !combo_index_current()) {
+        combo_index_map();
+    }
+}
+
+bool combo_should_trigger(uint16_t combo_index, combo_t *combo, uint16_t keycode, keyrecord_t *record) {
+    if (combo_dirty || !combo_index_current() || combo_index >= VIAL_COMBO_ENTRIES) {
+        return true;
+    }
+    return !(combo_indexed[combo_index / 8] & (1 << (combo_index % 8)));
+}
+
+HOT_PATH bool pre_process_combo_index(uint16_t keycode, keyrecord_t *record) {
+    if (combo_replaying || !IS_KEYEVENT(record->event)) {
+        return true;
+    }
+
+    switch (keycode) {
+        case QK_COMBO_ON:
+        case QK_COMBO_OFF:
+        case QK_COMBO_TOGGLE:
+            // Passed on, so the stock engine follows along
+            if (record->event.pressed) {
+                combo_enabled = keycode == QK_COMBO_TOGGLE ? !combo_enabled : keycode == QK_COMBO_ON;
+            }
+            return true;
+    }
+
+    uint8_t pos = combo_index_pos(record->event.key);
+
+    if (!record->event.pressed) {
+        if (combo_buffered) {
+            combo_index_resolve();
+        }
+        return combo_index_release(pos);
+    }
+
+    if (!combo_enabled || combo_dirty || !combo_index_current() || combo_first[pos] == combo_first[pos + 1]) {
+        if (combo_buffered) {
+            combo_index_resolve();
+        }
+        return true;
+    }
+
+    if (combo_buffered == COMBO_INDEX_BUFFER_SIZE) {
+        combo_index_resolve();
+    }
+    combo_buffer[combo_buffered++] = record->event;
+    combo_pressed |= COMBO_INDEX_BIT(pos);
+
+    // Every combo that still contains all held keys contains this one
+    bool partial = false;
+    for (uint16_t i = combo_first[pos]; i < combo_first[pos + 1]; i++) {
+        uint16_t     combo = combo_list[i];
+        combo_keys_t keys  = combo_keys[combo];
+
+        if ((keys & combo_pressed) != combo_pressed) {
+            continue;
+        }
+        if (keys == combo_pressed) {
+            combo_best = combo;
+        } else {
+            partial = true;
+        }
+    }
+
+    if (!partial) {
+        combo_index_resolve();
+    }
+    return false;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "action.h"
+
+#ifndef COMBO_INDEX_MAX
+#    define COMBO_INDEX_MAX VIAL_COMBO_ENTRIES
+#endif
+
+// Keys held back while a combo may still complete
+#ifndef COMBO_INDEX_BUFFER_SIZE
+#    define COMBO_INDEX_BUFFER_SIZE 4
+#endif
+
+// Combos whose output is held until one of their keys is released
+#ifndef COMBO_INDEX_ACTIVE_MAX
+#    define COMBO_INDEX_ACTIVE_MAX 4
+#endif
+
+// Quiet time after a keymap or combo edit before the index is rebuilt
+#ifndef COMBO_INDEX_REBUILD_DELAY
+#    define COMBO_INDEX_REBUILD_DELAY 500
+#endif
+
+void combo_index_init(void);
+void combo_index_invalidate(void);
+void combo_index_task(void);
+bool pre_process_combo_index(uint16_t keycode, keyrecord_t *record);
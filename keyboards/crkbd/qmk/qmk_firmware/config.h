@@ -0,0 +1,54 @@
+#pragma once
+
+// Keyboard level EEPROM datablock, shared by the features that persist state
+#ifdef MACRO_ARENA_ENABLE
+#    ifdef __AVR__
+#        define EECONFIG_KB_MACRO_ARENA_SIZE 64
+#    else
+#        define EECONFIG_KB_MACRO_ARENA_SIZE 512
+#    endif
+#else
+#    define EECONFIG_KB_MACRO_ARENA_SIZE 0
+#endif
+#define EECONFIG_KB_MACRO_ARENA_OFFSET 0
+
+#ifdef ADAPTIVE_DEBOUNCE_ENABLE
+#    define EECONFIG_KB_DEBOUNCE_SIZE 64
+#else
+#    define EECONFIG_KB_DEBOUNCE_SIZE 0
+#endif
+#define EECONFIG_KB_DEBOUNCE_OFFSET (EECONFIG_KB_MACRO_ARENA_OFFSET + EECONFIG_KB_MACRO_ARENA_SIZE)
+
+#ifdef TUNE_ENABLE
+#    define EECONFIG_KB_TUNE_SIZE 34
+#else
+#    define EECONFIG_KB_TUNE_SIZE 0
+#endif
+#define EECONFIG_KB_TUNE_OFFSET (EECONFIG_KB_DEBOUNCE_OFFSET + EECONFIG_KB_DEBOUNCE_SIZE)
+
+#ifdef HEATMAP_ENABLE
+#    define EECONFIG_KB_HEATMAP_SIZE 128
+#else
+#    define EECONFIG_KB_HEATMAP_SIZE 0
+#endif
+#define EECONFIG_KB_HEATMAP_OFFSET (EECONFIG_KB_TUNE_OFFSET + EECONFIG_KB_TUNE_SIZE)
+
+#define EECONFIG_KB_DATA_SIZE (EECONFIG_KB_HEATMAP_OFFSET + EECONFIG_KB_HEATMAP_SIZE)
+
+#ifdef COMBO_INDEX_ENABLE
+// Keeps the stock engine off the combos combo_index.c matches
+#    define COMBO_SHOULD_TRIGGER
+#endif
+
+// RPC transactions of the keyboard level features, each registered by its
+// feature when it is built
+#define SPLIT_TRANSACTION_IDS_KB RPC_ID_KB_SPLIT_SCHED, RPC_ID_KB_DEBOUNCE, RPC_ID_KB_HEATMAP, RPC_ID_KB_RGB_DRIFT
+
+#ifdef RGB_DRIFT_ENABLE
+// Both halves render effects from the synced timer, which the core sends
+// with its transfer time added. Lighting state still goes out as soon as it
+// changes, the timer and unchanged state are resent once a second instead
+// of ten times. rgb_drift.c measures how far the halves drift apart in
+// that second and reports readings beyond RGB_DRIFT_MAX.
+#    define FORCED_SYNC_THROTTLE_MS 1000
+#endif
@@ -6,6 +6,77 @@
 #include "atomic_util.h"
 #include <stdbool.h>
 #include "hal.h"
+#include "hot_path.h"
+
+#ifdef VIA_ENABLE
+#    include "via.h"
+#endif
+#ifdef ENCODER_ACCEL_ENABLE
+#    include "encoder_accel.h"
+#endif
+#ifdef TAP_HOLD_RESOLVER_ENABLE
+#    include "tap_hold.h"
+#endif
+#ifdef COMBO_INDEX_ENABLE
+#    include "vial.h"
+#    include "combo_index.h"
+#endif
+#ifdef SEQUENCE_ENABLE
+#    include "sequence.h"
+#endif
+#ifdef FAST_SEND_ENABLE
+#    include "fast_send.h"
+#endif
+#ifdef MACRO_ARENA_ENABLE
+#    include "macro_arena.h"
+#endif
+#ifdef KEYMAP_CACHE_ENABLE
+#    include "keymap_cache.h"
+#endif
+#ifdef ADAPTIVE_DEBOUNCE_ENABLE
+#    include "adaptive_debounce.h"
+#endif
+#ifdef HEATMAP_ENABLE
+#    include "heatmap.h"
+#endif
+#ifdef OLED_FONT_ATLAS_ENABLE
+#    include "font_atlas.h"
+#endif
+#ifdef SPLIT_SCHED_ENABLE
+#    include "split_sched.h"
+#endif
+#ifdef RGB_DRIFT_ENABLE
+#    include "rgb_drift.h"
+#endif
+#ifdef SPLIT_SERIAL_STATS_ENABLE
+#    include "split_serial_stats.h"
+#endif
+#ifdef SPLIT_LINK_ENABLE
+#    include "split_link.h"
+#endif
+#ifdef LOOP_STATS_ENABLE
+#    include "loop_stats.h"
+#endif
+#ifdef CLOCK_GOVERNOR_ENABLE
+#    include "clock_governor.h"
+#endif
+#ifdef TUNE_ENABLE
+#    include "tune.h"
+#endif
+#ifdef TELEMETRY_ENABLE
+#    include "telemetry.h"
+#endif
+
+#ifdef OLED_ENABLE
+typedef struct {
+    uint16_t keycode;
+    uint8_t  row;
+    uint8_t  col;
+    char     name;
+} keylog_t;
+
+static keylog_t keylog = {.name = ' '};
+#endif
 
 static void gpio_atomic_set_uart_tx_pin(pin_t pin) {
     xprintf("Setting TX pin %lu - Before: state=%lu, mode=%lu\n", 
@@ -52,6 +123,36 @@ void keyboard_pre_init_user(void) {
     }
 }
 
+void keyboard_post_init_kb(void) {
+    // Saved bounds first, the features below load against them
+#ifdef TUNE_ENABLE
+    tune_load();
+#endif
+#ifdef SPLIT_SCHED_ENABLE
+    split_sched_init();
+#endif
+#if defined(SPLIT_SCHED_ENABLE) && defined(OLED_ENABLE)
+    // The slave shows the master's keylog
+    split_sched_register(&keylog, sizeof(keylog), SPLIT_SCHED_LOW, 100);
+#endif
+#ifdef COMBO_INDEX_ENABLE
+    combo_index_init();
+#endif
+#ifdef MACRO_ARENA_ENABLE
+    macro_arena_init();
+#endif
+#ifdef ADAPTIVE_DEBOUNCE_ENABLE
+    adaptive_debounce_init();
+#endif
+#ifdef HEATMAP_ENABLE
+    heatmap_init();
+#endif
+#ifdef RGB_DRIFT_ENABLE
+    rgb_drift_init();
+#endif
+    keyboard_post_init_user();
+}
+
 void keyboard_post_init_user(void) {
     xprintf("Post-init: Is master? %d\n", is_keyboard_master());
     xprintf("Post-init: Transport connected? %d\n", is_transport_connected());
@@ -72,6 +173,52 @@ void keyboard_post_init_user(void) {
     }
 }
 
+void housekeeping_task_kb(void) {
+#ifdef LOOP_STATS_ENABLE
+    loop_stats_task();
+#endif
+#ifdef CLOCK_GOVERNOR_ENABLE
+    clock_governor_task();
+#endif
+#ifdef COMBO_INDEX_ENABLE
+    combo_index_task();
+#endif
+#ifdef ENCODER_ACCEL_ENABLE
+    encoder_accel_task();
+#endif
+#ifdef SEQUENCE_ENABLE
+    sequence_task();
+#endif
+#ifdef FAST_SEND_ENABLE
+    fast_send_task();
+#endif
+#ifdef MACRO_ARENA_ENABLE
+    macro_arena_task();
+#endif
+#ifdef ADAPTIVE_DEBOUNCE_ENABLE
+    adaptive_debounce_task();
+#endif
+#ifdef HEATMAP_ENABLE
+    heatmap_task();
+#endif
+#ifdef SPLIT_LINK_ENABLE
+    split_link_task();
+#endif
+#ifdef RGB_DRIFT_ENABLE
+    rgb_drift_task();
+#endif
+#ifdef SPLIT_SERIAL_STATS_ENABLE
+    split_serial_stats_task();
+#endif
+#ifdef SPLIT_SCHED_ENABLE
+    split_sched_task();
+#endif
+#ifdef TELEMETRY_ENABLE
+    telemetry_task();
+#endif
+    housekeeping_task_user();
+}
+
 // Add a periodic check
 void housekeeping_task_user(void) {
     static uint32_t last_debug = 0;
@@ -97,7 +244,51 @@ void housekeeping_task_user(void) {
     }
 }
 
+#ifdef CLOCK_GOVERNOR_ENABLE
+// The host resuming the bus
+void suspend_wakeup_init_kb(void) {
+    clock_governor_wake();
+    suspend_wakeup_init_user();
+}
+#endif
+
+#ifdef KEYMAP_CACHE_ENABLE
+// Runs before the new state is stored, so the cache is ready for the next press
+layer_state_t layer_state_set_kb(layer_state_t state) {
+    state = layer_state_set_user(state);
+    keymap_cache_update(state | default_layer_state);
+    return state;
+}
+
+layer_state_t default_layer_state_set_kb(layer_state_t state) {
+    state = default_layer_state_set_user(state);
+    keymap_cache_update(layer_state | state);
+    return state;
+}
+#endif
+
 #ifdef OLED_ENABLE
+#    ifdef OLED_FONT_ATLAS_ENABLE
+// The status text is drawn from the glyph atlas. The driver font is left
+// blank, keymaps draw text with font_atlas_* too.
+#        define status_write_char font_atlas_write_char
+#        define status_write font_atlas_write
+#        define status_write_P font_atlas_write_P
+#        define status_write_ln_P font_atlas_write_ln_P
+#    else
+#        define status_write_char oled_write_char
+#        define status_write oled_write
+#        define status_write_P oled_write_P
+#        define status_write_ln_P oled_write_ln_P
+#    endif
+
+// Least time between two draws, 0 draws on every OLED task
+#    ifndef OLED_DRAW_INTERVAL
+#        define OLED_DRAW_INTERVAL 0
+#    endif
+uint16_t        oled_draw_interval = OLED_DRAW_INTERVAL;
+static uint16_t oled_draw_timer;
+
 oled_rotation_t oled_init_kb(oled_rotation_t rotation) {
     if (!is_keyboard_master()) {
         return OLED_ROTATION_180; // flips the display 180 degrees if offhand
@@ -106,40 +297,35 @@ oled_rotation_t oled_init_kb(oled_rotation_t rotation) {
 }
 
 static void oled_render_layer_state(void) {
-    oled_write_P(PSTR("Layer: "), false);
+    status_write_P(PSTR("Layer: "), false);
     switch (get_highest_layer(layer_state)) {
         case 0:
-            oled_write_ln_P(PSTR("Default"), false);
+            status_write_ln_P(PSTR("Default"), false);
             break;
         case 1:
-            oled_write_ln_P(PSTR("Lower"), false);
+            status_write_ln_P(PSTR("Lower"), false);
             break;
         case 2:
-            oled_write_ln_P(PSTR("Raise"), false);
+            status_write_ln_P(PSTR("Raise"), false);
             break;
         case 3:
-            oled_write_ln_P(PSTR("Adjust"), false);
+            status_write_ln_P(PSTR("Adjust"), false);
             break;
         default:
-            oled_write_ln_P(PSTR("Undef"), false);
+            status_write_ln_P(PSTR("Undef"), false);
             break;
     }
 }
 
-char     key_name = ' ';
-uint16_t last_keycode;
-uint8_t  last_row;
-uint8_t  last_col;
-
 static const char PROGMEM code_to_name[60] = {' ', ' ', ' ', ' ', 'a', 'b', 'c', 'd', 'e', 'f', 'g', 'h', 'i', 'j', 'k', 'l', 'm', 'n', 'o', 'p', 'q', 'r', 's', 't', 'u', 'v', 'w', 'x', 'y', 'z', '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', 'R', 'E', 'B', 'T', '_', '-', '=', '[', ']', '\\', '#', ';', '\'', '`', ',', '.', '/', ' ', ' ', ' '};
 
 static void set_keylog(uint16_t keycode, keyrecord_t *record) {
     // save the row and column (useful even if we can't find a keycode to show)
-    last_row = record->event.key.row;
-    last_col = record->event.key.col;
+    keylog.row = record->event.key.row;
+    keylog.col = record->event.key.col;
 
-    key_name     = ' ';
-    last_keycode = keycode;
+    keylog.name    = ' ';
+    keylog.keycode = keycode;
     if (IS_QK_MOD_TAP(keycode)) {
         if (record->tap.count) {
             keycode = QK_MOD_TAP_GET_TAP_KEYCODE(keycode);
@@ -158,7 +344,7 @@ static void set_keylog(uint16_t keycode, keyrecord_t *record) {
     }
 
     // update keylog
-    key_name = pgm_read_byte(&code_to_name[keycode]);
+    keylog.name = pgm_read_byte(&code_to_name[keycode]);
 }
 
 static const char *depad_str(const char *depad_str, char depad_char) {
@@ -168,14 +354,14 @@ static const char *depad_str(const char *depad_str, char depad_char) {
 }
 
 static void oled_render_keylog(void) {
-    oled_write_char('0' + last_row, false);
-    oled_write_P(PSTR("x"), false);
-    oled_write_char('0' + last_col, false);
-    oled_write_P(PSTR(", k"), false);
-    const char *last_keycode_str = get_u16_str(last_keycode, ' ');
-    oled_write(depad_str(last_keycode_str, ' '), false);
-    oled_write_P(PSTR(":"), false);
-    oled_write_char(key_name, false);
+    status_write_char('0' + keylog.row, false);
+    status_write_P(PSTR("x"), false);
+    status_write_char('0' + keylog.col, false);
+    status_write_P(PSTR(", k"), false);
+    const char *last_keycode_str = get_u16_str(keylog.keycode, ' ');
+    status_write(depad_str(last_keycode_str, ' '), false);
+    status_write_P(PSTR(":"), false);
+    status_write_char(keylog.name, false);
 }
 
 // static void render_bootmagic_status(bool status) {
@@ -201,27 +387,145 @@ __attribute__((weak)) void oled_render_logo(void) {
         0xc0, 0xc1, 0xc2, 0xc3, 0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xcb, 0xcc, 0xcd, 0xce, 0xcf, 0xd0, 0xd1, 0xd2, 0xd3, 0xd4,
         0};
     // clang-format on
-    oled_write_P(crkbd_logo, false);
+    status_write_P(crkbd_logo, false);
 }
 
 bool oled_task_kb(void) {
+    if (timer_elapsed(oled_draw_timer) < oled_draw_interval) {
+        return false;
+    }
+    oled_draw_timer = timer_read();
     if (!oled_task_user()) {
         return false;
     }
+#    ifdef OLED_FONT_ATLAS_ENABLE
+    // Status lines are proportional, the logo tiles keep the fixed grid
+    font_atlas_set_cursor(0, 0);
+    font_atlas_set_proportional(is_keyboard_master());
+#    endif
     if (is_keyboard_master()) {
         oled_render_layer_state();
         oled_render_keylog();
+#    ifdef OLED_FONT_ATLAS_ENABLE
+        font_atlas_clear_line();
+#    endif
     } else {
         oled_render_logo();
+#    if defined(SPLIT_SCHED_ENABLE) && !defined(LOGO_ANIM_ENABLE)
+        oled_render_keylog();
+#    endif
     }
     return false;
 }
 
-bool process_record_kb(uint16_t keycode, keyrecord_t *record) {
+#endif // OLED_ENABLE
+
+#ifdef HEATMAP_ENABLE
+void matrix_scan_kb(void) {
+    heatmap_scan();
+    matrix_scan_user();
+}
+
+// Runs on the slave after each scan of its half
+void matrix_slave_scan_kb(void) {
+    heatmap_scan();
+    matrix_slave_scan_user();
+}
+#endif
+
+HOT_PATH bool pre_process_record_kb(uint16_t keycode, keyrecord_t *record) {
+#ifdef CLOCK_GOVERNOR_ENABLE
+    // Key and encoder edges, ahead of everything that processes them
+    clock_governor_wake();
+#endif
+#ifdef COMBO_INDEX_ENABLE
+    if (!pre_process_combo_index(keycode, record)) {
+        return false;
+    }
+#endif
+#ifdef TAP_HOLD_RESOLVER_ENABLE
+    if (!pre_process_tap_hold(keycode, record)) {
+        return false;
+    }
+#endif
+    return pre_process_record_user(keycode, record);
+}
+
+HOT_PATH bool process_record_kb(uint16_t keycode, keyrecord_t *record) {
+#ifdef TELEMETRY_ENABLE
+    telemetry_key(keycode, record);
+#endif
+#ifdef MACRO_ARENA_ENABLE
+    if (!process_macro_arena(keycode, record)) {
+        return false;
+    }
+#endif
+#ifdef SEQUENCE_ENABLE
+    if (!process_sequence(keycode, record)) {
+        return false;
+    }
+#endif
+#if defined(FAST_SEND_ENABLE) && defined(VIA_ENABLE)
+    if (keycode >= QK_MACRO && keycode <= QK_MACRO_MAX && record->event.pressed && fast_send_macro(keycode - QK_MACRO)) {
+        return false;
+    }
+#endif
+#ifdef ENCODER_ACCEL_ENABLE
+    if (!process_encoder_accel(keycode, record)) {
+        return false;
+    }
+#endif
+#ifdef OLED_ENABLE
     if (record->event.pressed) {
         set_keylog(keycode, record);
     }
+#endif
     return process_record_user(keycode, record);
 }
 
-#endif // OLED_ENABLE
+#ifdef VIA_ENABLE
+bool via_command_kb(uint8_t *data, uint8_t length) {
+    switch (data[0]) {
+        case id_dynamic_keymap_set_keycode:
+        case id_dynamic_keymap_reset:
+        case id_dynamic_keymap_set_buffer:
+        case id_eeprom_reset:
+#    ifdef KEYMAP_CACHE_ENABLE
+            keymap_cache_invalidate();
+#    endif
+#    ifdef COMBO_INDEX_ENABLE
+            combo_index_invalidate();
+#    endif
+            break;
+#    ifdef COMBO_INDEX_ENABLE
+        case id_vial_prefix:
+            if (data[1] == vial_dynamic_entry_op && data[2] == dynamic_vial_combo_set) {
+                combo_index_invalidate();
+            }
+            break;
+#    endif
+    }
+    return false;
+}
+
+// Value ids are unique across the features, so each command reaches all of
+// them and only its owner answers. A save is for every feature.
+void via_custom_value_command_kb(uint8_t *data, uint8_t length) {
+    bool handled = false;
+
+    if (data[1] == id_custom_channel) {
+#    ifdef ADAPTIVE_DEBOUNCE_ENABLE
+        handled |= adaptive_debounce_via_command(data, length);
+#    endif
+#    ifdef HEATMAP_ENABLE
+        handled |= heatmap_via_command(data, length);
+#    endif
+#    ifdef TUNE_ENABLE
+        handled |= tune_via_command(data, length);
+#    endif
+    }
+    if (!handled) {
+        data[0] = id_unhandled;
+    }
+}
+#endif
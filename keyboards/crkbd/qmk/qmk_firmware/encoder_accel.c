@@ -0,0 +1,225 @@
+#include "quantum.h"
+#include "encoder_accel.h"
+
+typedef struct {
+    uint16_t keycode;  // keycode of the pending detents
+    uint16_t last;     // time of the most recent detent
+    uint16_t interval; // smoothed time between detents
+    uint8_t  count;    // detents since the last flush
+    uint8_t  backlog;  // volume steps still to send
+} encoder_accel_t;
+
+static encoder_accel_t encoder_accel[NUM_ENCODERS];
+static uint16_t        encoder_accel_frame;
+static uint16_t        encoder_accel_volume_sent;
+#ifdef RGB_MATRIX_ENABLE
+// RGB changes are applied without EEPROM writes and saved once the
+// encoders rest
+static bool     encoder_accel_rgb_dirty;
+static uint16_t encoder_accel_rgb_changed;
+#endif
+
+uint16_t encoder_accel_frame_ms = ENCODER_ACCEL_FRAME_MS;
+
+uint8_t encoder_accel_multiplier(uint16_t detent_interval) {
+    if (detent_interval >= ENCODER_ACCEL_SLOW_MS) {
+        return 1;
+    }
+    if (detent_interval <= ENCODER_ACCEL_FAST_MS) {
+        return ENCODER_ACCEL_MAX_MULTIPLIER;
+    }
+    return 1 + (uint16_t)(ENCODER_ACCEL_MAX_MULTIPLIER - 1) * (ENCODER_ACCEL_SLOW_MS - detent_interval) / (ENCODER_ACCEL_SLOW_MS - ENCODER_ACCEL_FAST_MS);
+}
+
+static bool encoder_accel_handles(uint16_t keycode) {
+    switch (keycode) {
+#ifdef RGB_MATRIX_ENABLE
+        case RGB_MOD:
+        case RGB_RMOD:
+        case RGB_HUI:
+        case RGB_HUD:
+        case RGB_SAI:
+        case RGB_SAD:
+        case RGB_VAI:
+        case RGB_VAD:
+#endif
+        case KC_VOLU:
+        case KC_VOLD:
+            return true;
+        default:
+            return false;
+    }
+}
+
+#ifdef RGB_MATRIX_ENABLE
+static uint8_t encoder_accel_clamp(int16_t value, uint8_t max) {
+    if (value < 0) {
+        return 0;
+    }
+    return value > max ? max : value;
+}
+
+static void encoder_accel_step_mode(int16_t steps) {
+    const int16_t modes = RGB_MATRIX_EFFECT_MAX - 1;
+    int16_t       mode  = (rgb_matrix_get_mode() - 1 + steps % modes + modes) % modes;
+    rgb_matrix_mode_noeeprom(mode + 1);
+}
+
+// Shift turns the RGB keys around, as it does for the stock handlers
+static uint16_t encoder_accel_shifted(uint16_t keycode) {
+    switch (keycode) {
+        case RGB_MOD:
+            return RGB_RMOD;
+        case RGB_RMOD:
+            return RGB_MOD;
+        case RGB_HUI:
+            return RGB_HUD;
+        case RGB_HUD:
+            return RGB_HUI;
+        case RGB_SAI:
+            return RGB_SAD;
+        case RGB_SAD:
+            return RGB_SAI;
+        case RGB_VAI:
+            return RGB_VAD;
+        case RGB_VAD:
+            return RGB_VAI;
+        default:
+            return keycode;
+    }
+}
+#endif
+
+static uint8_t encoder_accel_volume_cap(void) {
+    return MIN(MAX(2 * encoder_accel_frame_ms / ENCODER_ACCEL_VOLUME_MS, ENCODER_ACCEL_MAX_MULTIPLIER), UINT8_MAX);
+}
+
+// Applies all pending detents of one encoder as a single update
+static void encoder_accel_apply(encoder_accel_t *state, uint8_t multiplier) {
+    uint16_t keycode = state->keycode;
+    uint16_t steps   = (uint16_t)state->count * multiplier;
+
+#ifdef RGB_MATRIX_ENABLE
+    if (keycode != KC_VOLU && keycode != KC_VOLD) {
+        encoder_accel_rgb_dirty   = true;
+        encoder_accel_rgb_changed = timer_read();
+    }
+#endif
+    switch (keycode) {
+#ifdef RGB_MATRIX_ENABLE
+        // Effect changes skip modes if accelerated, so they step once per detent
+        case RGB_MOD:
+            encoder_accel_step_mode(state->count);
+            break;
+        case RGB_RMOD:
+            encoder_accel_step_mode(-(int16_t)state->count);
+            break;
+        case RGB_HUI:
+        case RGB_HUD: {
+            uint8_t delta = (uint8_t)(steps * RGB_MATRIX_HUE_STEP);
+            uint8_t hue   = rgb_matrix_get_hue() + (keycode == RGB_HUI ? delta : -delta);
+            rgb_matrix_sethsv_noeeprom(hue, rgb_matrix_get_sat(), rgb_matrix_get_val());
+            break;
+        }
+        case RGB_SAI:
+        case RGB_SAD: {
+            int16_t delta = (int16_t)steps * RGB_MATRIX_SAT_STEP;
+            int16_t sat   = rgb_matrix_get_sat() + (keycode == RGB_SAI ? delta : -delta);
+            rgb_matrix_sethsv_noeeprom(rgb_matrix_get_hue(), encoder_accel_clamp(sat, UINT8_MAX), rgb_matrix_get_val());
+            break;
+        }
+        case RGB_VAI:
+        case RGB_VAD: {
+            int16_t delta = (int16_t)steps * RGB_MATRIX_VAL_STEP;
+            int16_t val   = rgb_matrix_get_val() + (keycode == RGB_VAI ? delta : -delta);
+            rgb_matrix_sethsv_noeeprom(rgb_matrix_get_hue(), rgb_matrix_get_sat(), encoder_accel_clamp(val, RGB_MATRIX_MAXIMUM_BRIGHTNESS));
+            break;
+        }
+#endif
+        default:
+            // The host only sees volume changes as separate usages. They go
+            // out every ENCODER_ACCEL_VOLUME_MS, with what two frames take
+            // to send queued at most, so they stop soon after the encoder.
+            state->backlog = MIN(state->backlog + steps, encoder_accel_volume_cap());
+            break;
+    }
+}
+
+static void encoder_accel_flush(encoder_accel_t *state) {
+    if (state->count == 0) {
+        return;
+    }
+    encoder_accel_apply(state, encoder_accel_multiplier(state->interval));
+    state->count = 0;
+}
+
+bool process_encoder_accel(uint16_t keycode, keyrecord_t *record) {
+    if (!IS_ENCODEREVENT(record->event) || !encoder_accel_handles(keycode)) {
+        return true;
+    }
+    if (record->event.key.col >= NUM_ENCODERS) {
+        return true;
+    }
+
+    // Encoder map keycodes arrive as a tap, only the press is counted
+    if (record->event.pressed) {
+        encoder_accel_t *state = &encoder_accel[record->event.key.col];
+        uint16_t         now   = timer_read();
+        uint16_t         since = TIMER_DIFF_16(now, state->last);
+
+#ifdef RGB_MATRIX_ENABLE
+        if (get_mods() & MOD_MASK_SHIFT) {
+            keycode = encoder_accel_shifted(keycode);
+        }
+#endif
+        // A direction or layer change applies what was collected so far
+        // first, and drops volume steps the other way
+        if (state->keycode != keycode) {
+            encoder_accel_flush(state);
+            state->backlog = 0;
+        }
+
+        if (since >= ENCODER_ACCEL_IDLE_MS || state->keycode != keycode) {
+            state->interval = ENCODER_ACCEL_SLOW_MS;
+        } else {
+            state->interval = (state->interval + since) / 2;
+        }
+        state->last    = now;
+        state->keycode = keycode;
+        if (state->count < UINT8_MAX) {
+            state->count++;
+        }
+    }
+    return false;
+}
+
+static void encoder_accel_send_volume(void) {
+    if (timer_elapsed(encoder_accel_volume_sent) < ENCODER_ACCEL_VOLUME_MS) {
+        return;
+    }
+    for (uint8_t i = 0; i < NUM_ENCODERS; i++) {
+        encoder_accel_t *state = &encoder_accel[i];
+
+        if (state->backlog) {
+            state->backlog--;
+            tap_code(state->keycode);
+            encoder_accel_volume_sent = timer_read();
+        }
+    }
+}
+
+void encoder_accel_task(void) {
+    if (timer_elapsed(encoder_accel_frame) >= encoder_accel_frame_ms) {
+        encoder_accel_frame = timer_read();
+        for (uint8_t i = 0; i < NUM_ENCODERS; i++) {
+            encoder_accel_flush(&encoder_accel[i]);
+        }
+    }
+    encoder_accel_send_volume();
+#ifdef RGB_MATRIX_ENABLE
+    if (encoder_accel_rgb_dirty && timer_elapsed(encoder_accel_rgb_changed) >= ENCODER_ACCEL_IDLE_MS) {
+        encoder_accel_rgb_dirty = false;
+        eeconfig_update_rgb_matrix();
+    }
+#endif
+}
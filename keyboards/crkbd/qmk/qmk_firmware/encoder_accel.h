@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "action.h"
+
+// Detents are collected per encoder and applied once per frame
+#ifndef ENCODER_ACCEL_FRAME_MS
+#    define ENCODER_ACCEL_FRAME_MS 20
+#endif
+
+// Detent interval at or above which no acceleration is applied
+#ifndef ENCODER_ACCEL_SLOW_MS
+#    define ENCODER_ACCEL_SLOW_MS 80
+#endif
+
+// Detent interval at or below which the full multiplier is applied
+#ifndef ENCODER_ACCEL_FAST_MS
+#    define ENCODER_ACCEL_FAST_MS 10
+#endif
+
+#ifndef ENCODER_ACCEL_MAX_MULTIPLIER
+#    define ENCODER_ACCEL_MAX_MULTIPLIER 6
+#endif
+
+// Time between volume steps sent from the backlog. Stock firmware sends
+// one per detent, about every 10 ms on a fast spin.
+#ifndef ENCODER_ACCEL_VOLUME_MS
+#    define ENCODER_ACCEL_VOLUME_MS 4
+#endif
+
+// Idle time after which the velocity estimate is reset
+#ifndef ENCODER_ACCEL_IDLE_MS
+#    define ENCODER_ACCEL_IDLE_MS 250
+#endif
+
+extern uint16_t encoder_accel_frame_ms;
+
+uint8_t encoder_accel_multiplier(uint16_t detent_interval);
+bool    process_encoder_accel(uint16_t keycode, keyrecord_t *record);
+void    encoder_accel_task(void);
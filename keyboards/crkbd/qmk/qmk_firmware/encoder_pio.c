@@ -0,0 +1,185 @@
+#include "quantum.h"
+#include "encoder.h"
+#include "hardware/pio.h"
+#include "hardware/pio_instructions.h"
+#include "encoder_pio.h"
+
+// Custom encoder driver. Each encoder has a state machine that follows
+// the quadrature signal and keeps the count in Y, so steps taken during a
+// long OLED or RGB frame are still counted. Pin A is read with IN and pin
+// B with JMP PIN, the pins do not have to be consecutive and encoders may
+// share one. The program is the jump table decoder:
+//
+//   0-15  jump table on previous AB, current AB
+//   16    decrement: jmp y--, update
+//   17    update:    mov isr, y         ; .wrap_target
+//   18               push noblock
+//   19               out isr, 2         ; previous AB
+//   20               in pins, 1         ; A
+//   21               jmp pin, b_high
+//   22               in null, 1         ; B low
+//   23               jmp table
+//   24    b_high:    in x, 1            ; x holds 1
+//   25    table:     mov osr, isr
+//   26               mov pc, isr
+//   27    increment: mov y, ~y
+//   28               jmp y--, 29
+//   29               mov y, ~y          ; .wrap
+
+#define ENCODER_PIO_DECREMENT 16
+#define ENCODER_PIO_UPDATE 17
+#define ENCODER_PIO_B_HIGH 24
+#define ENCODER_PIO_TABLE 25
+#define ENCODER_PIO_INCREMENT 27
+#define ENCODER_PIO_LENGTH 30
+
+#ifdef ENCODER_DIRECTION_FLIP
+#    define ENCODER_PIO_CLOCKWISE false
+#else
+#    define ENCODER_PIO_CLOCKWISE true
+#endif
+
+static const pin_t encoder_pins_a[] = ENCODER_A_PINS;
+static const pin_t encoder_pins_b[] = ENCODER_B_PINS;
+#ifdef ENCODER_A_PINS_RIGHT
+static const pin_t encoder_pins_a_right[] = ENCODER_A_PINS_RIGHT;
+static const pin_t encoder_pins_b_right[] = ENCODER_B_PINS_RIGHT;
+#endif
+
+static uint16_t encoder_pio_program[ENCODER_PIO_LENGTH];
+static int8_t   encoder_sm[NUM_ENCODERS_MAX_PER_SIDE];
+static uint32_t encoder_count[NUM_ENCODERS_MAX_PER_SIDE];
+static int32_t  encoder_residual[NUM_ENCODERS_MAX_PER_SIDE];
+static uint8_t  encoder_local;
+static uint8_t  encoder_base;
+
+int16_t encoder_pio_detents(int32_t *residual, int32_t delta) {
+    int32_t detents;
+
+    *residual += delta;
+    detents = *residual / ENCODER_RESOLUTION;
+    *residual -= detents * ENCODER_RESOLUTION;
+    return detents;
+}
+
+static void encoder_pio_assemble(void) {
+    // A leads B clockwise: 00 -> 10 -> 11 -> 01 -> 00
+    for (uint8_t i = 0; i < 16; i++) {
+        uint8_t target = ENCODER_PIO_UPDATE;
+        switch (i) {
+            case 0x2:
+            case 0xB:
+            case 0xD:
+            case 0x4:
+                target = ENCODER_PIO_INCREMENT;
+                break;
+            case 0x1:
+            case 0x7:
+            case 0xE:
+            case 0x8:
+                target = ENCODER_PIO_DECREMENT;
+                break;
+        }
+        encoder_pio_program[i] = pio_encode_jmp(target);
+    }
+
+    uint16_t *code = &encoder_pio_program[ENCODER_PIO_DECREMENT];
+    *code++        = pio_encode_jmp_y_dec(ENCODER_PIO_UPDATE);
+    *code++        = pio_encode_mov(pio_isr, pio_y);
+    *code++        = pio_encode_push(false, false);
+    *code++        = pio_encode_out(pio_isr, 2);
+    *code++        = pio_encode_in(pio_pins, 1);
+    *code++        = pio_encode_jmp_pin(ENCODER_PIO_B_HIGH);
+    *code++        = pio_encode_in(pio_null, 1);
+    *code++        = pio_encode_jmp(ENCODER_PIO_TABLE);
+    *code++        = pio_encode_in(pio_x, 1);
+    *code++        = pio_encode_mov(pio_osr, pio_isr);
+    *code++        = pio_encode_mov(pio_pc, pio_isr);
+    *code++        = pio_encode_mov_not(pio_y, pio_y);
+    *code++        = pio_encode_jmp_y_dec(ENCODER_PIO_INCREMENT + 2);
+    *code++        = pio_encode_mov_not(pio_y, pio_y);
+}
+
+// Newest count in the FIFO, last if there is none. The pushes do not
+// block, so once the FIFO is full it holds the counts from just after the
+// previous read: a step is reported a loop late at most, never lost, and
+// the main loop never waits on a state machine.
+static uint32_t encoder_pio_read(uint8_t sm, uint32_t last) {
+    while (!pio_sm_is_rx_fifo_empty(ENCODER_PIO, sm)) {
+        last = pio_sm_get(ENCODER_PIO, sm);
+    }
+    return last;
+}
+
+void encoder_driver_init(void) {
+    const pin_t *pins_a = encoder_pins_a;
+    const pin_t *pins_b = encoder_pins_b;
+
+    encoder_local = NUM_ENCODERS_LEFT;
+#ifdef ENCODER_A_PINS_RIGHT
+    if (!is_keyboard_left()) {
+        pins_a        = encoder_pins_a_right;
+        pins_b        = encoder_pins_b_right;
+        encoder_local = NUM_ENCODERS_RIGHT;
+        encoder_base  = NUM_ENCODERS_LEFT;
+    }
+#endif
+
+    // Out of reset only once a driver using it starts, which may be none
+    hal_lld_peripheral_unreset(ENCODER_PIO == pio0 ? RESETS_ALLREG_PIO0 : RESETS_ALLREG_PIO1);
+    encoder_pio_assemble();
+    pio_program_t program = {.instructions = encoder_pio_program, .length = ENCODER_PIO_LENGTH, .origin = 0};
+    if (!pio_can_add_program(ENCODER_PIO, &program)) {
+        dprintf("encoder pio: instruction memory in use, encoders disabled\n");
+        encoder_local = 0;
+        return;
+    }
+    pio_add_program(ENCODER_PIO, &program);
+
+    for (uint8_t i = 0; i < encoder_local; i++) {
+        int sm = pio_claim_unused_sm(ENCODER_PIO, false);
+        encoder_sm[i] = sm;
+        if (sm < 0) {
+            continue;
+        }
+        gpio_set_pin_input_high(pins_a[i]);
+        gpio_set_pin_input_high(pins_b[i]);
+
+        pio_sm_config c = pio_get_default_sm_config();
+        sm_config_set_wrap(&c, ENCODER_PIO_UPDATE, ENCODER_PIO_LENGTH - 1);
+        sm_config_set_in_pins(&c, pins_a[i]);
+        sm_config_set_jmp_pin(&c, pins_b[i]);
+        sm_config_set_in_shift(&c, false, false, 32);
+        sm_config_set_out_shift(&c, true, false, 32);
+        sm_config_set_clkdiv_int_frac(&c, ENCODER_PIO_CLKDIV, 0);
+        pio_sm_init(ENCODER_PIO, sm, ENCODER_PIO_UPDATE, &c);
+        pio_sm_exec(ENCODER_PIO, sm, pio_encode_set(pio_x, 1));
+        pio_sm_exec(ENCODER_PIO, sm, pio_encode_set(pio_y, 0));
+        // Previous AB from the pins, so the first sample does not count a
+        // step from the 00 the state machine starts with
+        pio_sm_put(ENCODER_PIO, sm, gpio_read_pin(pins_a[i]) << 1 | gpio_read_pin(pins_b[i]));
+        pio_sm_exec(ENCODER_PIO, sm, pio_encode_pull(false, false));
+        pio_sm_set_enabled(ENCODER_PIO, sm, true);
+        encoder_count[i] = 0;
+    }
+}
+
+void encoder_driver_task(void) {
+    for (uint8_t i = 0; i < encoder_local; i++) {
+        if (encoder_sm[i] < 0) {
+            continue;
+        }
+        uint32_t count   = encoder_pio_read(encoder_sm[i], encoder_count[i]);
+        int16_t  detents = encoder_pio_detents(&encoder_residual[i], (int32_t)(count - encoder_count[i]));
+        encoder_count[i] = count;
+
+        // What does not fit in the event queue waits for the next loop
+        while (detents > 0 && encoder_queue_event(encoder_base + i, ENCODER_PIO_CLOCKWISE)) {
+            detents--;
+        }
+        while (detents < 0 && encoder_queue_event(encoder_base + i, !ENCODER_PIO_CLOCKWISE)) {
+            detents++;
+        }
+        encoder_residual[i] += detents * ENCODER_RESOLUTION;
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+// PIO block the decoder takes, its program needs the whole instruction
+// memory. The vendor serial and WS2812 drivers default to pio0.
+#ifndef ENCODER_PIO
+#    define ENCODER_PIO pio1
+#endif
+
+// The state machines sample at clk_sys / ENCODER_PIO_CLKDIV / 10, fast
+// enough for any hand spun encoder
+#ifndef ENCODER_PIO_CLKDIV
+#    define ENCODER_PIO_CLKDIV 16
+#endif
+
+#ifndef ENCODER_RESOLUTION
+#    define ENCODER_RESOLUTION 4
+#endif
+
+// Whole detents in the counts gathered so far, the remainder is kept in
+// residual for the next call
+int16_t encoder_pio_detents(int32_t *residual, int32_t delta);
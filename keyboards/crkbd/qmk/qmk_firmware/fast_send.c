@@ -0,0 +1,254 @@
+#include "quantum.h"
+#include "send_string.h"
+#include "fast_send.h"
+#ifdef VIA_ENABLE
+#    include "dynamic_keymap.h"
+#endif
+#ifdef OS_DETECTION_ENABLE
+#    include "os_detection.h"
+#endif
+
+// Strings are queued in SEND_STRING encoding and sent from housekeeping,
+// one report per FAST_SEND_INTERVAL, so scanning and typing go on while a
+// long text goes out. Characters are grouped into reports that press
+// several keys at once. USB does not say in which order a host handles
+// the keys of one report, so a group only grows while keycodes ascend,
+// which suits hosts that go by usage and also splits on repeated keys. A
+// modifier change starts a new group as well. fast_send_batch caps the
+// group: 1 sends a key per report for hosts that reorder, 0 leaves every
+// string to the stock sender.
+
+#define FAST_SEND_LOADBIT(lut, c) ((pgm_read_byte(&(lut)[(c) / 8]) >> ((c) % 8)) & 0x01)
+
+// Indexes wrap with uint8_t
+#define FAST_SEND_QUEUE_SIZE 256
+
+uint8_t fast_send_batch = FAST_SEND_BATCH_MAX;
+
+static uint8_t fast_send_queue[FAST_SEND_QUEUE_SIZE];
+static uint8_t fast_send_head;
+static uint8_t fast_send_tail;
+
+static uint8_t  fast_send_keys[FAST_SEND_BATCH_MAX];
+static uint8_t  fast_send_count;
+static uint8_t  fast_send_tap;
+static uint16_t fast_send_timer;
+static uint16_t fast_send_wait;
+
+static uint8_t fast_send_limit(void) {
+    uint8_t limit = MIN(fast_send_batch, FAST_SEND_BATCH_MAX);
+
+#ifdef OS_DETECTION_ENABLE
+    // Nothing known about the host, so nothing assumed about its order
+    if (detected_host_os() == OS_UNSURE) {
+        limit = MIN(limit, 1);
+    }
+#endif
+#ifdef NKRO_ENABLE
+    if (keymap_config.nkro) {
+        return limit;
+    }
+#endif
+    return MIN(limit, 6);
+}
+
+static uint8_t fast_send_queued(void) {
+    return fast_send_tail - fast_send_head;
+}
+
+static uint8_t fast_send_peek(uint8_t index) {
+    return fast_send_queue[(uint8_t)(fast_send_head + index)];
+}
+
+static void fast_send_put(uint8_t c) {
+    // Full, send in place until there is room
+    while (fast_send_queued() == FAST_SEND_QUEUE_SIZE - 1) {
+        wait_ms(FAST_SEND_INTERVAL);
+        fast_send_task();
+    }
+    fast_send_queue[fast_send_tail++] = c;
+}
+
+// Keycode and modifiers of a character, KC_NO for those left to send_char()
+static uint8_t fast_send_lookup(uint8_t c, uint8_t *mods) {
+    if (c >= 0x80 || FAST_SEND_LOADBIT(ascii_to_dead_lut, c)) {
+        return KC_NO;
+    }
+    *mods = 0;
+    if (FAST_SEND_LOADBIT(ascii_to_shift_lut, c)) {
+        *mods |= MOD_BIT(KC_LEFT_SHIFT);
+    }
+    if (FAST_SEND_LOADBIT(ascii_to_altgr_lut, c)) {
+        *mods |= MOD_BIT(KC_RIGHT_ALT);
+    }
+    return pgm_read_byte(&ascii_to_keycode_lut[c]);
+}
+
+// Presses the characters at the head that fit one report
+static void fast_send_group(void) {
+    uint8_t limit = fast_send_limit();
+    uint8_t mods  = 0;
+
+    while (fast_send_queued() && fast_send_peek(0) != SS_QMK_PREFIX && fast_send_count < limit) {
+        uint8_t c = fast_send_peek(0);
+        uint8_t char_mods;
+        uint8_t keycode = fast_send_lookup(c, &char_mods);
+
+        if (keycode == KC_NO) {
+            if (fast_send_count) {
+                break;
+            }
+            // Dead keys need a trailing space, the stock sender adds it
+            fast_send_head++;
+            if (c < 0x80 && FAST_SEND_LOADBIT(ascii_to_dead_lut, c)) {
+                send_char(c);
+            }
+            continue;
+        }
+        if (fast_send_count && (char_mods != mods || keycode <= fast_send_keys[fast_send_count - 1])) {
+            break;
+        }
+        mods                              = char_mods;
+        fast_send_keys[fast_send_count++] = keycode;
+        fast_send_head++;
+    }
+    if (fast_send_count == 0) {
+        return;
+    }
+
+    set_weak_mods(mods);
+    for (uint8_t i = 0; i < fast_send_count; i++) {
+        add_key(fast_send_keys[i]);
+    }
+    send_keyboard_report();
+}
+
+// Runs the code after SS_QMK_PREFIX, false while it is not all queued
+static bool fast_send_code(void) {
+    uint8_t queued = fast_send_queued();
+
+    if (queued < 3) {
+        return false;
+    }
+    uint8_t code = fast_send_peek(1);
+    if (code == SS_DELAY_CODE) {
+        uint16_t ms  = 0;
+        uint8_t  end = 2;
+        while (end < queued && fast_send_peek(end) != '|') {
+            ms = ms * 10 + fast_send_peek(end++) - '0';
+        }
+        if (end == queued) {
+            return false;
+        }
+        fast_send_head += end + 1;
+        fast_send_wait = ms;
+        return true;
+    }
+
+    uint8_t keycode = fast_send_peek(2);
+    fast_send_head += 3;
+    switch (code) {
+        case SS_TAP_CODE:
+            fast_send_tap = keycode;
+            register_code(keycode);
+            break;
+        case SS_DOWN_CODE:
+            register_code(keycode);
+            break;
+        case SS_UP_CODE:
+            unregister_code(keycode);
+            break;
+    }
+    return true;
+}
+
+void fast_send_task(void) {
+    if (timer_elapsed(fast_send_timer) < fast_send_wait) {
+        return;
+    }
+    fast_send_wait = FAST_SEND_INTERVAL;
+
+    if (fast_send_count) {
+        for (uint8_t i = 0; i < fast_send_count; i++) {
+            del_key(fast_send_keys[i]);
+        }
+        fast_send_count = 0;
+        clear_weak_mods();
+        send_keyboard_report();
+    } else if (fast_send_tap) {
+        unregister_code(fast_send_tap);
+        fast_send_tap = KC_NO;
+    } else if (fast_send_queued() == 0) {
+        return;
+    } else if (fast_send_peek(0) == SS_QMK_PREFIX) {
+        if (!fast_send_code()) {
+            return;
+        }
+    } else {
+        fast_send_group();
+    }
+    fast_send_timer = timer_read();
+}
+
+bool fast_send_busy(void) {
+    return fast_send_queued() || fast_send_count || fast_send_tap;
+}
+
+static void fast_send(const char *str, bool progmem) {
+    if (fast_send_limit() == 0) {
+        progmem ? send_string_P(str) : send_string(str);
+        return;
+    }
+    for (;; str++) {
+        uint8_t c = progmem ? pgm_read_byte(str) : *str;
+        if (c == '\0') {
+            break;
+        }
+        fast_send_put(c);
+    }
+}
+
+void fast_send_string(const char *str) {
+    fast_send(str, false);
+}
+
+void fast_send_string_P(const char *str) {
+    fast_send(str, true);
+}
+
+#ifdef VIA_ENABLE
+bool fast_send_macro(uint8_t id) {
+    uint16_t size   = dynamic_keymap_macro_get_buffer_size();
+    uint16_t offset = 0;
+    uint16_t start, end;
+    uint8_t  c;
+
+    if (fast_send_limit() == 0) {
+        return false;
+    }
+    for (; id > 0 && offset < size; offset++) {
+        dynamic_keymap_macro_get_buffer(offset, 1, &c);
+        id -= c == '\0';
+    }
+    // Codes the stock player handles on its own, like Vial's 16-bit keys,
+    // leave the whole macro to it
+    for (start = end = offset; end < size; end++) {
+        dynamic_keymap_macro_get_buffer(end, 1, &c);
+        if (c == '\0') {
+            break;
+        }
+        if (c == SS_QMK_PREFIX && end + 1 < size) {
+            dynamic_keymap_macro_get_buffer(++end, 1, &c);
+            if (c < SS_TAP_CODE || c > SS_DELAY_CODE) {
+                return false;
+            }
+            end += c != SS_DELAY_CODE;
+        }
+    }
+    for (offset = start; offset < end; offset++) {
+        dynamic_keymap_macro_get_buffer(offset, 1, &c);
+        fast_send_put(c);
+    }
+    return true;
+}
+#endif
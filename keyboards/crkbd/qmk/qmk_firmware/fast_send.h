@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Time given to the host to poll each report
+#ifndef FAST_SEND_INTERVAL
+#    define FAST_SEND_INTERVAL 1
+#endif
+
+// Keys pressed together in one report when NKRO is active
+#ifndef FAST_SEND_BATCH_MAX
+#    define FAST_SEND_BATCH_MAX 16
+#endif
+
+// Keys per report, 1 for hosts that reorder the keys of a report and 0
+// for the stock sender
+extern uint8_t fast_send_batch;
+
+// Strings take SEND_STRING encoding and are sent from fast_send_task()
+void fast_send_string(const char *str);
+void fast_send_string_P(const char *str);
+void fast_send_task(void);
+bool fast_send_busy(void);
+
+// Queues VIA macro id, false when the stock player has to run it
+bool fast_send_macro(uint8_t id);
@@ -0,0 +1,105 @@
+#include "quantum.h"
+#include "font_atlas.h"
+#include "font_atlas_data.h"
+
+// The atlas layout is described in font_atlas.py. Columns are written
+// straight into the page aligned OLED buffer, which tracks dirty blocks.
+
+#define FONT_ATLAS_LINES (OLED_DISPLAY_HEIGHT / 8)
+
+static uint8_t font_x;
+static uint8_t font_line;
+static bool    font_proportional;
+
+static uint16_t font_atlas_find(uint8_t glyph) {
+    uint16_t pos = pgm_read_word(&font_atlas_index[glyph / FONT_ATLAS_GROUP]);
+
+    for (uint8_t i = glyph & ~(FONT_ATLAS_GROUP - 1); i < glyph; i++) {
+        pos += 1 + __builtin_popcount(pgm_read_byte(&font_atlas_glyphs[pos]));
+    }
+    return pos;
+}
+
+static void font_atlas_newline(void) {
+    font_x    = 0;
+    font_line = (font_line + 1) % FONT_ATLAS_LINES;
+}
+
+static void font_atlas_put(uint8_t column) {
+    oled_write_raw_byte(column, font_line * OLED_DISPLAY_WIDTH + font_x);
+    font_x++;
+}
+
+void font_atlas_set_cursor(uint8_t x, uint8_t line) {
+    font_x    = x < OLED_DISPLAY_WIDTH ? x : 0;
+    font_line = line % FONT_ATLAS_LINES;
+}
+
+void font_atlas_set_proportional(bool proportional) {
+    font_proportional = proportional;
+}
+
+void font_atlas_clear_line(void) {
+    while (font_x < OLED_DISPLAY_WIDTH) {
+        font_atlas_put(0);
+    }
+    font_atlas_newline();
+}
+
+void font_atlas_write_char(char c, bool invert) {
+    uint8_t  mask = 0;
+    uint16_t pos  = 0;
+    uint8_t  from = 0;
+    uint8_t  to   = FONT_ATLAS_WIDTH;
+
+    if (c == '\n') {
+        font_atlas_clear_line();
+        return;
+    }
+    if ((uint8_t)c >= FONT_ATLAS_FIRST && (uint8_t)c <= FONT_ATLAS_LAST) {
+        pos  = font_atlas_find((uint8_t)c - FONT_ATLAS_FIRST);
+        mask = pgm_read_byte(&font_atlas_glyphs[pos++]);
+    }
+
+    // Proportional glyphs drop their blank edges and keep one column gap
+    if (font_proportional) {
+        if (mask == 0) {
+            to = FONT_ATLAS_SPACE_WIDTH;
+        } else {
+            from = __builtin_ctz(mask);
+            to   = 8 * sizeof(int) - __builtin_clz(mask) + 1;
+        }
+    }
+    if (font_x + to - from > OLED_DISPLAY_WIDTH) {
+        font_atlas_clear_line();
+    }
+
+    uint8_t flip = invert ? 0xFF : 0x00;
+    for (uint8_t i = 0; i < to; i++) {
+        uint8_t column = 0;
+        if (mask & (1 << i)) {
+            column = pgm_read_byte(&font_atlas_glyphs[pos++]);
+        }
+        if (i >= from) {
+            font_atlas_put(column ^ flip);
+        }
+    }
+}
+
+void font_atlas_write(const char *str, bool invert) {
+    while (*str) {
+        font_atlas_write_char(*str++, invert);
+    }
+}
+
+void font_atlas_write_P(const char *str, bool invert) {
+    char c;
+    while ((c = pgm_read_byte(str++))) {
+        font_atlas_write_char(c, invert);
+    }
+}
+
+void font_atlas_write_ln_P(const char *str, bool invert) {
+    font_atlas_write_P(str, invert);
+    font_atlas_clear_line();
+}
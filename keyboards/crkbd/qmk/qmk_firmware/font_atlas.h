@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Advance of a blank glyph, such as space, in proportional mode
+#ifndef FONT_ATLAS_SPACE_WIDTH
+#    define FONT_ATLAS_SPACE_WIDTH 3
+#endif
+
+// Same cursor rules as the driver: lines are 8 pixel pages and text wraps
+// at the end of the display. The cursor is separate from the driver's,
+// whose font only has a blank glyph left, so oled_write draws nothing.
+void font_atlas_set_cursor(uint8_t x, uint8_t line);
+void font_atlas_set_proportional(bool proportional);
+void font_atlas_clear_line(void);
+void font_atlas_write_char(char c, bool invert);
+void font_atlas_write(const char *str, bool invert);
+void font_atlas_write_P(const char *str, bool invert);
+void font_atlas_write_ln_P(const char *str, bool invert);
@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+"""Generate the compressed glyph atlas used by font_atlas.c.
+
+Reads the 6 byte per glyph table of a glcdfont.c style font and keeps the
+glyphs named on the command line, as hex ranges:
+
+    font_atlas.py glcdfont.c font_atlas_data.h 20-7e,80-94,a0-b4,c0-d4
+
+Every glyph becomes a mask byte with one bit per column that is not
+blank, followed by those columns only. Glyphs left out of the ranges are
+a single zero mask. A glyph is found by starting from the offset of its
+group of 16 in font_atlas_index and skipping the glyphs before it.
+
+The atlas size against the stock table and the decode work per glyph go
+to stderr.
+"""
+
+import re
+import sys
+
+WIDTH = 6
+GROUP = 16
+
+
+def parse_font(path):
+    with open(path, encoding='utf-8') as f:
+        source = f.read()
+    body = source[source.index('{') + 1:source.rindex('}')]
+    values = [int(v, 16) for v in re.findall(r'0x([0-9A-Fa-f]{2})', body)]
+    return [values[i:i + WIDTH] for i in range(0, len(values) - WIDTH + 1, WIDTH)]
+
+
+def parse_ranges(spec):
+    glyphs = set()
+    for part in spec.split(','):
+        first, _, last = part.partition('-')
+        glyphs.update(range(int(first, 16), int(last or first, 16) + 1))
+    return glyphs
+
+
+def encode(glyph):
+    mask = 0
+    columns = []
+    for i, column in enumerate(glyph):
+        if column:
+            mask |= 1 << i
+            columns.append(column)
+    return [mask] + columns
+
+
+def array(values):
+    lines = []
+    for i in range(0, len(values), 16):
+        lines.append('    ' + ', '.join(f'0x{v:02X}' for v in values[i:i + 16]) + ',')
+    return '\n'.join(lines)
+
+
+def main():
+    if len(sys.argv) != 4:
+        sys.exit(f'usage: {sys.argv[0]} glcdfont.c font_atlas_data.h ranges')
+
+    font = parse_font(sys.argv[1])
+    keep = {c for c in parse_ranges(sys.argv[3]) if c < len(font)}
+    if not keep:
+        sys.exit('no glyphs selected')
+    first, last = min(keep), max(keep)
+
+    data = []
+    index = []
+    for c in range(first, last + 1):
+        if (c - first) % GROUP == 0:
+            index.append(len(data))
+        data += encode(font[c]) if c in keep else [0]
+    if len(data) > 0xFFFF:
+        sys.exit('font atlas exceeds 64 KiB')
+
+    # Masks read to skip to each glyph in its group, plus the glyph itself
+    work = [(c - first) % GROUP + len(encode(font[c])) for c in keep]
+    atlas = len(data) + 2 * len(index)
+    stock = len(font) * WIDTH
+    print(f'font atlas: {len(keep)} glyphs in {atlas} bytes, stock font {stock} bytes; '
+          f'decode reads {sum(work) / len(work):.1f} bytes per glyph, {max(work)} at most', file=sys.stderr)
+
+    with open(sys.argv[2], 'w', encoding='utf-8') as f:
+        f.write(f'// Generated by font_atlas.py from {sys.argv[1]}, do not edit\n')
+        f.write('#pragma once\n\n')
+        f.write(f'#define FONT_ATLAS_FIRST 0x{first:02X}\n')
+        f.write(f'#define FONT_ATLAS_LAST 0x{last:02X}\n')
+        f.write(f'#define FONT_ATLAS_WIDTH {WIDTH}\n')
+        f.write(f'#define FONT_ATLAS_GROUP {GROUP}\n\n')
+        f.write('static const uint16_t font_atlas_index[] PROGMEM = {\n    '
+                + ', '.join(str(i) for i in index) + ',\n};\n\n')
+        f.write('static const uint8_t font_atlas_glyphs[] PROGMEM = {\n' + array(data) + '\n};\n')
+
+
+if __name__ == '__main__':
+    main()
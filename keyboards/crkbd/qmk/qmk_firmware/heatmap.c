@@ -0,0 +1,286 @@
+#include "quantum.h"
+#include "eeconfig.h"
+#include "heatmap.h"
+#include "hot_path.h"
+#ifdef VIA_ENABLE
+#    include "via.h"
+#endif
+#ifdef SPLIT_KEYBOARD
+#    include "transactions.h"
+#endif
+
+// Each half counts the presses of its own rows from the debounced matrix,
+// so the slave counts and warms its LEDs without help from the master.
+// Counts saturate at 16 bits and are kept for layout analysis. Changed
+// counts go to the half's EEPROM every HEATMAP_SAVE_INTERVAL, a row per
+// housekeeping pass. VIA talks to the master only, which asks the slave
+// for its rows in an RPC transaction.
+//
+// The RGB effect only tracks LEDs that are still warm. They sit in a
+// sparse list that decay walks, so a mostly idle board costs next to
+// nothing per frame. Decay is applied lazily from the time elapsed since
+// the last decay, whenever the list is touched. Rendering still writes
+// every LED, cold ones off, so nothing drawn over the effect stays.
+
+#define HEATMAP_VERSION 1
+#define HEATMAP_ROW_SIZE (2 * MATRIX_COLS)
+
+_Static_assert(1 + MATRIX_ROWS * HEATMAP_ROW_SIZE <= EECONFIG_KB_HEATMAP_SIZE, "Press counts do not fit their EEPROM block");
+
+static uint16_t     heat_counts[MATRIX_ROWS][MATRIX_COLS];
+static matrix_row_t heat_matrix[MATRIX_ROWS];
+static bool         heat_dirty;
+static uint32_t     heat_saved_at;
+static int8_t       heat_save_row = -1;
+
+#if defined(VIA_ENABLE) && defined(SPLIT_KEYBOARD)
+_Static_assert(1 + HEATMAP_ROW_SIZE <= RPC_S2M_BUFFER_SIZE, "A row of press counts does not fit the RPC reply");
+
+typedef struct {
+    uint8_t command;
+    uint8_t value_id;
+    uint8_t row;
+} heatmap_rpc_t;
+
+static volatile bool heat_reset_pending;
+static volatile bool heat_save_pending;
+#endif
+
+#ifdef RGB_MATRIX_ENABLE
+static uint8_t  heat_level[RGB_MATRIX_LED_COUNT];
+static uint8_t  heat_active[RGB_MATRIX_LED_COUNT];
+static uint8_t  heat_active_count;
+static uint32_t heat_decay_time;
+
+uint16_t heatmap_decay_ms = HEATMAP_DECAY_MS;
+
+static void heatmap_decay(void) {
+    uint32_t steps = timer_elapsed32(heat_decay_time) / heatmap_decay_ms;
+
+    if (steps == 0) {
+        return;
+    }
+    heat_decay_time += steps * heatmap_decay_ms;
+
+    for (uint8_t i = 0; i < heat_active_count;) {
+        uint8_t led = heat_active[i];
+        if (heat_level[led] > steps) {
+            heat_level[led] -= steps;
+            i++;
+        } else {
+            heat_level[led] = 0;
+            heat_active[i]  = heat_active[--heat_active_count];
+        }
+    }
+}
+
+static void heatmap_heat(uint8_t led) {
+    if (heat_active_count == 0) {
+        heat_decay_time = timer_read32();
+    } else {
+        heatmap_decay();
+    }
+    if (heat_level[led] == 0) {
+        heat_active[heat_active_count++] = led;
+    }
+    heat_level[led] = qadd8(heat_level[led], HEATMAP_HEAT_STEP);
+}
+
+void heatmap_render(bool decay, uint8_t led_min, uint8_t led_max) {
+    if (decay) {
+        heatmap_decay();
+    }
+    for (uint8_t led = led_min; led < led_max; led++) {
+        if (heat_level[led] == 0) {
+            rgb_matrix_set_color(led, RGB_OFF);
+            continue;
+        }
+        // Blue when barely used, red when hot
+        HSV hsv = {170 - scale8(heat_level[led], 170), rgb_matrix_get_sat(), scale8(heat_level[led], rgb_matrix_get_val())};
+        RGB rgb = hsv_to_rgb(hsv);
+        rgb_matrix_set_color(led, rgb.r, rgb.g, rgb.b);
+    }
+}
+#endif
+
+HOT_PATH void heatmap_scan(void) {
+    uint8_t first = 0;
+    uint8_t count = MATRIX_ROWS;
+
+#ifdef SPLIT_KEYBOARD
+    first = is_keyboard_left() ? 0 : ROWS_PER_HAND;
+    count = ROWS_PER_HAND;
+#endif
+    for (uint8_t row = first; row < first + count; row++) {
+        matrix_row_t state   = matrix_get_row(row);
+        matrix_row_t pressed = state & ~heat_matrix[row];
+
+        heat_matrix[row] = state;
+        if (!pressed) {
+            continue;
+        }
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (!(pressed & ((matrix_row_t)1 << col))) {
+                continue;
+            }
+            if (heat_counts[row][col] < UINT16_MAX) {
+                heat_counts[row][col]++;
+                heat_dirty = true;
+            }
+#ifdef RGB_MATRIX_ENABLE
+            if (g_led_config.matrix_co[row][col] != NO_LED) {
+                heatmap_heat(g_led_config.matrix_co[row][col]);
+            }
+#endif
+        }
+    }
+}
+
+void heatmap_reset(void) {
+    memset(heat_counts, 0, sizeof(heat_counts));
+    heat_dirty = true;
+}
+
+// Starts a save, the rows follow from heatmap_task()
+void heatmap_save(void) {
+    uint8_t version = HEATMAP_VERSION;
+
+    eeconfig_update_kb_datablock(&version, EECONFIG_KB_HEATMAP_OFFSET, 1);
+    heat_save_row = 0;
+    heat_dirty    = false;
+    heat_saved_at = timer_read32();
+}
+
+void heatmap_task(void) {
+#if defined(VIA_ENABLE) && defined(SPLIT_KEYBOARD)
+    if (heat_reset_pending) {
+        heat_reset_pending = false;
+        heatmap_reset();
+    }
+    if (heat_save_pending) {
+        heat_save_pending = false;
+        heatmap_save();
+    }
+#endif
+    if (heat_save_row < 0) {
+        if (heat_dirty && timer_elapsed32(heat_saved_at) >= HEATMAP_SAVE_INTERVAL) {
+            heatmap_save();
+        }
+        return;
+    }
+    eeconfig_update_kb_datablock(heat_counts[heat_save_row], EECONFIG_KB_HEATMAP_OFFSET + 1 + heat_save_row * HEATMAP_ROW_SIZE, HEATMAP_ROW_SIZE);
+    if (++heat_save_row == MATRIX_ROWS) {
+        heat_save_row = -1;
+    }
+}
+
+#ifdef VIA_ENABLE
+static void heatmap_get_row(uint8_t row, uint8_t *out) {
+    for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+        out[2 * col]     = heat_counts[row][col] & 0xFF;
+        out[2 * col + 1] = heat_counts[row][col] >> 8;
+    }
+}
+
+#    ifdef SPLIT_KEYBOARD
+static void heatmap_slave_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
+    const heatmap_rpc_t *rpc = in_data;
+    uint8_t             *out = out_data;
+
+    out[0] = false;
+    if (in_buflen != sizeof(heatmap_rpc_t)) {
+        return;
+    }
+    switch (rpc->command) {
+        case id_custom_get_value:
+            if (rpc->value_id == id_heatmap_row && rpc->row < MATRIX_ROWS) {
+                heatmap_get_row(rpc->row, &out[1]);
+                out[0] = true;
+            }
+            break;
+        case id_custom_set_value:
+            if (rpc->value_id == id_heatmap_reset) {
+                heat_reset_pending = true;
+                out[0]             = true;
+            }
+            break;
+        case id_custom_save:
+            heat_save_pending = true;
+            out[0]            = true;
+            break;
+    }
+}
+
+// Runs a command on the slave, false when it did not answer. out, when
+// given, gets a row of its counts.
+static bool heatmap_remote(uint8_t command, uint8_t value_id, uint8_t row, uint8_t *out) {
+    heatmap_rpc_t rpc = {.command = command, .value_id = value_id, .row = row};
+    uint8_t       reply[1 + HEATMAP_ROW_SIZE];
+
+    if (!is_keyboard_master() || !transaction_rpc_exec(RPC_ID_KB_HEATMAP, sizeof(rpc), &rpc, sizeof(reply), reply) || !reply[0]) {
+        return false;
+    }
+    if (out) {
+        memcpy(out, &reply[1], HEATMAP_ROW_SIZE);
+    }
+    return true;
+}
+#    endif
+#endif
+
+void heatmap_init(void) {
+    uint8_t version;
+
+#if defined(VIA_ENABLE) && defined(SPLIT_KEYBOARD)
+    transaction_register_rpc(RPC_ID_KB_HEATMAP, heatmap_slave_handler);
+#endif
+    heat_saved_at = timer_read32();
+    if (!eeconfig_is_kb_datablock_valid()) {
+        return;
+    }
+    eeconfig_read_kb_datablock(&version, EECONFIG_KB_HEATMAP_OFFSET, 1);
+    if (version == HEATMAP_VERSION) {
+        eeconfig_read_kb_datablock(heat_counts, EECONFIG_KB_HEATMAP_OFFSET + 1, sizeof(heat_counts));
+    }
+}
+
+#ifdef VIA_ENABLE
+bool heatmap_via_command(uint8_t *data, uint8_t length) {
+    uint8_t *value_id   = &data[2];
+    uint8_t *value_data = &data[3];
+
+    switch (data[0]) {
+        case id_custom_get_value: {
+            if (*value_id != id_heatmap_row || value_data[0] >= MATRIX_ROWS || 4 + HEATMAP_ROW_SIZE > length) {
+                break;
+            }
+#    ifdef SPLIT_KEYBOARD
+            uint8_t this_hand = is_keyboard_left() ? 0 : ROWS_PER_HAND;
+            if (value_data[0] < this_hand || value_data[0] >= this_hand + ROWS_PER_HAND) {
+                return heatmap_remote(id_custom_get_value, *value_id, value_data[0], &value_data[1]);
+            }
+#    endif
+            heatmap_get_row(value_data[0], &value_data[1]);
+            return true;
+        }
+        case id_custom_set_value:
+            if (*value_id == id_heatmap_reset) {
+                heatmap_reset();
+#    ifdef SPLIT_KEYBOARD
+                return heatmap_remote(id_custom_set_value, *value_id, 0, NULL);
+#    else
+                return true;
+#    endif
+            }
+            break;
+        case id_custom_save:
+            heatmap_save();
+#    ifdef SPLIT_KEYBOARD
+            return heatmap_remote(id_custom_save, 0, 0, NULL);
+#    else
+            return true;
+#    endif
+    }
+    return false;
+}
+#endif
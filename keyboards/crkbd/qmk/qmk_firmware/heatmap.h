@@ -0,0 +1,43 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Heat added to a key's LEDs on every press, out of 255
+#ifndef HEATMAP_HEAT_STEP
+#    define HEATMAP_HEAT_STEP 32
+#endif
+
+// Time for the heat of a LED to drop by one
+#ifndef HEATMAP_DECAY_MS
+#    define HEATMAP_DECAY_MS 40
+#endif
+
+// Changed counts are saved at most this often
+#ifndef HEATMAP_SAVE_INTERVAL
+#    define HEATMAP_SAVE_INTERVAL 600000
+#endif
+
+// Value ids on the VIA custom channel. Rows count over both halves as in
+// the keymap, the other half answers for its own rows over the split link,
+// and reset and save apply to both halves.
+enum heatmap_value_id {
+    id_heatmap_row = 0x42, // get: row in data[3], 16-bit press count per column from data[4], little endian
+    id_heatmap_reset,      // set: clear all press counts
+};
+
+#ifdef RGB_MATRIX_ENABLE
+extern uint16_t heatmap_decay_ms;
+#endif
+
+// Loads the saved counts, and on a split takes requests from the master
+void heatmap_init(void);
+void heatmap_task(void);
+// Counts the presses of this half's rows, from every matrix scan
+void heatmap_scan(void);
+void heatmap_reset(void);
+void heatmap_save(void);
+#ifdef RGB_MATRIX_ENABLE
+void heatmap_render(bool decay, uint8_t led_min, uint8_t led_max);
+#endif
+bool heatmap_via_command(uint8_t *data, uint8_t length);
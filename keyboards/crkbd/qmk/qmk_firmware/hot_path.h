@@ -0,0 +1,11 @@
+#pragma once
+
+// Marks functions on the path from matrix scan to report. With
+// HOT_PATH_SRAM_ENABLE they are copied to SRAM at boot with the RP2040
+// time critical code, so they do not miss in the XIP cache. They are kept
+// out of line, inlined into a caller in flash they would run from flash.
+#ifdef HOT_PATH_SRAM_ENABLE
+#    define HOT_PATH __attribute__((noinline, section(".time_critical.hot_path")))
+#else
+#    define HOT_PATH
+#endif
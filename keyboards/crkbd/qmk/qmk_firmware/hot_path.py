@@ -0,0 +1,42 @@
+#!/usr/bin/env python3
+"""List the code a firmware runs from SRAM, with sizes.
+
+Built with HOT_PATH_SRAM_ENABLE = yes, the functions marked HOT_PATH are
+linked with the RP2040 time critical code at SRAM addresses, as is the
+cornelius rev2 scanner with MATRIX_BANK_SRAM = yes:
+
+    make hot-path elf=src/qmk/qmk_firmware/.build/tmp_crkbd_rev4_1_standard_via.elf
+"""
+
+import os
+import subprocess
+import sys
+
+SRAM_START = 0x20000000
+SRAM_END = 0x20042000
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(f'usage: {sys.argv[0]} firmware.elf')
+
+    nm = os.environ.get('NM', 'arm-none-eabi-nm')
+    out = subprocess.run([nm, '--print-size', '--size-sort', sys.argv[1]],
+                         check=True, capture_output=True, text=True).stdout
+
+    total = 0
+    for line in out.splitlines():
+        fields = line.split()
+        if len(fields) != 4 or fields[2] not in 'tTwW':
+            continue
+        address, size = int(fields[0], 16), int(fields[1], 16)
+        if SRAM_START <= address < SRAM_END:
+            print(f'{size:6} {fields[3]}')
+            total += size
+    if total == 0:
+        sys.exit('no code in SRAM, was the firmware built with HOT_PATH_SRAM_ENABLE = yes?')
+    print(f'{total:6} total')
+
+
+if __name__ == '__main__':
+    main()
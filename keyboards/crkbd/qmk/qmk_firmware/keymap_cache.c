@@ -0,0 +1,98 @@
+#include "quantum.h"
+#include "keymap_introspection.h"
+#include "keymap_cache.h"
+#include "hot_path.h"
+
+// For the active layers, every matrix position caches the topmost layer
+// that is not transparent there and its keycode. The action layer code
+// asks for each layer from the top until it finds a non transparent
+// entry, so known transparent layers answer KC_TRNS and the resolved
+// layer answers from the cache, without touching keymap storage.
+
+static uint16_t      cache_keycode[MATRIX_ROWS][MATRIX_COLS];
+static uint8_t       cache_layer[MATRIX_ROWS][MATRIX_COLS];
+static layer_state_t cache_state;
+static bool          cache_valid;
+
+static void keymap_cache_resolve(uint8_t row, uint8_t col) {
+    uint8_t  layer   = 0;
+    uint16_t keycode = keycode_at_keymap_location(0, row, col);
+
+    for (int8_t i = get_highest_layer(cache_state); i >= 0; i--) {
+        if (cache_state & ((layer_state_t)1 << i)) {
+            uint16_t candidate = keycode_at_keymap_location(i, row, col);
+            if (candidate != KC_TRNS) {
+                layer   = i;
+                keycode = candidate;
+                break;
+            }
+        }
+    }
+    cache_layer[row][col]   = layer;
+    cache_keycode[row][col] = keycode;
+}
+
+// Only positions resolved at or below the highest changed layer can
+// resolve differently, everything above it is left alone
+static void keymap_cache_refresh(layer_state_t state) {
+    layer_state_t changed = cache_valid ? state ^ cache_state : ~(layer_state_t)0;
+    uint8_t       highest = get_highest_layer(changed);
+
+    cache_state = state;
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (!cache_valid || cache_layer[row][col] <= highest) {
+                keymap_cache_resolve(row, col);
+            }
+        }
+    }
+    cache_valid = true;
+}
+
+void keymap_cache_invalidate(void) {
+    cache_valid = false;
+}
+
+void keymap_cache_update(layer_state_t state) {
+    if (!cache_valid || state != cache_state) {
+        keymap_cache_refresh(state);
+    }
+}
+
+// The layer state hooks keep the cache current. After a keymap edit it
+// stays invalid until the next layer change, and lookups go to storage.
+static uint16_t keymap_cache_lookup(uint8_t layer, uint8_t row, uint8_t col) {
+    if (!cache_valid) {
+        return keycode_at_keymap_location(layer, row, col);
+    }
+    if (layer == cache_layer[row][col]) {
+        return cache_keycode[row][col];
+    }
+    if (layer > cache_layer[row][col] && (cache_state & ((layer_state_t)1 << layer))) {
+        return KC_TRNS;
+    }
+    // Inactive layers, e.g. the source layer of a key released after a
+    // layer change, come straight from storage
+    return keycode_at_keymap_location(layer, row, col);
+}
+
+HOT_PATH uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key) {
+    if (key.row < MATRIX_ROWS && key.col < MATRIX_COLS) {
+        uint16_t keycode = keymap_cache_lookup(layer, key.row, key.col);
+#ifdef KEYMAP_CACHE_VERIFY
+        uint16_t expected = keycode_at_keymap_location(layer, key.row, key.col);
+        if (keycode != expected) {
+            dprintf("keymap cache: %ux%u layer %u got %04X expected %04X\n", key.row, key.col, layer, keycode, expected);
+        }
+#endif
+        return keycode;
+    }
+#ifdef ENCODER_MAP_ENABLE
+    else if (key.row == KEYLOC_ENCODER_CW && key.col < NUM_ENCODERS) {
+        return keycode_at_encodermap_location(layer, key.col, true);
+    } else if (key.row == KEYLOC_ENCODER_CCW && key.col < NUM_ENCODERS) {
+        return keycode_at_encodermap_location(layer, key.col, false);
+    }
+#endif
+    return KC_NO;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdint.h>
+#include "action_layer.h"
+
+// Compare every cached lookup with a walk through the keymap storage
+// and print mismatches, for checking the cache on a live board
+// #define KEYMAP_CACHE_VERIFY
+
+void keymap_cache_invalidate(void);
+
+// Takes the combined layer_state | default_layer_state
+void keymap_cache_update(layer_state_t state);
@@ -1,2 +1,10 @@
 VIA_ENABLE         = yes
-ENCODER_MAP_ENABLE = yes
\ No newline at end of file
+ENCODER_MAP_ENABLE = yes
+
+# Leader sequences from sequences.txt, the leader is on the adjust layer
+ifeq ($(strip $(MCU)), RP2040)
+    SEQUENCE_ENABLE = yes
+endif
+
+# Animated logo on the non-master OLED, from the frames in logo/
+LOGO_ANIM_ENABLE = yes
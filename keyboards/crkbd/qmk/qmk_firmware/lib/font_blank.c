@@ -0,0 +1,8 @@
+// Driver font of builds that draw their text from the glyph atlas. Only
+// the space is left, the driver draws every other character blank.
+
+#include "progmem.h"
+
+const unsigned char font[] PROGMEM = {
+0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+};
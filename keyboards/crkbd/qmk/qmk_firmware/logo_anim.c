@@ -0,0 +1,58 @@
+#include "quantum.h"
+#include "logo_anim.h"
+#include "logo_anim_data.h"
+
+// The stream format is described in logo_anim.py. Deltas are decoded
+// straight into the OLED buffer, which only marks the blocks whose bytes
+// actually change, so a frame costs what it changes.
+
+_Static_assert(LOGO_ANIM_WIDTH == OLED_DISPLAY_WIDTH && LOGO_ANIM_HEIGHT == OLED_DISPLAY_HEIGHT, "Animation frames must match the display");
+
+static bool     anim_started;
+static uint8_t  anim_frame;
+static uint16_t anim_timer;
+
+static void logo_anim_apply(uint8_t step) {
+    uint16_t pos   = pgm_read_word(&logo_anim_offsets[step]);
+    uint16_t index = 0;
+
+    for (;;) {
+        uint8_t op = pgm_read_byte(&logo_anim_data[pos++]);
+        if (op == 0) {
+            return;
+        }
+        if (op < 0x80) {
+            index += op;
+        } else if (op < 0xC0) {
+            for (uint8_t n = op - 0x7F; n; n--) {
+                oled_write_raw_byte(pgm_read_byte(&logo_anim_data[pos++]), index++);
+            }
+        } else {
+            uint8_t data = pgm_read_byte(&logo_anim_data[pos++]);
+            for (uint8_t n = op - 0xBF; n; n--) {
+                oled_write_raw_byte(data, index++);
+            }
+        }
+    }
+}
+
+void oled_render_logo(void) {
+    if (!anim_started) {
+        logo_anim_apply(0);
+        anim_started = true;
+        anim_frame   = 0;
+        anim_timer   = timer_read();
+        return;
+    }
+
+    if (timer_elapsed(anim_timer) < LOGO_ANIM_FRAME_MS) {
+        return;
+    }
+
+    // A late loop still moves on by a single frame and restarts the
+    // timer, so time lost to a slow loop costs no decoding. The logo keeps
+    // no wall clock, it only plays a little slower.
+    anim_timer = timer_read();
+    anim_frame = (anim_frame + 1) % LOGO_ANIM_FRAMES;
+    logo_anim_apply(anim_frame == 0 ? LOGO_ANIM_FRAMES : anim_frame);
+}
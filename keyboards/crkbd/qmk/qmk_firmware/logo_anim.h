@@ -0,0 +1,9 @@
+#pragma once
+
+// Time each animation frame stays on screen
+#ifndef LOGO_ANIM_FRAME_MS
+#    define LOGO_ANIM_FRAME_MS 100
+#endif
+
+// Replaces the static logo of oled_render_logo on the non-master half
+void oled_render_logo(void);
@@ -0,0 +1,147 @@
+#!/usr/bin/env python3
+"""Generate the delta compressed OLED animation played by logo_anim.c.
+
+Frames are PBM images (P1 or P4) the size of the display, played in file
+name order. Each frame is stored as the changes from the frame before,
+in the OLED buffer layout of one byte per 8 pixel column of a page:
+
+    0x00        end of frame
+    0x01-0x7F   skip that many unchanged bytes
+    0x80-0xBF   copy the next 1-64 bytes
+    0xC0-0xFF   repeat the next byte 1-64 times
+
+The first entry draws frame 0 over a blank buffer, and the last one
+takes the last frame back to frame 0, so playback loops on deltas only.
+
+The compression ratio and the decode work per frame go to stderr.
+"""
+
+import sys
+
+MAX_RUN = 64
+MAX_SKIP = 0x7F
+
+
+def read_pbm(path, width, height):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    tokens = []
+    pos = 0
+    # Magic, width and height, skipping comments
+    while len(tokens) < 3:
+        while data[pos:pos + 1].isspace():
+            pos += 1
+        if data[pos:pos + 1] == b'#':
+            pos = data.index(b'\n', pos)
+            continue
+        start = pos
+        while not data[pos:pos + 1].isspace():
+            pos += 1
+        tokens.append(data[start:pos].decode())
+    magic, w, h = tokens[0], int(tokens[1]), int(tokens[2])
+    if (w, h) != (width, height):
+        sys.exit(f'{path}: {w}x{h}, expected {width}x{height}')
+
+    if magic == 'P1':
+        bits = [int(c) for c in data[pos:].decode() if c in '01']
+    elif magic == 'P4':
+        stride = (width + 7) // 8
+        raw = data[pos + 1:]
+        bits = [(raw[y * stride + x // 8] >> (7 - x % 8)) & 1 for y in range(height) for x in range(width)]
+    else:
+        sys.exit(f'{path}: only P1 and P4 PBM files are supported')
+    if len(bits) < width * height:
+        sys.exit(f'{path}: truncated image')
+
+    buffer = [0] * (width * height // 8)
+    for y in range(height):
+        for x in range(width):
+            if bits[y * width + x]:
+                buffer[(y // 8) * width + x] |= 1 << (y % 8)
+    return buffer
+
+
+def encode(previous, frame):
+    ops = []
+    i = 0
+    while i < len(frame):
+        if frame[i] == previous[i]:
+            skip = 1
+            while i + skip < len(frame) and frame[i + skip] == previous[i + skip]:
+                skip += 1
+            i += skip
+            # A skip to the end needs no op
+            if i < len(frame):
+                while skip:
+                    ops.append(min(skip, MAX_SKIP))
+                    skip -= ops[-1]
+            continue
+
+        repeat = 1
+        while i + repeat < len(frame) and repeat < MAX_RUN and frame[i + repeat] == frame[i]:
+            repeat += 1
+        if repeat >= 3:
+            ops += [0xBF + repeat, frame[i]]
+            i += repeat
+            continue
+
+        # Literal run up to the next unchanged byte or a run worth repeating
+        end = i
+        while end < len(frame) and end - i < MAX_RUN and frame[end] != previous[end]:
+            if end + 2 < len(frame) and frame[end] == frame[end + 1] == frame[end + 2]:
+                break
+            end += 1
+        end = max(end, i + 1)
+        ops += [0x7F + end - i] + frame[i:end]
+        i = end
+    return ops + [0]
+
+
+def array(values):
+    lines = []
+    for i in range(0, len(values), 16):
+        lines.append('    ' + ', '.join(f'0x{v:02X}' for v in values[i:i + 16]) + ',')
+    return '\n'.join(lines)
+
+
+def main():
+    if len(sys.argv) < 5:
+        sys.exit(f'usage: {sys.argv[0]} width height logo_anim_data.h frame.pbm...')
+
+    width, height = int(sys.argv[1]), int(sys.argv[2])
+    frames = [read_pbm(path, width, height) for path in sorted(sys.argv[4:])]
+
+    blank = [0] * len(frames[0])
+    steps = [(blank, frames[0])]
+    steps += [(frames[i - 1], frames[i]) for i in range(1, len(frames))]
+    steps.append((frames[-1], frames[0]))
+
+    data = []
+    offsets = []
+    for previous, frame in steps:
+        offsets.append(len(data))
+        data += encode(previous, frame)
+    if len(data) > 0xFFFF:
+        sys.exit('logo animation exceeds 64 KiB')
+
+    raw = len(frames) * len(blank)
+    stored = len(data) + 2 * len(offsets)
+    sizes = [offsets[i + 1] - offsets[i] for i in range(1, len(offsets) - 1)] + [len(data) - offsets[-1]]
+    print(f'logo animation: {len(frames)} frames in {stored} bytes, raw {raw} bytes, '
+          f'ratio {raw / stored:.1f}:1; a frame decodes {sum(sizes) / len(sizes):.0f} bytes on average, '
+          f'{max(sizes)} at most', file=sys.stderr)
+
+    with open(sys.argv[3], 'w', encoding='utf-8') as f:
+        f.write('// Generated by logo_anim.py, do not edit\n')
+        f.write('#pragma once\n\n')
+        f.write(f'#define LOGO_ANIM_WIDTH {width}\n')
+        f.write(f'#define LOGO_ANIM_HEIGHT {height}\n')
+        f.write(f'#define LOGO_ANIM_FRAMES {len(frames)}\n\n')
+        f.write('static const uint16_t logo_anim_offsets[] PROGMEM = {\n    '
+                + ', '.join(str(o) for o in offsets) + ',\n};\n\n')
+        f.write('static const uint8_t logo_anim_data[] PROGMEM = {\n' + array(data) + '\n};\n')
+
+
+if __name__ == '__main__':
+    main()
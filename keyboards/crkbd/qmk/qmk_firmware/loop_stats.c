@@ -0,0 +1,45 @@
+#include "quantum.h"
+#include "loop_stats.h"
+
+// Main loop period from the ChibiOS system timer, which ticks in
+// microseconds on the RP2040. Called once per loop from housekeeping. The
+// report says where the hot path runs from, so logs of builds with and
+// without HOT_PATH_SRAM_ENABLE tell themselves apart.
+
+#ifdef HOT_PATH_SRAM_ENABLE
+#    define LOOP_STATS_HOT_PATH "sram"
+#else
+#    define LOOP_STATS_HOT_PATH "flash"
+#endif
+
+static systime_t loop_last;
+static uint32_t  loop_sum;
+static uint32_t  loop_min = UINT32_MAX;
+static uint32_t  loop_max;
+static uint32_t  loop_count;
+static uint16_t  loop_timer;
+
+void loop_stats_task(void) {
+    systime_t now    = chVTGetSystemTimeX();
+    uint32_t  period = TIME_I2US(chTimeDiffX(loop_last, now));
+
+    loop_last = now;
+    loop_sum += period;
+    loop_count++;
+    if (period < loop_min) {
+        loop_min = period;
+    }
+    if (period > loop_max) {
+        loop_max = period;
+    }
+
+    if (timer_elapsed(loop_timer) < LOOP_STATS_INTERVAL) {
+        return;
+    }
+    loop_timer = timer_read();
+    dprintf("loop, hot path in " LOOP_STATS_HOT_PATH ": %lu loops, %lu us average, %lu min, %lu max, %lu jitter\n", loop_count, loop_sum / loop_count, loop_min, loop_max, loop_max - loop_min);
+    loop_sum   = 0;
+    loop_count = 0;
+    loop_min   = UINT32_MAX;
+    loop_max   = 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#ifndef LOOP_STATS_INTERVAL
+#    define LOOP_STATS_INTERVAL 1000
+#endif
+
+void loop_stats_task(void);
@@ -0,0 +1,333 @@
+#include "quantum.h"
+#include "eeconfig.h"
+#include "macro_arena.h"
+
+// Every event starts with a header byte:
+//   bit 7     pressed
+//   bit 6     same keycode as the previous event, no keycode follows
+//   bits 0-5  delay since the previous event in ms, 63 means a varint
+//             with the remainder follows the keycode
+// Keycodes are stored as varints, so a basic key press takes two bytes
+// and its release one.
+
+#define MACRO_ARENA_PRESSED 0x80
+#define MACRO_ARENA_SAME 0x40
+#define MACRO_ARENA_DELAY 0x3F
+#define MACRO_ARENA_EVENT_MAX 7
+
+// A release of a key that is still down: header and a full keycode
+#define MACRO_ARENA_RELEASE_MAX 4
+
+#define MACRO_ARENA_VERSION 1
+#define MACRO_ARENA_HEADER_SIZE (1 + 2 * MACRO_ARENA_SLOTS)
+
+static uint8_t  arena[MACRO_ARENA_SIZE];
+static uint16_t arena_used;
+static uint16_t slot_start[MACRO_ARENA_SLOTS];
+static uint16_t slot_length[MACRO_ARENA_SLOTS];
+
+static int8_t   recording = -1;
+static uint16_t record_keycode;
+static uint16_t record_time;
+static uint16_t record_down[MACRO_ARENA_DOWN_MAX];
+static uint8_t  record_down_count;
+
+static bool     replaying;
+static bool     replay_realtime = MACRO_ARENA_REPLAY_REALTIME;
+static uint16_t replay_pos;
+static uint16_t replay_end;
+static uint16_t replay_keycode;
+static uint16_t replay_time;
+
+static uint8_t macro_arena_put_varint(uint8_t *out, uint16_t value) {
+    uint8_t n = 0;
+    while (value >= 0x80) {
+        out[n++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    out[n++] = value;
+    return n;
+}
+
+static uint16_t macro_arena_get_varint(uint16_t *pos) {
+    uint16_t value = 0;
+    uint8_t  shift = 0;
+    uint8_t  byte;
+    do {
+        byte = arena[(*pos)++];
+        value |= (uint16_t)(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+    return value;
+}
+
+#if (EECONFIG_KB_MACRO_ARENA_SIZE) > 0
+// Saving runs from housekeeping, a chunk per pass. The header is marked
+// invalid first and written last, so a save cut short leaves no slots.
+static bool     save_pending;
+static uint16_t save_pos;
+
+static uint8_t macro_arena_save_byte(uint16_t pos) {
+    if (pos == 0) {
+        return MACRO_ARENA_VERSION;
+    }
+    if (pos < MACRO_ARENA_HEADER_SIZE) {
+        uint16_t length = slot_length[(pos - 1) / 2];
+        return pos % 2 ? length & 0xFF : length >> 8;
+    }
+    // Slots are written in order, the arena may hold them in any order
+    pos -= MACRO_ARENA_HEADER_SIZE;
+    for (uint8_t i = 0; i < MACRO_ARENA_SLOTS; i++) {
+        if (pos < slot_length[i]) {
+            return arena[slot_start[i] + pos];
+        }
+        pos -= slot_length[i];
+    }
+    return 0;
+}
+
+static void macro_arena_save_chunk(void) {
+    uint16_t end = MACRO_ARENA_HEADER_SIZE + arena_used;
+    uint8_t  chunk[MACRO_ARENA_SAVE_CHUNK];
+    uint8_t  n = 0;
+
+    if (end > EECONFIG_KB_MACRO_ARENA_SIZE) {
+        dprintf("macro arena: %u bytes do not fit in EEPROM\n", arena_used);
+        save_pending = false;
+        return;
+    }
+    if (save_pos == 0) {
+        uint8_t invalid = 0;
+        eeconfig_update_kb_datablock(&invalid, EECONFIG_KB_MACRO_ARENA_OFFSET, 1);
+        save_pos = 1;
+        return;
+    }
+    if (save_pos == end) {
+        chunk[0] = MACRO_ARENA_VERSION;
+        eeconfig_update_kb_datablock(chunk, EECONFIG_KB_MACRO_ARENA_OFFSET, 1);
+        save_pending = false;
+        return;
+    }
+    while (n < sizeof(chunk) && save_pos + n < end) {
+        chunk[n] = macro_arena_save_byte(save_pos + n);
+        n++;
+    }
+    eeconfig_update_kb_datablock(chunk, EECONFIG_KB_MACRO_ARENA_OFFSET + save_pos, n);
+    save_pos += n;
+}
+
+static void macro_arena_load(void) {
+    uint8_t header[MACRO_ARENA_HEADER_SIZE];
+
+    if (!eeconfig_is_kb_datablock_valid()) {
+        return;
+    }
+    eeconfig_read_kb_datablock(header, EECONFIG_KB_MACRO_ARENA_OFFSET, sizeof(header));
+    if (header[0] != MACRO_ARENA_VERSION) {
+        return;
+    }
+
+    uint16_t used = 0;
+    for (uint8_t i = 0; i < MACRO_ARENA_SLOTS; i++) {
+        slot_start[i]  = used;
+        slot_length[i] = header[1 + 2 * i] | (uint16_t)header[2 + 2 * i] << 8;
+        used += slot_length[i];
+    }
+    if (used > MACRO_ARENA_SIZE || MACRO_ARENA_HEADER_SIZE + used > EECONFIG_KB_MACRO_ARENA_SIZE) {
+        memset(slot_length, 0, sizeof(slot_length));
+        return;
+    }
+    eeconfig_read_kb_datablock(arena, EECONFIG_KB_MACRO_ARENA_OFFSET + sizeof(header), used);
+    arena_used = used;
+}
+#endif
+
+// Removes a slot and closes the gap, so new recordings always append
+static void macro_arena_clear(uint8_t slot) {
+    uint16_t start  = slot_start[slot];
+    uint16_t length = slot_length[slot];
+
+    if (length == 0) {
+        return;
+    }
+    memmove(&arena[start], &arena[start + length], arena_used - start - length);
+    arena_used -= length;
+    slot_length[slot] = 0;
+    for (uint8_t i = 0; i < MACRO_ARENA_SLOTS; i++) {
+        if (slot_start[i] > start) {
+            slot_start[i] -= length;
+        }
+    }
+}
+
+static uint8_t macro_arena_encode(uint8_t *event, uint16_t keycode, bool pressed, uint16_t delay) {
+    uint8_t n = 1;
+
+    event[0] = pressed ? MACRO_ARENA_PRESSED : 0;
+    if (arena_used != slot_start[recording] && keycode == record_keycode) {
+        event[0] |= MACRO_ARENA_SAME;
+    } else {
+        n += macro_arena_put_varint(&event[n], keycode);
+    }
+    if (delay < MACRO_ARENA_DELAY) {
+        event[0] |= delay;
+    } else {
+        event[0] |= MACRO_ARENA_DELAY;
+        n += macro_arena_put_varint(&event[n], delay - MACRO_ARENA_DELAY);
+    }
+    return n;
+}
+
+static void macro_arena_append(const uint8_t *event, uint8_t n, uint16_t keycode, bool pressed) {
+    memcpy(&arena[arena_used], event, n);
+    arena_used += n;
+    record_keycode = keycode;
+
+    if (pressed) {
+        record_down[record_down_count++] = keycode;
+        return;
+    }
+    for (uint8_t i = 0; i < record_down_count; i++) {
+        if (record_down[i] == keycode) {
+            record_down[i] = record_down[--record_down_count];
+            break;
+        }
+    }
+}
+
+// Keys still down are released in the recording, so a replay never ends
+// with a key held. Room for that is kept free while recording.
+static void macro_arena_stop_recording(void) {
+    while (record_down_count) {
+        uint8_t  event[MACRO_ARENA_EVENT_MAX];
+        uint16_t keycode = record_down[record_down_count - 1];
+        uint8_t  n       = macro_arena_encode(event, keycode, false, 0);
+        macro_arena_append(event, n, keycode, false);
+    }
+    slot_length[recording] = arena_used - slot_start[recording];
+    dprintf("macro arena: slot %d recorded %u bytes, %u/%u used\n", recording, slot_length[recording], arena_used, MACRO_ARENA_SIZE);
+    recording = -1;
+#if (EECONFIG_KB_MACRO_ARENA_SIZE) > 0
+    save_pending = true;
+    save_pos     = 0;
+#endif
+}
+
+static void macro_arena_record(uint16_t keycode, keyrecord_t *record) {
+    uint8_t  event[MACRO_ARENA_EVENT_MAX];
+    uint16_t delay = arena_used == slot_start[recording] ? 0 : TIMER_DIFF_16(record->event.time, record_time);
+    bool     down  = false;
+
+    for (uint8_t i = 0; i < record_down_count; i++) {
+        down |= record_down[i] == keycode;
+    }
+    // A release of a key pressed before recording started, or a press
+    // repeated without its release, has nothing to pair with
+    if (record->event.pressed == down) {
+        return;
+    }
+
+    uint8_t n       = macro_arena_encode(event, keycode, record->event.pressed, delay);
+    uint8_t pending = record_down_count + (record->event.pressed ? 1 : -1);
+
+    if ((record->event.pressed && record_down_count == MACRO_ARENA_DOWN_MAX) || arena_used + n + pending * MACRO_ARENA_RELEASE_MAX > MACRO_ARENA_SIZE) {
+        dprintf("macro arena: full\n");
+        macro_arena_stop_recording();
+        return;
+    }
+    macro_arena_append(event, n, keycode, record->event.pressed);
+    record_time = record->event.time;
+}
+
+static void macro_arena_play(uint8_t slot) {
+    replaying      = slot_length[slot] > 0;
+    replay_pos     = slot_start[slot];
+    replay_end     = slot_start[slot] + slot_length[slot];
+    replay_keycode = KC_NO;
+    replay_time    = timer_read();
+}
+
+void macro_arena_set_realtime(bool realtime) {
+    replay_realtime = realtime;
+}
+
+void macro_arena_init(void) {
+#if (EECONFIG_KB_MACRO_ARENA_SIZE) > 0
+    macro_arena_load();
+#endif
+}
+
+void macro_arena_task(void) {
+#if (EECONFIG_KB_MACRO_ARENA_SIZE) > 0
+    if (save_pending && recording < 0) {
+        macro_arena_save_chunk();
+    }
+#endif
+    while (replaying) {
+        uint16_t pos    = replay_pos;
+        uint8_t  header = arena[pos++];
+        uint16_t delay  = header & MACRO_ARENA_DELAY;
+
+        if (!(header & MACRO_ARENA_SAME)) {
+            replay_keycode = macro_arena_get_varint(&pos);
+        }
+        if (delay == MACRO_ARENA_DELAY) {
+            delay += macro_arena_get_varint(&pos);
+        }
+        if (replay_realtime && timer_elapsed(replay_time) < delay) {
+            return;
+        }
+
+        replay_pos  = pos;
+        replay_time = timer_read();
+        replaying   = replay_pos < replay_end;
+        if (header & MACRO_ARENA_PRESSED) {
+            register_code16(replay_keycode);
+        } else {
+            unregister_code16(replay_keycode);
+        }
+        if (!replaying) {
+            clear_keyboard();
+            return;
+        }
+        if (!replay_realtime) {
+            // One report per loop keeps the host and the matrix scan in step
+            return;
+        }
+    }
+}
+
+bool process_macro_arena(uint16_t keycode, keyrecord_t *record) {
+    switch (keycode) {
+        case QK_DYNAMIC_MACRO_RECORD_START_1:
+        case QK_DYNAMIC_MACRO_RECORD_START_2:
+            if (record->event.pressed) {
+                uint8_t slot = keycode - QK_DYNAMIC_MACRO_RECORD_START_1;
+                if (recording >= 0) {
+                    macro_arena_stop_recording();
+                } else if (!replaying) {
+                    macro_arena_clear(slot);
+                    slot_start[slot]  = arena_used;
+                    recording         = slot;
+                    record_down_count = 0;
+                }
+            }
+            return false;
+        case QK_DYNAMIC_MACRO_RECORD_STOP:
+            if (record->event.pressed && recording >= 0) {
+                macro_arena_stop_recording();
+            }
+            return false;
+        case QK_DYNAMIC_MACRO_PLAY_1:
+        case QK_DYNAMIC_MACRO_PLAY_2:
+            if (record->event.pressed && recording < 0) {
+                macro_arena_play(keycode - QK_DYNAMIC_MACRO_PLAY_1);
+            }
+            return false;
+    }
+
+    if (recording >= 0 && (IS_QK_BASIC(keycode) || IS_QK_MODS(keycode))) {
+        macro_arena_record(keycode, record);
+    }
+    return true;
+}
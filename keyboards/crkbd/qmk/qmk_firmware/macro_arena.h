@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "action.h"
+
+// RAM shared by all recorded macros
+#ifndef MACRO_ARENA_SIZE
+#    ifdef __AVR__
+#        define MACRO_ARENA_SIZE 128
+#    else
+#        define MACRO_ARENA_SIZE 2048
+#    endif
+#endif
+
+// DM_REC1/DM_PLY1 and DM_REC2/DM_PLY2
+#define MACRO_ARENA_SLOTS 2
+
+// Keys recorded as held at the same time
+#ifndef MACRO_ARENA_DOWN_MAX
+#    define MACRO_ARENA_DOWN_MAX 8
+#endif
+
+// EEPROM bytes written per housekeeping pass when saving
+#ifndef MACRO_ARENA_SAVE_CHUNK
+#    define MACRO_ARENA_SAVE_CHUNK 32
+#endif
+
+// Replay with the recorded delays instead of as fast as possible
+#ifndef MACRO_ARENA_REPLAY_REALTIME
+#    define MACRO_ARENA_REPLAY_REALTIME true
+#endif
+
+void macro_arena_init(void);
+void macro_arena_task(void);
+void macro_arena_set_realtime(bool realtime);
+bool process_macro_arena(uint16_t keycode, keyrecord_t *record);
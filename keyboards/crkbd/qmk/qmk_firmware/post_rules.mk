@@ -0,0 +1,213 @@
+# Keyboard level features, evaluated after the keymap rules.mk
+CRKBD_PATH := $(patsubst %/,%,$(dir $(lastword $(MAKEFILE_LIST))))
+
+# Coalesce encoder map detents into one accelerated step per frame
+ENCODER_ACCEL_ENABLE ?= yes
+ifeq ($(strip $(ENCODER_MAP_ENABLE)), yes)
+    ifeq ($(strip $(ENCODER_ACCEL_ENABLE)), yes)
+        SRC += encoder_accel.c
+        OPT_DEFS += -DENCODER_ACCEL_ENABLE
+    endif
+endif
+
+# Per-key tap-hold policies. Streak taps send tap-hold keys pressed while
+# typing as taps right away, they need record->keycode, which the core
+# only reads back with combos.
+TAP_HOLD_RESOLVER_ENABLE ?= no
+TAP_HOLD_STREAK_ENABLE ?= no
+ifeq ($(strip $(TAP_HOLD_RESOLVER_ENABLE)), yes)
+    SRC += tap_hold.c
+    OPT_DEFS += -DTAP_HOLD_RESOLVER_ENABLE -DPERMISSIVE_HOLD_PER_KEY -DHOLD_ON_OTHER_KEY_PRESS_PER_KEY
+    ifeq ($(strip $(TAP_HOLD_STREAK_ENABLE)), yes)
+        ifeq ($(strip $(COMBO_ENABLE)), yes)
+            OPT_DEFS += -DTAP_HOLD_STREAK_ENABLE
+        else
+            $(warning TAP_HOLD_STREAK_ENABLE needs COMBO_ENABLE, streak taps are off)
+        endif
+    endif
+endif
+
+# Position indexed matching for the Vial combo table
+COMBO_INDEX_ENABLE ?= yes
+ifeq ($(strip $(VIAL_ENABLE)), yes)
+    ifeq ($(strip $(COMBO_INDEX_ENABLE)), yes)
+        SRC += combo_index.c
+        OPT_DEFS += -DCOMBO_INDEX_ENABLE
+    endif
+endif
+
+# String sender that packs several keys into each report, for leader
+# sequences and VIA macros
+FAST_SEND_ENABLE ?= no
+ifeq ($(strip $(FAST_SEND_ENABLE)), yes)
+    SRC += fast_send.c
+    OPT_DEFS += -DFAST_SEND_ENABLE
+endif
+
+# Leader sequences from the keymap's sequences.txt, compiled into a trie
+SEQUENCE_ENABLE ?= no
+ifeq ($(strip $(SEQUENCE_ENABLE)), yes)
+    SEQUENCE_DEFS := $(wildcard $(KEYMAP_PATH)/sequences.txt)
+    ifneq ($(SEQUENCE_DEFS),)
+        $(shell mkdir -p $(INTERMEDIATE_OUTPUT)/src && python3 $(CRKBD_PATH)/sequence_trie.py $(SEQUENCE_DEFS) $(INTERMEDIATE_OUTPUT)/src/sequence_data.h)
+        VPATH += $(INTERMEDIATE_OUTPUT)/src
+        SRC += sequence.c
+        OPT_DEFS += -DSEQUENCE_ENABLE
+    else
+        $(warning SEQUENCE_ENABLE needs a sequences.txt in the keymap, sequences are off)
+    endif
+endif
+
+# Dynamic macros recorded into a compact RAM arena, for VIA and Vial keymaps
+MACRO_ARENA_ENABLE ?= no
+ifeq ($(strip $(MACRO_ARENA_ENABLE)), yes)
+    SRC += macro_arena.c
+    OPT_DEFS += -DMACRO_ARENA_ENABLE
+endif
+
+# Per-key keycodes resolved once per layer state instead of on every press
+KEYMAP_CACHE_ENABLE ?= yes
+ifeq ($(strip $(KEYMAP_CACHE_ENABLE)), yes)
+    SRC += keymap_cache.c
+    OPT_DEFS += -DKEYMAP_CACHE_ENABLE
+endif
+
+# Per-key debounce windows tuned from the bounce each switch shows
+ADAPTIVE_DEBOUNCE_ENABLE ?= no
+ifeq ($(strip $(ADAPTIVE_DEBOUNCE_ENABLE)), yes)
+    DEBOUNCE_TYPE = custom
+    SRC += adaptive_debounce.c
+    OPT_DEFS += -DADAPTIVE_DEBOUNCE_ENABLE
+endif
+
+# Per-key press counts, shown by the usage_heatmap RGB matrix effect
+HEATMAP_ENABLE ?= no
+ifeq ($(strip $(HEATMAP_ENABLE)), yes)
+    SRC += heatmap.c
+    OPT_DEFS += -DHEATMAP_ENABLE
+    RGB_MATRIX_CUSTOM_KB = yes
+endif
+
+# Keyboard status text drawn from a compressed atlas of the lib/glcdfont.c
+# glyphs listed in OLED_FONT_ATLAS_GLYPHS, as hex ranges, proportional on
+# the master. The driver font is cut down to lib/font_blank.c, so keymap
+# text has to go through font_atlas_* as well.
+OLED_FONT_ATLAS_ENABLE ?= no
+OLED_FONT_ATLAS_GLYPHS ?= 20-7e,80-94,a0-b4,c0-d4
+ifeq ($(strip $(OLED_ENABLE)), yes)
+    ifeq ($(strip $(OLED_FONT_ATLAS_ENABLE)), yes)
+        $(shell mkdir -p $(INTERMEDIATE_OUTPUT)/src && python3 $(CRKBD_PATH)/font_atlas.py $(CRKBD_PATH)/lib/glcdfont.c $(INTERMEDIATE_OUTPUT)/src/font_atlas_data.h $(OLED_FONT_ATLAS_GLYPHS))
+        VPATH += $(INTERMEDIATE_OUTPUT)/src
+        SRC += font_atlas.c
+        OPT_DEFS += -DOLED_FONT_ATLAS_ENABLE
+        OPT_DEFS += -DOLED_FONT_H=\"$(CRKBD_PATH)/lib/font_blank.c\" -DOLED_FONT_START=32 -DOLED_FONT_END=32
+    endif
+endif
+
+# Animated logo on the non-master OLED, from the keymap's logo/*.pbm frames
+LOGO_ANIM_ENABLE ?= no
+LOGO_ANIM_SIZE ?= 128 32
+ifeq ($(strip $(OLED_ENABLE)), yes)
+    ifeq ($(strip $(LOGO_ANIM_ENABLE)), yes)
+        LOGO_ANIM_FRAMES := $(sort $(wildcard $(KEYMAP_PATH)/logo/*.pbm))
+        ifneq ($(LOGO_ANIM_FRAMES),)
+            $(shell mkdir -p $(INTERMEDIATE_OUTPUT)/src && python3 $(CRKBD_PATH)/logo_anim.py $(LOGO_ANIM_SIZE) $(INTERMEDIATE_OUTPUT)/src/logo_anim_data.h $(LOGO_ANIM_FRAMES))
+            VPATH += $(INTERMEDIATE_OUTPUT)/src
+            SRC += logo_anim.c
+            OPT_DEFS += -DLOGO_ANIM_ENABLE
+        endif
+    endif
+endif
+
+# Secondary split state sent by priority in the bandwidth the matrix leaves
+SPLIT_SCHED_ENABLE ?= yes
+ifeq ($(strip $(SPLIT_KEYBOARD)), yes)
+    ifeq ($(strip $(SPLIT_SCHED_ENABLE)), yes)
+        SRC += split_sched.c
+        OPT_DEFS += -DSPLIT_SCHED_ENABLE
+    endif
+endif
+
+# Drift of the slave's synced timer, which RGB effects render from,
+# measured from the master against RGB_DRIFT_MAX
+RGB_DRIFT_ENABLE ?= yes
+ifeq ($(strip $(RGB_MATRIX_ENABLE) $(SPLIT_KEYBOARD) $(RGB_DRIFT_ENABLE)), yes yes yes)
+    SRC += rgb_drift.c
+    OPT_DEFS += -DRGB_DRIFT_ENABLE
+endif
+
+# Split link drops counted, and a full resend of the scheduled state when
+# the other half is back
+SPLIT_LINK_ENABLE ?= yes
+ifeq ($(strip $(SPLIT_KEYBOARD)), yes)
+    ifeq ($(strip $(SPLIT_LINK_ENABLE)), yes)
+        SRC += split_link.c
+        OPT_DEFS += -DSPLIT_LINK_ENABLE
+    endif
+endif
+
+# Cycles of the AVR soft serial transactions on the console, timed from
+# the master, to compare SELECT_SOFT_SERIAL_SPEED settings
+SPLIT_SERIAL_STATS_ENABLE ?= no
+ifneq ($(findstring atmega, $(MCU)),)
+    ifeq ($(strip $(SPLIT_KEYBOARD) $(SPLIT_SERIAL_STATS_ENABLE)), yes yes)
+        CONSOLE_ENABLE = yes
+        SRC += split_serial_stats.c
+        OPT_DEFS += -DSPLIT_SERIAL_STATS_ENABLE
+    endif
+endif
+
+# Functions marked HOT_PATH run from SRAM instead of XIP flash. List them
+# from the built firmware with make hot-path, compare the loop jitter with
+# LOOP_STATS_ENABLE against a build without.
+HOT_PATH_SRAM_ENABLE ?= no
+ifeq ($(strip $(MCU)), RP2040)
+    ifeq ($(strip $(HOT_PATH_SRAM_ENABLE)), yes)
+        OPT_DEFS += -DHOT_PATH_SRAM_ENABLE
+    endif
+endif
+
+# Main loop period and jitter on the console, to compare builds
+LOOP_STATS_ENABLE ?= no
+ifeq ($(strip $(MCU)), RP2040)
+    ifeq ($(strip $(LOOP_STATS_ENABLE)), yes)
+        SRC += loop_stats.c
+        OPT_DEFS += -DLOOP_STATS_ENABLE
+    endif
+endif
+
+# System clock divided down while idle, back to full speed on input
+CLOCK_GOVERNOR_ENABLE ?= no
+ifeq ($(strip $(MCU)), RP2040)
+    ifeq ($(strip $(CLOCK_GOVERNOR_ENABLE)), yes)
+        SRC += clock_governor.c
+        OPT_DEFS += -DCLOCK_GOVERNOR_ENABLE
+    endif
+endif
+
+# Encoders counted by PIO state machines instead of polled every scan
+ENCODER_PIO_ENABLE ?= no
+ifeq ($(strip $(MCU)), RP2040)
+    ifeq ($(strip $(ENCODER_ENABLE) $(ENCODER_PIO_ENABLE)), yes yes)
+        ENCODER_DRIVER = custom
+        SRC += encoder_pio.c
+        OPT_DEFS += -DENCODER_PIO_ENABLE
+    endif
+endif
+
+# Timing knobs of the features above, read and set at runtime over the
+# virtual serial port or the VIA custom channel
+TUNE_ENABLE ?= no
+ifeq ($(strip $(TUNE_ENABLE)), yes)
+    SRC += tune.c
+    OPT_DEFS += -DTUNE_ENABLE
+endif
+
+# Binary status frames on the virtual serial port, read with telemetry.py
+TELEMETRY_ENABLE ?= no
+ifeq ($(strip $(MCU)), RP2040)
+    ifeq ($(strip $(VIRTSER_ENABLE) $(TELEMETRY_ENABLE)), yes yes)
+        SRC += telemetry.c
+        OPT_DEFS += -DTELEMETRY_ENABLE
+    endif
+endif
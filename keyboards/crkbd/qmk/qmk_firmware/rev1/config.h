@@ -3,4 +3,7 @@
 /* Select hand configuration */
 #define MASTER_LEFT
 // #define MASTER_RIGHT
-// #define EE_HANDS
\ No newline at end of file
+// #define EE_HANDS
+/* Soft serial split link at the driver default rate. Builds with
+   SPLIT_SERIAL_STATS_ENABLE time its transactions in cycles, to compare
+   a SELECT_SOFT_SERIAL_SPEED set here against it. */
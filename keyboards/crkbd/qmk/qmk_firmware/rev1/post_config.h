@@ -1,5 +1,6 @@
 #pragma once
 
+// OLED_FONT_ATLAS_ENABLE, on for rev1, sets it to lib/font_blank.c
 #ifndef OLED_FONT_H
 #  define OLED_FONT_H "keyboards/crkbd/lib/glcdfont.c"
 #endif
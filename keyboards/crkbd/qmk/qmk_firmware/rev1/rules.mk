@@ -0,0 +1,3 @@
+# Status text from the glyph atlas, the driver font is left with a blank
+# glyph: 843 bytes of glyph tables in place of 1344
+OLED_FONT_ATLAS_ENABLE = yes
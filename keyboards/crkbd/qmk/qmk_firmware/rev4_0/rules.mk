@@ -1 +1,13 @@
-SERIAL_DRIVER = vendor
\ No newline at end of file
+SERIAL_DRIVER = vendor
+
+# Direct pin switches, tune debounce per key
+ADAPTIVE_DEBOUNCE_ENABLE = yes
+
+# Encoder pins decoded by pio1
+ENCODER_PIO_ENABLE = yes
+
+# Per-key press counts and the usage_heatmap effect
+HEATMAP_ENABLE = yes
+
+# Clock divided down while idle, see clock_governor.h for measuring it
+CLOCK_GOVERNOR_ENABLE = yes
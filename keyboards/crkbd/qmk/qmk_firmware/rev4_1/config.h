@@ -33,8 +33,16 @@
 // USB Split Detection Timings
 #define SPLIT_USB_TIMEOUT 10000              // Increased timeout
 #define SPLIT_USB_DETECT_POLL_RATE 100       // More frequent polling
-#define SPLIT_MAX_CONNECTION_ERRORS 10  // More lenient error threshold
-#define SPLIT_CONNECTION_CHECK_INTERVAL 100  // Check connection more frequently
+// A failed transaction blocks the scan for SERIAL_USART_TIMEOUT, so a lost
+// half stalls the keys for errors x timeout before it is declared down:
+// 210 ms with 10 errors at the 20 ms default, 18 ms here. The largest
+// transaction is about 3 ms at 115200. The check interval only applies
+// while the link is down: a returning half is found within 25 ms instead of
+// 105, and a lone half loses 20% of its loop to the checks instead of 4%,
+// at most 5 ms every 25 ms. See test/crkbd/test_split_link.c.
+#define SPLIT_MAX_CONNECTION_ERRORS 3
+#define SERIAL_USART_TIMEOUT 5
+#define SPLIT_CONNECTION_CHECK_INTERVAL 20
 
 // Enable serial debugging
 #define SERIAL_DEBUG  
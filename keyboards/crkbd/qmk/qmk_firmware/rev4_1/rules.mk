@@ -15,3 +15,18 @@ VIRTSER_ENABLE = yes        # Enable Virtual Serial Port
 
 
 
+
+# Direct pin switches, tune debounce per key
+ADAPTIVE_DEBOUNCE_ENABLE = yes
+
+# Runtime timing knobs on the debug serial port
+TUNE_ENABLE = yes
+
+# Binary status frames for telemetry.py, started with set telemetry_ms
+TELEMETRY_ENABLE = yes
+
+# Per-key press counts and the usage_heatmap effect
+HEATMAP_ENABLE = yes
+
+# Clock divided down while idle, see clock_governor.h for measuring it
+CLOCK_GOVERNOR_ENABLE = yes
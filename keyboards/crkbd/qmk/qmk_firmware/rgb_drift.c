@@ -0,0 +1,62 @@
+#include "quantum.h"
+#include "sync_timer.h"
+#include "transactions.h"
+#include "rgb_drift.h"
+
+// Both halves render RGB effects from the synced timer. The core sends the
+// master's timer, with its transfer time added, only every
+// FORCED_SYNC_THROTTLE_MS, and in between the slave's timer runs on its own
+// crystal. The master reads the slave's synced timer in an RPC transaction
+// and takes its own before and after: a slave in sync reads inside that
+// window, the drift is how far outside it the reading falls.
+
+static uint32_t          drift_timer;
+static rgb_drift_stats_t drift_stats;
+
+static void rgb_drift_slave_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
+    uint32_t now = sync_timer_read32();
+
+    if (out_buflen == sizeof(now)) {
+        memcpy(out_data, &now, sizeof(now));
+    }
+}
+
+void rgb_drift_init(void) {
+    transaction_register_rpc(RPC_ID_KB_RGB_DRIFT, rgb_drift_slave_handler);
+}
+
+void rgb_drift_task(void) {
+    if (!is_keyboard_master() || !is_transport_connected() || timer_elapsed32(drift_timer) < RGB_DRIFT_INTERVAL) {
+        return;
+    }
+    drift_timer = timer_read32();
+
+    uint32_t slave;
+    uint32_t before = sync_timer_read32();
+    if (!transaction_rpc_exec(RPC_ID_KB_RGB_DRIFT, 0, NULL, sizeof(slave), &slave)) {
+        return;
+    }
+    uint32_t after = sync_timer_read32();
+    int32_t  drift = 0;
+
+    if ((int32_t)(slave - before) < 0) {
+        drift = (int32_t)(slave - before);
+    } else if ((int32_t)(slave - after) > 0) {
+        drift = (int32_t)(slave - after);
+    }
+    uint16_t magnitude = MIN(drift < 0 ? -drift : drift, INT16_MAX);
+
+    drift_stats.last   = drift < 0 ? -magnitude : magnitude;
+    drift_stats.window = MIN(after - before, UINT16_MAX);
+    if (magnitude > RGB_DRIFT_MAX) {
+        drift_stats.over++;
+    }
+    if (magnitude > drift_stats.max) {
+        drift_stats.max = magnitude;
+        dprintf("rgb drift: %d ms, new max, bound %u ms\n", drift_stats.last, RGB_DRIFT_MAX);
+    }
+}
+
+const rgb_drift_stats_t *rgb_drift_stats(void) {
+    return &drift_stats;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stdint.h>
+
+// How often the master reads the slave's synced timer
+#ifndef RGB_DRIFT_INTERVAL
+#    define RGB_DRIFT_INTERVAL 250
+#endif
+
+// Drift in milliseconds the halves may show between two resends of the
+// synced timer. Two 12 MHz crystals of 30 ppm drift apart by 0.06 ms a
+// second, a frame of an effect is 16 ms.
+#ifndef RGB_DRIFT_MAX
+#    define RGB_DRIFT_MAX 2
+#endif
+
+typedef struct {
+    int16_t  last;   // ms the slave's timer was ahead, beyond the read window
+    uint16_t max;    // largest drift either way
+    uint16_t over;   // readings beyond RGB_DRIFT_MAX
+    uint16_t window; // ms the last read took, its uncertainty
+} rgb_drift_stats_t;
+
+void                     rgb_drift_init(void);
+void                     rgb_drift_task(void);
+const rgb_drift_stats_t *rgb_drift_stats(void);
@@ -0,0 +1,90 @@
+#include "quantum.h"
+#include "send_string.h"
+#include "sequence.h"
+#include "sequence_data.h"
+#ifdef FAST_SEND_ENABLE
+#    include "fast_send.h"
+#endif
+
+// Node layout is described in sequence_trie.py
+#define SEQUENCE_TERMINAL 0x80
+#define SEQUENCE_CHILDREN 0x7F
+
+static bool     sequence_active;
+static uint16_t sequence_node;
+static uint16_t sequence_timer;
+
+static uint16_t sequence_read_u16(uint16_t offset) {
+    return pgm_read_byte(&sequence_trie[offset]) | (uint16_t)pgm_read_byte(&sequence_trie[offset + 1]) << 8;
+}
+
+static void sequence_finish(void) {
+    uint8_t header = pgm_read_byte(&sequence_trie[sequence_node]);
+
+    sequence_active = false;
+    if (header & SEQUENCE_TERMINAL) {
+#ifdef FAST_SEND_ENABLE
+        fast_send_string_P(&sequence_outputs[sequence_read_u16(sequence_node + 1)]);
+#else
+        send_string_P(&sequence_outputs[sequence_read_u16(sequence_node + 1)]);
+#endif
+    }
+}
+
+// Moves to the child for keycode, returns false if the sequence is dead
+static bool sequence_advance(uint8_t keycode) {
+    uint8_t  header   = pgm_read_byte(&sequence_trie[sequence_node]);
+    uint8_t  children = header & SEQUENCE_CHILDREN;
+    uint16_t child    = sequence_node + 1 + (header & SEQUENCE_TERMINAL ? 2 : 0);
+
+    for (uint8_t i = 0; i < children; i++, child += 3) {
+        if (pgm_read_byte(&sequence_trie[child]) == keycode) {
+            sequence_node = sequence_read_u16(child + 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool process_sequence(uint16_t keycode, keyrecord_t *record) {
+    if (keycode == QK_LEADER) {
+        if (record->event.pressed) {
+            sequence_active = true;
+            sequence_node   = 0;
+            sequence_timer  = timer_read();
+        }
+        return false;
+    }
+    if (!sequence_active) {
+        return true;
+    }
+    // Releases pass so keys held before the leader are not stuck
+    if (!record->event.pressed) {
+        return true;
+    }
+
+    // Tap-hold keys count as their tap, held they are a modifier or layer
+    if (IS_QK_MOD_TAP(keycode) || IS_QK_LAYER_TAP(keycode)) {
+        if (record->tap.count == 0) {
+            return true;
+        }
+        keycode = IS_QK_MOD_TAP(keycode) ? QK_MOD_TAP_GET_TAP_KEYCODE(keycode) : QK_LAYER_TAP_GET_TAP_KEYCODE(keycode);
+    }
+    if (!IS_QK_BASIC(keycode) || !sequence_advance(keycode)) {
+        sequence_active = false;
+        return false;
+    }
+    sequence_timer = timer_read();
+
+    // Send right away when no longer sequence shares this prefix
+    if ((pgm_read_byte(&sequence_trie[sequence_node]) & SEQUENCE_CHILDREN) == 0) {
+        sequence_finish();
+    }
+    return false;
+}
+
+void sequence_task(void) {
+    if (sequence_active && timer_elapsed(sequence_timer) > SEQUENCE_TIMEOUT) {
+        sequence_finish();
+    }
+}
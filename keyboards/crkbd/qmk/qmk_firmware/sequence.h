@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "action.h"
+
+// Time allowed between two keys of a sequence
+#ifndef SEQUENCE_TIMEOUT
+#    define SEQUENCE_TIMEOUT 300
+#endif
+
+bool process_sequence(uint16_t keycode, keyrecord_t *record);
+void sequence_task(void);
@@ -0,0 +1,119 @@
+#!/usr/bin/env python3
+"""Generate the PROGMEM trie used by sequence.c.
+
+Each line of the input file maps a key sequence to the text it sends:
+
+    # comment
+    gh -> https://github.com/
+    sig -> Best regards,
+
+Sequences are made of the characters a-z and 0-9. The trie is written as
+a header with one node per prefix:
+
+    header   bit 7 set when a sequence ends here, bits 0-6 child count
+    output   uint16 offset into sequence_outputs, only on terminal nodes
+    children child count times (uint8 keycode, uint16 node offset)
+"""
+
+import sys
+
+KEYCODES = {c: 0x04 + i for i, c in enumerate('abcdefghijklmnopqrstuvwxyz')}
+KEYCODES.update({c: 0x1E + i for i, c in enumerate('123456789')})
+KEYCODES['0'] = 0x27
+
+
+class Node:
+    def __init__(self):
+        self.children = {}
+        self.output = None
+        self.offset = 0
+
+    def size(self):
+        return 1 + (2 if self.output is not None else 0) + 3 * len(self.children)
+
+
+def parse(path):
+    sequences = []
+    with open(path, encoding='utf-8') as f:
+        for number, line in enumerate(f, 1):
+            line = line.strip()
+            if not line or line.startswith('#'):
+                continue
+            if '->' not in line:
+                sys.exit(f'{path}:{number}: expected "keys -> output"')
+            keys, output = (part.strip() for part in line.split('->', 1))
+            if not keys or any(c not in KEYCODES for c in keys):
+                sys.exit(f'{path}:{number}: keys must be a-z or 0-9')
+            sequences.append((keys, output))
+    return sequences
+
+
+def build(sequences):
+    root = Node()
+    for keys, output in sequences:
+        node = root
+        for c in keys:
+            node = node.children.setdefault(KEYCODES[c], Node())
+        if node.output is not None:
+            sys.exit(f'duplicate sequence "{keys}"')
+        node.output = output
+    return root
+
+
+def serialize(root):
+    nodes = []
+    queue = [root]
+    while queue:
+        node = queue.pop(0)
+        nodes.append(node)
+        queue.extend(node.children[k] for k in sorted(node.children))
+
+    offset = 0
+    for node in nodes:
+        node.offset = offset
+        offset += node.size()
+    if offset > 0xFFFF:
+        sys.exit('sequence trie exceeds 64 KiB')
+
+    trie = []
+    outputs = bytearray()
+    for node in nodes:
+        if len(node.children) > 0x7F:
+            sys.exit('too many children on one node')
+        trie.append((0x80 if node.output is not None else 0) | len(node.children))
+        if node.output is not None:
+            trie += [len(outputs) & 0xFF, len(outputs) >> 8]
+            outputs += node.output.encode('utf-8') + b'\0'
+        for keycode in sorted(node.children):
+            child = node.children[keycode].offset
+            trie += [keycode, child & 0xFF, child >> 8]
+    return trie, outputs
+
+
+def array(values):
+    lines = []
+    for i in range(0, len(values), 16):
+        lines.append('    ' + ', '.join(f'0x{v:02X}' for v in values[i:i + 16]) + ',')
+    return '\n'.join(lines)
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(f'usage: {sys.argv[0]} sequences.txt sequence_data.h')
+
+    sequences = parse(sys.argv[1])
+    trie, outputs = serialize(build(sequences))
+    longest = max((len(keys) for keys, _ in sequences), default=0)
+
+    with open(sys.argv[2], 'w', encoding='utf-8') as f:
+        f.write(f'// Generated by sequence_trie.py from {sys.argv[1]}, do not edit\n')
+        f.write('#pragma once\n\n')
+        f.write(f'#define SEQUENCE_COUNT {len(sequences)}\n')
+        f.write(f'#define SEQUENCE_MAX_LENGTH {longest}\n')
+        f.write(f'#define SEQUENCE_TRIE_SIZE {len(trie)}\n\n')
+        f.write('static const uint8_t sequence_trie[] PROGMEM = {\n' + array(trie) + '\n};\n\n')
+        f.write('static const char sequence_outputs[] PROGMEM = {\n' + array(list(outputs) or [0]) + '\n};\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,53 @@
+#include "quantum.h"
+#include "transport.h"
+#include "split_link.h"
+#ifdef SPLIT_SCHED_ENABLE
+#    include "split_sched.h"
+#endif
+
+// The core transport declares the link down after
+// SPLIT_MAX_CONNECTION_ERRORS failed transactions and then only tries again
+// every SPLIT_CONNECTION_CHECK_INTERVAL, both set in the revision's
+// config.h. This follows the state it ends up in from housekeeping: drops
+// and how long they lasted are counted, and all synced state is sent again
+// once the other half is back, as it may have rebooted.
+//
+// The core sends state to the slave when it differs from the copy in the
+// master's shared memory, the last one sent, and reads the slave's state
+// when its checksum differs from that copy. Every byte of the copy is
+// flipped on a return, so the next transactions send and read all of it.
+
+static bool               link_up = true;
+static uint32_t           link_down_at;
+static split_link_stats_t link_stats;
+
+void split_link_task(void) {
+    if (!is_keyboard_master() || is_transport_connected() == link_up) {
+        return;
+    }
+    link_up = !link_up;
+
+    if (!link_up) {
+        link_down_at = timer_read32();
+        link_stats.drops++;
+        dprintf("split link: lost\n");
+        return;
+    }
+    uint8_t *shmem = (uint8_t *)split_shmem;
+    for (size_t i = 0; i < sizeof(split_shared_memory_t); i++) {
+        shmem[i] = ~shmem[i];
+    }
+#ifdef SPLIT_SCHED_ENABLE
+    split_sched_resync();
+#endif
+
+    link_stats.recover_last = MIN(timer_elapsed32(link_down_at), UINT16_MAX);
+    if (link_stats.recover_last > link_stats.recover_max) {
+        link_stats.recover_max = link_stats.recover_last;
+    }
+    dprintf("split link: back after %u ms, longest %u ms\n", link_stats.recover_last, link_stats.recover_max);
+}
+
+const split_link_stats_t *split_link_stats(void) {
+    return &link_stats;
+}
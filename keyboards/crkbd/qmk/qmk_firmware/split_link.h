@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    uint16_t drops;        // times the link was declared down
+    uint16_t recover_last; // ms the last drop lasted
+    uint16_t recover_max;
+} split_link_stats_t;
+
+void                      split_link_task(void);
+const split_link_stats_t *split_link_stats(void);
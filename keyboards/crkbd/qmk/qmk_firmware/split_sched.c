@@ -0,0 +1,139 @@
+#include "quantum.h"
+#include "transactions.h"
+#include "split_sched.h"
+
+// The matrix keeps its own transaction in every scan. Registered state
+// goes in one RPC transaction that carries the item index and its bytes,
+// at most one item per loop, and only while the matrix is quiet or an
+// item has been held back for SPLIT_SCHED_GUARD_MAX_AGE. Items
+// are sent in priority order once their interval has passed and their
+// checksum changed. A byte bucket filled at SPLIT_SCHED_BUDGET caps the
+// share of the link they take.
+
+// Transaction header and checksum around the payload
+#define SPLIT_SCHED_OVERHEAD 4
+#define SPLIT_SCHED_BUCKET (2 * RPC_M2S_BUFFER_SIZE)
+
+typedef struct {
+    void    *data;
+    uint8_t  size;
+    uint8_t  priority;
+    uint16_t interval;
+    uint16_t sent_at;
+    uint16_t checksum;
+    bool     sent;
+} split_sched_item_t;
+
+static split_sched_item_t sched_items[SPLIT_SCHED_ITEMS_MAX];
+static uint8_t            sched_count;
+static uint16_t           sched_tokens;
+static uint16_t           sched_refill;
+static bool               sched_held;
+static uint16_t           sched_held_since;
+
+uint16_t split_sched_budget    = SPLIT_SCHED_BUDGET;
+uint16_t split_sched_key_guard = SPLIT_SCHED_KEY_GUARD;
+
+static uint16_t split_sched_checksum(const uint8_t *data, uint8_t size) {
+    uint8_t a = 0;
+    uint8_t b = 0;
+    while (size--) {
+        a += *data++;
+        b += a;
+    }
+    return (uint16_t)b << 8 | a;
+}
+
+static void split_sched_slave_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
+    const uint8_t *in = in_data;
+
+    if (in_buflen > 0 && in[0] < sched_count && in_buflen - 1 == sched_items[in[0]].size) {
+        memcpy(sched_items[in[0]].data, &in[1], in_buflen - 1);
+    }
+}
+
+bool split_sched_register(void *data, uint8_t size, uint8_t priority, uint16_t interval) {
+    if (sched_count == SPLIT_SCHED_ITEMS_MAX || size + 1 > RPC_M2S_BUFFER_SIZE) {
+        return false;
+    }
+    sched_items[sched_count++] = (split_sched_item_t){.data = data, .size = size, .priority = priority, .interval = interval};
+    return true;
+}
+
+void split_sched_resync(void) {
+    for (uint8_t i = 0; i < sched_count; i++) {
+        sched_items[i].sent = false;
+    }
+}
+
+void split_sched_init(void) {
+    transaction_register_rpc(RPC_ID_KB_SPLIT_SCHED, split_sched_slave_handler);
+}
+
+int8_t split_sched_pick(uint16_t now, uint16_t *checksum) {
+    int8_t best = -1;
+
+    for (uint8_t i = 0; i < sched_count; i++) {
+        split_sched_item_t *item = &sched_items[i];
+        uint16_t            age  = TIMER_DIFF_16(now, item->sent_at);
+        uint16_t            sum  = split_sched_checksum(item->data, item->size);
+
+        if (item->sent && (age < item->interval || (sum == item->checksum && age < SPLIT_SCHED_REFRESH))) {
+            continue;
+        }
+        if (best < 0 || item->priority < sched_items[best].priority) {
+            best      = i;
+            *checksum = sum;
+        }
+    }
+    return best;
+}
+
+void split_sched_task(void) {
+    uint8_t  buffer[RPC_M2S_BUFFER_SIZE];
+    uint16_t now = timer_read();
+    uint16_t checksum;
+
+    if (!is_keyboard_master() || !is_transport_connected()) {
+        return;
+    }
+
+    uint16_t refill = (uint32_t)TIMER_DIFF_16(now, sched_refill) * split_sched_budget / 1000;
+    if (refill > 0) {
+        sched_tokens = MIN(sched_tokens + refill, SPLIT_SCHED_BUCKET);
+        sched_refill = now;
+    }
+    // Moving keys hold items back, the first one held starts the max age
+    bool guarded = last_matrix_activity_elapsed() < split_sched_key_guard;
+    if (guarded && sched_held && TIMER_DIFF_16(now, sched_held_since) < SPLIT_SCHED_GUARD_MAX_AGE) {
+        return;
+    }
+
+    int8_t index = split_sched_pick(now, &checksum);
+    if (index < 0) {
+        sched_held = false;
+        return;
+    }
+    if (guarded && !sched_held) {
+        sched_held       = true;
+        sched_held_since = now;
+        return;
+    }
+    split_sched_item_t *item = &sched_items[index];
+    uint8_t             cost = item->size + 1 + SPLIT_SCHED_OVERHEAD;
+
+    // Strict priority, lower items do not slip past one waiting for budget
+    if (sched_tokens < cost) {
+        return;
+    }
+    sched_tokens -= cost;
+
+    buffer[0] = index;
+    memcpy(&buffer[1], item->data, item->size);
+    if (transaction_rpc_send(RPC_ID_KB_SPLIT_SCHED, item->size + 1, buffer)) {
+        item->sent     = true;
+        item->sent_at  = now;
+        item->checksum = checksum;
+        sched_held     = false;
+    }
+}
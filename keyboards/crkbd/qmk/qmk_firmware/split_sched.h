@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef SPLIT_SCHED_ITEMS_MAX
+#    define SPLIT_SCHED_ITEMS_MAX 4
+#endif
+
+// Link bandwidth left to secondary state, in bytes per second
+#ifndef SPLIT_SCHED_BUDGET
+#    define SPLIT_SCHED_BUDGET 1000
+#endif
+
+// Secondary state waits this long after any matrix change, so it never
+// takes the link while keys are moving
+#ifndef SPLIT_SCHED_KEY_GUARD
+#    define SPLIT_SCHED_KEY_GUARD 20
+#endif
+
+// An item the key guard has held back this long goes out anyway, so
+// steady typing cannot starve the other half of state
+#ifndef SPLIT_SCHED_GUARD_MAX_AGE
+#    define SPLIT_SCHED_GUARD_MAX_AGE 500
+#endif
+
+// Unchanged state is still resent this often, so a half that reconnected
+// catches up
+#ifndef SPLIT_SCHED_REFRESH
+#    define SPLIT_SCHED_REFRESH 2000
+#endif
+
+enum split_sched_priority {
+    SPLIT_SCHED_HIGH,
+    SPLIT_SCHED_NORMAL,
+    SPLIT_SCHED_LOW,
+};
+
+extern uint16_t split_sched_budget;
+extern uint16_t split_sched_key_guard;
+
+void split_sched_init(void);
+void split_sched_task(void);
+// Sends every item again as soon as the budget allows, for a slave that
+// lost its copies
+void split_sched_resync(void);
+
+// Most urgent item that is due and changed at now, or -1. Its checksum
+// goes to checksum.
+int8_t split_sched_pick(uint16_t now, uint16_t *checksum);
+
+// The master sends data to the same variable on the slave. Both halves
+// must register the same items in the same order. Returns false when the
+// item does not fit.
+bool split_sched_register(void *data, uint8_t size, uint8_t priority, uint16_t interval);
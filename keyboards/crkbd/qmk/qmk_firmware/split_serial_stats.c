@@ -0,0 +1,77 @@
+#include "quantum.h"
+#include "serial.h"
+#include "transactions.h"
+#include "atomic_util.h"
+#include "split_serial_stats.h"
+
+// Cycles of a soft serial transaction on the AVR halves, measured on the
+// master. The driver has no hook around a transaction, so the master runs
+// the matrix checksum transaction itself, the one the core sends on every
+// scan, SPLIT_SERIAL_STATS_PROBES times per interval. It only refreshes the
+// checksum the core reads again before use, so the probes change nothing.
+//
+// Transactions are timed from Timer0, which also drives QMK's millisecond
+// timer, so one tick is 64 cycles and a wrap is one millisecond. The driver
+// runs a transaction with interrupts off, a compare match it holds back is
+// read from the flag, which is right for transactions under a millisecond.
+
+#define SPLIT_SERIAL_STATS_PRESCALER 64
+
+static split_serial_stats_t stats;
+static split_serial_stats_t stats_last;
+static uint16_t             stats_timer;
+
+static uint32_t split_serial_stats_now(void) {
+    uint32_t ms;
+    uint8_t  ticks;
+
+    ATOMIC_BLOCK_FORCEON {
+        ms    = timer_read32();
+        ticks = TCNT0;
+        // A compare match the interrupt has not counted yet
+        if (TIFR0 & _BV(OCF0A)) {
+            ms++;
+            ticks = TCNT0;
+        }
+    }
+    return (ms * (OCR0A + 1) + ticks) * SPLIT_SERIAL_STATS_PRESCALER;
+}
+
+static void split_serial_stats_probe(void) {
+    uint32_t start  = split_serial_stats_now();
+    bool     result = soft_serial_transaction(GET_SLAVE_MATRIX_CHECKSUM);
+    uint32_t cycles = split_serial_stats_now() - start;
+
+    stats.cycles += cycles;
+    if (cycles > stats.max) {
+        stats.max = cycles;
+    }
+    stats.count++;
+    if (!result) {
+        stats.errors++;
+    }
+}
+
+void split_serial_stats_task(void) {
+    if (!is_keyboard_master() || !is_transport_connected()) {
+        return;
+    }
+    uint16_t elapsed = timer_elapsed(stats_timer);
+
+    if (stats.count < SPLIT_SERIAL_STATS_PROBES && elapsed >= (uint32_t)SPLIT_SERIAL_STATS_INTERVAL * stats.count / SPLIT_SERIAL_STATS_PROBES) {
+        split_serial_stats_probe();
+    }
+    if (elapsed < SPLIT_SERIAL_STATS_INTERVAL) {
+        return;
+    }
+    stats_timer = timer_read();
+    if (stats.count) {
+        dprintf("split serial: %u transactions, %lu cycles average, %lu max, %u errors\n", stats.count, stats.cycles / stats.count, stats.max, stats.errors);
+    }
+    stats_last = stats;
+    stats      = (split_serial_stats_t){0};
+}
+
+const split_serial_stats_t *split_serial_stats(void) {
+    return &stats_last;
+}
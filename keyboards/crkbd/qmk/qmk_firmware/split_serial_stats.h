@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdint.h>
+
+// Interval of the transaction report on the console
+#ifndef SPLIT_SERIAL_STATS_INTERVAL
+#    define SPLIT_SERIAL_STATS_INTERVAL 1000
+#endif
+
+// Transactions timed per report
+#ifndef SPLIT_SERIAL_STATS_PROBES
+#    define SPLIT_SERIAL_STATS_PROBES 20
+#endif
+
+typedef struct {
+    uint16_t count;
+    uint16_t errors;
+    uint32_t cycles; // sum over count
+    uint32_t max;
+} split_serial_stats_t;
+
+void                        split_serial_stats_task(void);
+const split_serial_stats_t *split_serial_stats(void);
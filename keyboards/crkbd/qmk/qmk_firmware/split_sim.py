@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+"""Simulate the split link between the two halves and report how key
+events from the slave half reach the master.
+
+Both halves run their own rev4_1 keyboard code, built for the host from
+test/sim, each in a thread of its own joined by a virtual UART with the
+given baud rate, line latency and bit error rate. Each half boots through
+keyboard_pre_init_user, so the UART ends up on the pins its hand pin
+picks, and the link only works when both halves got their side right.
+The master scans, runs the core transport's transactions against the
+slave, which answers from its matrix, and runs housekeeping_task_kb with
+split_link.c. A transaction with a bit error fails its checksum and one
+in a disconnect window waits out SERIAL_USART_TIMEOUT. After
+SPLIT_MAX_CONNECTION_ERRORS failures the link is down and only retried
+every SPLIT_CONNECTION_CHECK_INTERVAL.
+
+Key events come from a telemetry.py capture or are typed at random:
+
+    python3 split_sim.py --trace run.csv --ber 1e-5 --disconnect 2000:300
+    python3 split_sim.py --wpm 120 --seconds 60 --check-interval 50
+    python3 split_sim.py --hand-pin high
+
+An event is lost when the key changes back before any transaction sees
+it. Latency runs from the slave's matrix change to the end of the
+transaction that delivered it. The drops and how long they lasted are
+split_link.c's own counts. The serial driver itself is not simulated.
+"""
+
+import argparse
+import csv
+import os
+import random
+import statistics
+import subprocess
+
+MATRIX_ROWS = 8
+
+
+def typed(args, rng):
+    events = []
+    now = 0
+    rows = range(MATRIX_ROWS // 2, MATRIX_ROWS) if args.slave == 'right' else range(MATRIX_ROWS // 2)
+    gap = 60_000_000 / (args.wpm * 5)
+    released = {}
+    while now < args.seconds * 1_000_000:
+        key = (rng.choice(rows), rng.randrange(6))
+        if released.get(key, 0) < now:
+            released[key] = now + max(int(rng.gauss(90_000, 25_000)), 5_000)
+            events.append((now, key, True))
+            events.append((released[key], key, False))
+        now += int(rng.expovariate(1 / gap))
+    return sorted(events)
+
+
+def recorded(args):
+    # Key times are 16 bit milliseconds, unwrapped here
+    events = []
+    rows = range(MATRIX_ROWS // 2, MATRIX_ROWS) if args.slave == 'right' else range(MATRIX_ROWS // 2)
+    with open(args.trace, encoding='utf-8') as f:
+        last = None
+        base = 0
+        for fields in csv.reader(f):
+            if not fields or fields[0] != 'key' or not fields[3].isdigit():
+                continue
+            time, row, col, pressed = int(fields[3]), int(fields[5]), int(fields[6]), fields[7] == '1'
+            if last is not None and time < last:
+                base += 1 << 16
+            last = time
+            if row in rows:
+                events.append(((base + time) * 1000, (row, col), pressed))
+    if events:
+        start = events[0][0]
+        events = [(time - start, key, pressed) for time, key, pressed in events]
+    return sorted(events)
+
+
+def simulate(args, events):
+    test = os.path.join(os.path.dirname(os.path.abspath(__file__)), '../../../../test')
+    subprocess.run(['make', '-s', '-C', test, 'build/split_sim'], check=True)
+    options = ['--slave', args.slave, '--hand-pin', args.hand_pin, '--baud', str(args.baud),
+               '--latency', str(args.latency), '--ber', str(args.ber), '--scan', str(args.scan),
+               '--timeout', str(args.timeout), '--max-errors', str(args.max_errors),
+               '--check-interval', str(args.check_interval), '--seed', str(args.seed)]
+    for spec in args.disconnect:
+        options += ['--disconnect', spec]
+    if args.verbose:
+        options.append('--verbose')
+    lines = ''.join(f'{time} {row} {col} {int(pressed)}\n' for time, (row, col), pressed in events)
+    run = subprocess.run([os.path.join(test, 'build/split_sim')] + options, input=lines,
+                         stdout=subprocess.PIPE, text=True, check=True)
+
+    report = {'pins': {}, 'latencies': []}
+    for line in run.stdout.splitlines():
+        fields = line.split()
+        if fields[0] == 'pins':
+            report['pins'][fields[1]] = fields[2:]
+        elif fields[0] == 'latency':
+            report['latencies'].append(int(fields[1]))
+        else:
+            report.update(zip(fields[::2], map(int, fields[1::2])))
+    return report
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split('\n\n')[0])
+    parser.add_argument('--trace', help='telemetry.py CSV to replay')
+    parser.add_argument('--slave', choices=['left', 'right'], default='right', help='half without USB')
+    parser.add_argument('--wpm', type=float, default=80)
+    parser.add_argument('--seconds', type=float, default=30)
+    parser.add_argument('--baud', type=int, default=115200, help='SERIAL_USART_SPEED')
+    parser.add_argument('--latency', type=float, default=0, help='line latency in us')
+    parser.add_argument('--ber', type=float, default=0, help='bit error rate')
+    parser.add_argument('--disconnect', action='append', default=[], metavar='START:MS',
+                        help='link gone from START ms for MS ms, repeatable')
+    parser.add_argument('--scan', type=int, default=300, help='master scan time in us')
+    parser.add_argument('--timeout', type=int, default=5, help='SERIAL_USART_TIMEOUT in ms')
+    parser.add_argument('--max-errors', type=int, default=3, help='SPLIT_MAX_CONNECTION_ERRORS')
+    parser.add_argument('--check-interval', type=int, default=20, help='SPLIT_CONNECTION_CHECK_INTERVAL in ms')
+    parser.add_argument('--hand-pin', choices=['wired', 'high', 'low'], default='wired',
+                        help='SPLIT_HAND_PIN level, high or low on both halves to try a bad one')
+    parser.add_argument('--seed', type=int, default=1)
+    parser.add_argument('--verbose', action='store_true', help='print the keyboard code\'s debug output')
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    events = recorded(args) if args.trace else typed(args, rng)
+    report = simulate(args, events)
+    latencies = report['latencies']
+
+    for half, pins in report['pins'].items():
+        print(f'{half} half: UART on {" ".join(pins) or "no pins"}')
+    print(f'events: {len(events)} from the {args.slave} half, {report["delivered"]} delivered, {report["lost"]} lost')
+    if latencies:
+        ordered = sorted(latencies)
+        print('latency: {:.2f} ms mean, {:.2f} median, {:.2f} p99, {:.2f} max'.format(
+            statistics.mean(ordered) / 1000, ordered[len(ordered) // 2] / 1000,
+            ordered[min(len(ordered) - 1, len(ordered) * 99 // 100)] / 1000, ordered[-1] / 1000))
+    print(f'link: {report["drops"]} drops', end='')
+    if report['drops'] and report['recover_max']:
+        print(f', back after {report["recover_max"]} ms at most', end='')
+    print()
+
+
+if __name__ == '__main__':
+    main()
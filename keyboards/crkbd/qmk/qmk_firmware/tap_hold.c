@@ -0,0 +1,86 @@
+#include "quantum.h"
+#include "tap_hold.h"
+#include "hot_path.h"
+
+// Streak taps rewrite record->keycode, which the core only reads back
+// with combos
+#if defined(TAP_HOLD_STREAK_ENABLE) && !defined(COMBO_ENABLE)
+#    error "TAP_HOLD_STREAK_ENABLE needs COMBO_ENABLE"
+#endif
+
+#ifdef TAP_HOLD_STREAK_ENABLE
+uint16_t tap_hold_streak_term = TAP_HOLD_STREAK_TERM;
+#endif
+
+// Thumb keys get the layer, everything else may be rolled over while typing
+__attribute__((weak)) uint8_t get_tap_hold_policy(uint16_t keycode, keyrecord_t *record) {
+    if (IS_QK_LAYER_TAP(keycode)) {
+        return TAP_HOLD_PERMISSIVE;
+    }
+    return TAP_HOLD_PERMISSIVE | TAP_HOLD_STREAK;
+}
+
+// The core has weak defaults for these, so they are strong here. Keymaps
+// choose through get_tap_hold_policy.
+bool get_permissive_hold(uint16_t keycode, keyrecord_t *record) {
+    return get_tap_hold_policy(keycode, record) & TAP_HOLD_PERMISSIVE;
+}
+
+bool get_hold_on_other_key_press(uint16_t keycode, keyrecord_t *record) {
+    return get_tap_hold_policy(keycode, record) & TAP_HOLD_EAGER;
+}
+
+static bool is_tap_hold_keycode(uint16_t keycode) {
+    return IS_QK_MOD_TAP(keycode) || IS_QK_LAYER_TAP(keycode);
+}
+
+#ifdef TAP_HOLD_STREAK_ENABLE
+static matrix_row_t streak_keys[MATRIX_ROWS];
+static uint16_t     streak_timer;
+static bool         streak_active;
+
+static uint16_t tap_hold_tap_keycode(uint16_t keycode) {
+    if (IS_QK_MOD_TAP(keycode)) {
+        return QK_MOD_TAP_GET_TAP_KEYCODE(keycode);
+    }
+    return QK_LAYER_TAP_GET_TAP_KEYCODE(keycode);
+}
+#endif
+
+// Resolves tap-hold keys pressed during a typing streak before the tapping
+// logic sees them, so they are sent on press instead of after the term
+HOT_PATH bool pre_process_tap_hold(uint16_t keycode, keyrecord_t *record) {
+#ifdef TAP_HOLD_STREAK_ENABLE
+    if (!IS_KEYEVENT(record->event)) {
+        return true;
+    }
+
+    uint8_t      row = record->event.key.row;
+    matrix_row_t bit = (matrix_row_t)1 << record->event.key.col;
+
+    if (!record->event.pressed) {
+        // The release has to match the keycode that was sent on press
+        if (streak_keys[row] & bit) {
+            streak_keys[row] &= ~bit;
+            record->keycode = tap_hold_tap_keycode(keycode);
+        }
+        return true;
+    }
+
+    if (is_tap_hold_keycode(keycode)) {
+        if (streak_active && TIMER_DIFF_16(record->event.time, streak_timer) < tap_hold_streak_term && (get_tap_hold_policy(keycode, record) & TAP_HOLD_STREAK)) {
+            streak_keys[row] |= bit;
+            record->keycode = tap_hold_tap_keycode(keycode);
+            streak_timer    = record->event.time;
+        } else {
+            streak_active = false;
+        }
+    } else if (IS_BASIC_KEYCODE(keycode)) {
+        streak_active = true;
+        streak_timer  = record->event.time;
+    } else {
+        streak_active = false;
+    }
+#endif
+    return true;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "action.h"
+
+// A press of a tap-hold key this soon after a plain key press is sent as a
+// tap, 0 turns it off
+#ifndef TAP_HOLD_STREAK_TERM
+#    define TAP_HOLD_STREAK_TERM 150
+#endif
+
+enum tap_hold_policy {
+    TAP_HOLD_STOCK      = 0,
+    TAP_HOLD_PERMISSIVE = 1 << 0, // hold once a key is tapped inside the hold
+    TAP_HOLD_EAGER      = 1 << 1, // hold as soon as another key is pressed
+    TAP_HOLD_STREAK     = 1 << 2, // tap without waiting while typing, with TAP_HOLD_STREAK_ENABLE
+};
+
+extern uint16_t tap_hold_streak_term;
+
+uint8_t get_tap_hold_policy(uint16_t keycode, keyrecord_t *record);
+bool    pre_process_tap_hold(uint16_t keycode, keyrecord_t *record);
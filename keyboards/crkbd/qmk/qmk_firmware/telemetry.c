@@ -0,0 +1,209 @@
+#include "quantum.h"
+#include "virtser.h"
+#include "telemetry.h"
+#ifdef SPLIT_LINK_ENABLE
+#    include "split_link.h"
+#endif
+
+// Binary frames on the virtual serial port, decoded by telemetry.py.
+// Each frame is type, sequence number, little endian payload and a CRC-8
+// over all of them, COBS encoded and ended by a zero. Frames are encoded
+// straight into the ring as they are built and the ring is drained a few
+// bytes per loop, so nothing is formatted or staged. A frame that does
+// not fit is dropped and counted.
+//
+// The core cannot tell whether the host has the port open, and a byte
+// nobody reads blocks virtser_send until its timeout. The port counts as
+// open once the host writes to it. It counts as closed again when a byte
+// takes longer than TELEMETRY_STALL_US to hand over. Then the ring is
+// dropped and nothing is framed or sent until the host writes again, so a
+// closed port costs one blocked byte.
+//
+// Knob replies share the port. Before one is printed the frame going out
+// is finished, and a zero after it ends the text, so the host sees it
+// between frames as a chunk that fails the CRC.
+
+_Static_assert((TELEMETRY_RING_SIZE & (TELEMETRY_RING_SIZE - 1)) == 0, "Ring size must be a power of two");
+
+#define TELEMETRY_MASK (TELEMETRY_RING_SIZE - 1)
+
+uint16_t telemetry_interval = TELEMETRY_INTERVAL;
+
+static uint8_t  tele_ring[TELEMETRY_RING_SIZE];
+static uint16_t tele_head;
+static uint16_t tele_tail;
+static uint16_t tele_code_at;
+static uint8_t  tele_code;
+static uint8_t  tele_crc;
+static uint8_t  tele_seq;
+static uint16_t tele_drops;
+static bool     tele_open;
+static bool     tele_mid_frame;
+static uint16_t tele_timer;
+static uint16_t tele_loops;
+static uint16_t  tele_loop_max;
+static systime_t tele_loop_last;
+
+static uint8_t telemetry_crc8(uint8_t crc, uint8_t byte) {
+    crc ^= byte;
+    for (uint8_t i = 0; i < 8; i++) {
+        crc = crc & 0x80 ? crc << 1 ^ 0x07 : crc << 1;
+    }
+    return crc;
+}
+
+static void telemetry_code(void) {
+    tele_ring[tele_code_at & TELEMETRY_MASK] = tele_code;
+    tele_code_at                             = tele_head++;
+    tele_code                                = 1;
+}
+
+static void telemetry_byte(uint8_t byte) {
+    tele_crc = telemetry_crc8(tele_crc, byte);
+    if (byte == 0) {
+        telemetry_code();
+        return;
+    }
+    tele_ring[tele_head++ & TELEMETRY_MASK] = byte;
+    if (++tele_code == 0xFF) {
+        telemetry_code();
+    }
+}
+
+static void telemetry_bytes(const void *data, uint8_t size) {
+    for (const uint8_t *byte = data; size--; byte++) {
+        telemetry_byte(*byte);
+    }
+}
+
+// Room for the worst case encoding of size payload bytes
+static bool telemetry_begin(uint8_t type, uint8_t size) {
+    uint16_t encoded = size + 3 + (size + 3) / 254 + 2;
+
+    if ((uint16_t)(TELEMETRY_RING_SIZE - (tele_head - tele_tail)) < encoded) {
+        tele_drops++;
+        return false;
+    }
+    tele_code_at = tele_head++;
+    tele_code    = 1;
+    tele_crc     = 0;
+    telemetry_byte(type);
+    telemetry_byte(tele_seq++);
+    return true;
+}
+
+static void telemetry_end(void) {
+    uint8_t crc = tele_crc;
+
+    telemetry_byte(crc);
+    tele_ring[tele_code_at & TELEMETRY_MASK] = tele_code;
+    tele_ring[tele_head++ & TELEMETRY_MASK]  = 0;
+}
+
+void telemetry_port_open(void) {
+    tele_open = true;
+}
+
+#ifndef TUNE_ENABLE
+void virtser_recv(const uint8_t ch) {
+    telemetry_port_open();
+}
+#endif
+
+void telemetry_key(uint16_t keycode, keyrecord_t *record) {
+    if (telemetry_interval == 0 || !tele_open || !telemetry_begin(TELEMETRY_KEY, 7)) {
+        return;
+    }
+    telemetry_bytes(&record->event.time, 2);
+    telemetry_bytes(&keycode, 2);
+    telemetry_byte(record->event.key.row);
+    telemetry_byte(record->event.key.col);
+    telemetry_byte(record->event.pressed);
+    telemetry_end();
+}
+
+static void telemetry_status(void) {
+    uint32_t now      = timer_read32();
+    uint8_t  link[7]  = {0};
+    uint8_t  row_size = sizeof(matrix_row_t);
+
+    if (!telemetry_begin(TELEMETRY_STATUS, 27 + MATRIX_ROWS * sizeof(matrix_row_t))) {
+        return;
+    }
+    telemetry_bytes(&now, 4);
+    telemetry_bytes(&layer_state, 4);
+    telemetry_bytes(&default_layer_state, 4);
+    telemetry_bytes(&tele_loops, 2);
+    telemetry_bytes(&tele_loop_max, 2);
+#ifdef SPLIT_KEYBOARD
+    link[0] = is_transport_connected();
+#endif
+#ifdef SPLIT_LINK_ENABLE
+    memcpy(&link[1], split_link_stats(), 6);
+#endif
+    telemetry_bytes(link, sizeof(link));
+    telemetry_bytes(&tele_drops, 2);
+    telemetry_byte(MATRIX_ROWS);
+    telemetry_byte(row_size);
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        matrix_row_t bits = matrix_get_row(row);
+        telemetry_bytes(&bits, sizeof(bits));
+    }
+    telemetry_end();
+}
+
+// Hands the next byte of the ring to the port, drops the ring if nobody
+// read it
+static void telemetry_send(void) {
+    systime_t start = chVTGetSystemTimeX();
+    uint8_t   byte  = tele_ring[tele_tail++ & TELEMETRY_MASK];
+
+    virtser_send(byte);
+    tele_mid_frame = byte != 0;
+    if (TIME_I2US(chTimeDiffX(start, chVTGetSystemTimeX())) >= TELEMETRY_STALL_US) {
+        tele_open      = false;
+        tele_tail      = tele_head;
+        tele_mid_frame = false;
+    }
+}
+
+void telemetry_text_begin(void) {
+    while (tele_mid_frame && tele_tail != tele_head) {
+        telemetry_send();
+    }
+}
+
+void telemetry_text_end(void) {
+    if (telemetry_interval != 0 && tele_open) {
+        virtser_send(0);
+    }
+}
+
+void telemetry_task(void) {
+    uint16_t  now  = timer_read();
+    systime_t tick = chVTGetSystemTimeX();
+
+    // Loop times only count while sending. Frames already in the ring
+    // still go out once it is turned off.
+    if (telemetry_interval == 0 || !tele_open) {
+        tele_timer     = now;
+        tele_loop_last = tick;
+        tele_loops     = 0;
+        tele_loop_max  = 0;
+    } else {
+        // Longest loop in microseconds, from the ChibiOS system timer
+        tele_loops++;
+        tele_loop_max  = MAX(tele_loop_max, MIN(TIME_I2US(chTimeDiffX(tele_loop_last, tick)), UINT16_MAX));
+        tele_loop_last = tick;
+        if (TIMER_DIFF_16(now, tele_timer) >= telemetry_interval) {
+            tele_timer = now;
+            telemetry_status();
+            tele_loops    = 0;
+            tele_loop_max = 0;
+        }
+    }
+
+    for (uint8_t n = TELEMETRY_DRAIN; n && tele_tail != tele_head; n--) {
+        telemetry_send();
+    }
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include "action.h"
+
+// Status frames are sent this often, 0 sends none. Key frames follow the
+// same switch.
+#ifndef TELEMETRY_INTERVAL
+#    define TELEMETRY_INTERVAL 0
+#endif
+
+// Encoded frames waiting for the port, a power of two
+#ifndef TELEMETRY_RING_SIZE
+#    define TELEMETRY_RING_SIZE 512
+#endif
+
+// Bytes handed to the port per loop
+#ifndef TELEMETRY_DRAIN
+#    define TELEMETRY_DRAIN 64
+#endif
+
+// A byte that takes this long to hand to the port has nobody reading it
+#ifndef TELEMETRY_STALL_US
+#    define TELEMETRY_STALL_US 1000
+#endif
+
+enum telemetry_frame_type {
+    TELEMETRY_STATUS = 1,
+    TELEMETRY_KEY,
+};
+
+extern uint16_t telemetry_interval;
+
+// The host wrote to the port, so it has it open
+void telemetry_port_open(void);
+void telemetry_key(uint16_t keycode, keyrecord_t *record);
+void telemetry_task(void);
+
+// Around text printed to the same port: finishes the frame going out
+// before, and ends the text with a zero after while frames are sent
+void telemetry_text_begin(void);
+void telemetry_text_end(void);
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""Decode the binary telemetry frames telemetry.c writes to the virtual
+serial port, one CSV line per frame:
+
+    python3 telemetry.py /dev/ttyACM0 > run.csv
+    python3 telemetry.py /dev/ttyACM0 --plot
+
+Frames are COBS encoded and end with a zero byte. Decoded, a frame is the
+type, a sequence number, the little endian payload and a CRC-8 (poly 0x07)
+over all of them. The firmware only sends while the telemetry_ms knob is
+set, for example by writing "set telemetry_ms 100" to the same port, and
+only once the host has written to the port since it last stopped reading.
+open_port writes a harmless get line for that.
+Text the port carries in between, like knob replies, comes between two
+frames and ends with a zero of its own, so it fails the CRC and is skipped
+without taking a frame with it.
+"""
+
+import os
+import struct
+import sys
+import termios
+import time
+
+STATUS = 1
+KEY = 2
+
+
+def crc8(data):
+    crc = 0
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc << 1 ^ 0x07 if crc & 0x80 else crc << 1) & 0xFF
+    return crc
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data) + 1:
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def parse(frame):
+    kind, seq, payload = frame[0], frame[1], frame[2:]
+    if kind == STATUS and len(payload) >= 27:
+        (now, layers, default_layers, loops, loop_max, link_up, drops,
+         recover_last, recover_max, lost, rows, row_size) = struct.unpack_from('<IIIHHBHHHHBB', payload)
+        width = {1: 'B', 2: 'H', 4: 'I'}.get(row_size)
+        if width is None or len(payload) != 27 + rows * row_size:
+            return None
+        matrix = struct.unpack_from(f'<{rows}{width}', payload, 27)
+        return seq, 'status', [now, f'{layers:08x}', f'{default_layers:08x}', loops, loop_max,
+                               link_up, drops, recover_last, recover_max, lost,
+                               ' '.join(f'{row:0{2 * row_size}x}' for row in matrix)]
+    if kind == KEY and len(payload) == 7:
+        key_time, keycode, row, col, pressed = struct.unpack('<HHBBB', payload)
+        return seq, 'key', [key_time, f'{keycode:04x}', row, col, pressed]
+    return None
+
+
+def frames(port):
+    buffer = bytearray()
+    while True:
+        chunk = os.read(port, 256)
+        if not chunk:
+            return
+        buffer += chunk
+        while 0 in buffer:
+            end = buffer.index(0)
+            encoded, buffer = bytes(buffer[:end]), buffer[end + 1:]
+            frame = cobs_decode(encoded)
+            if frame is None or len(frame) < 3 or crc8(frame[:-1]) != frame[-1]:
+                continue
+            record = parse(frame[:-1])
+            if record is not None:
+                yield record
+
+
+def open_port(path):
+    port = os.open(path, os.O_RDWR | os.O_NOCTTY)
+    if os.isatty(port):
+        attrs = termios.tcgetattr(port)
+        attrs[0] = attrs[1] = attrs[3] = 0
+        attrs[2] = termios.CS8 | termios.CREAD | termios.CLOCAL
+        attrs[6][termios.VMIN] = 1
+        attrs[6][termios.VTIME] = 0
+        termios.tcsetattr(port, termios.TCSANOW, attrs)
+        os.write(port, b'get telemetry_ms\r\n')
+    return port
+
+
+def main():
+    args = [arg for arg in sys.argv[1:] if arg != '--plot']
+    if len(args) != 1:
+        sys.exit(f'usage: {sys.argv[0]} /dev/ttyACM0 [--plot]')
+    plot = '--plot' in sys.argv
+
+    print('record,host_time,seq,time,layers,default_layers,loops,loop_max_us,'
+          'link_up,link_drops,recover_last,recover_max,telemetry_drops,matrix')
+    print('record,host_time,seq,time,keycode,row,col,pressed')
+    if plot:
+        import matplotlib.pyplot as plt
+        plt.ion()
+        _, axes = plt.subplots()
+        history = []
+
+    last_seq = None
+    missed = 0
+    try:
+        for seq, kind, fields in frames(open_port(args[0])):
+            if last_seq is not None:
+                missed += (seq - last_seq - 1) & 0xFF
+            last_seq = seq
+            print(','.join(str(field) for field in [kind, f'{time.time():.3f}', seq] + fields), flush=True)
+            if plot and kind == 'status':
+                history = (history + [fields[4]])[-300:]
+                axes.clear()
+                axes.set_ylabel('longest loop, us')
+                axes.plot(history)
+                plt.pause(0.001)
+    except KeyboardInterrupt:
+        pass
+    print(f'{missed} frames missed', file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,347 @@
+#include "quantum.h"
+#include "eeconfig.h"
+#include "tune.h"
+#ifdef VIRTSER_ENABLE
+#    include "virtser.h"
+#endif
+#ifdef VIA_ENABLE
+#    include "via.h"
+#endif
+#ifdef ADAPTIVE_DEBOUNCE_ENABLE
+#    include "adaptive_debounce.h"
+#endif
+#ifdef ENCODER_ACCEL_ENABLE
+#    include "encoder_accel.h"
+#endif
+#ifdef TAP_HOLD_RESOLVER_ENABLE
+#    include "tap_hold.h"
+#endif
+#ifdef SPLIT_SCHED_ENABLE
+#    include "split_sched.h"
+#endif
+#if defined(HEATMAP_ENABLE) && defined(RGB_MATRIX_ENABLE)
+#    include "heatmap.h"
+#endif
+#ifdef CLOCK_GOVERNOR_ENABLE
+#    include "clock_governor.h"
+#endif
+#ifdef FAST_SEND_ENABLE
+#    include "fast_send.h"
+#endif
+#ifdef TELEMETRY_ENABLE
+#    include "telemetry.h"
+#endif
+
+// Knobs are the variables the features read their timing from, each with
+// the range it is safe to set. Values are checked against it, and knobs
+// that bound each other against one another, wherever they come from,
+// EEPROM included. Saved values are only applied when the names of the
+// built knobs match the ones they were saved with.
+
+#ifdef OLED_ENABLE
+extern uint16_t oled_draw_interval;
+#endif
+
+typedef struct {
+    const char *name;
+    void       *value;
+    bool        wide;
+    uint16_t    min;
+    uint16_t    max;
+} tune_param_t;
+
+#define TUNE_PARAM(name, var, min, max) {name, &(var), sizeof(var) == 2, min, max}
+
+static const tune_param_t tune_params[] = {
+#ifdef ADAPTIVE_DEBOUNCE_ENABLE
+    TUNE_PARAM("debounce_min", adaptive_debounce_min, 1, ADAPTIVE_DEBOUNCE_MAX),
+    TUNE_PARAM("debounce_max", adaptive_debounce_max, 1, ADAPTIVE_DEBOUNCE_MAX),
+#endif
+#ifdef ENCODER_ACCEL_ENABLE
+    TUNE_PARAM("encoder_frame", encoder_accel_frame_ms, 1, 200),
+#endif
+#ifdef TAP_HOLD_STREAK_ENABLE
+    // 0 turns streak taps off
+    TUNE_PARAM("streak_term", tap_hold_streak_term, 0, 1000),
+#endif
+#ifdef SPLIT_SCHED_ENABLE
+    TUNE_PARAM("sched_budget", split_sched_budget, 100, 10000),
+    TUNE_PARAM("sched_guard", split_sched_key_guard, 0, 500),
+#endif
+#if defined(HEATMAP_ENABLE) && defined(RGB_MATRIX_ENABLE)
+    TUNE_PARAM("heat_decay", heatmap_decay_ms, 1, 1000),
+#endif
+#ifdef CLOCK_GOVERNOR_ENABLE
+    TUNE_PARAM("governor_half", clock_governor_half_idle, 100, 60000),
+    TUNE_PARAM("governor_quarter", clock_governor_quarter_idle, 100, 60000),
+#endif
+#ifdef TELEMETRY_ENABLE
+    TUNE_PARAM("telemetry_ms", telemetry_interval, 0, 10000),
+#endif
+#ifdef FAST_SEND_ENABLE
+    TUNE_PARAM("fast_send_batch", fast_send_batch, 0, FAST_SEND_BATCH_MAX),
+#endif
+#ifdef OLED_ENABLE
+    TUNE_PARAM("oled_interval", oled_draw_interval, 0, 1000),
+#endif
+};
+
+#define TUNE_COUNT ARRAY_SIZE(tune_params)
+
+_Static_assert(TUNE_COUNT <= TUNE_PARAMS_MAX, "More knobs than the EEPROM block holds");
+_Static_assert(2 + 2 * TUNE_PARAMS_MAX <= EECONFIG_KB_TUNE_SIZE, "Knobs do not fit their EEPROM block");
+
+static uint16_t tune_defaults[TUNE_COUNT];
+
+static uint16_t tune_get(uint8_t index) {
+    const tune_param_t *param = &tune_params[index];
+    return param->wide ? *(uint16_t *)param->value : *(uint8_t *)param->value;
+}
+
+static bool tune_store(uint8_t index, uint16_t value) {
+    const tune_param_t *param = &tune_params[index];
+
+    if (value < param->min || value > param->max) {
+        return false;
+    }
+    if (param->wide) {
+        *(uint16_t *)param->value = value;
+    } else {
+        *(uint8_t *)param->value = value;
+    }
+    return true;
+}
+
+// Knobs that bound each other
+static bool tune_consistent(void) {
+#ifdef ADAPTIVE_DEBOUNCE_ENABLE
+    if (adaptive_debounce_min > adaptive_debounce_max) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+static uint8_t tune_set(uint8_t index, uint16_t value) {
+    uint16_t old = tune_get(index);
+
+    if (!tune_store(index, value)) {
+        return TUNE_OUT_OF_RANGE;
+    }
+    if (!tune_consistent()) {
+        tune_store(index, old);
+        return TUNE_CONFLICT;
+    }
+    return TUNE_OK;
+}
+
+static void tune_defaults_apply(void) {
+    for (uint8_t i = 0; i < TUNE_COUNT; i++) {
+        tune_store(i, tune_defaults[i]);
+    }
+}
+
+static uint16_t tune_signature(void) {
+    uint8_t a = TUNE_COUNT;
+    uint8_t b = a;
+
+    for (uint8_t i = 0; i < TUNE_COUNT; i++) {
+        for (const char *c = tune_params[i].name; *c; c++) {
+            a += *c;
+            b += a;
+        }
+    }
+    return (uint16_t)b << 8 | a;
+}
+
+void tune_load(void) {
+    uint16_t table[1 + TUNE_COUNT];
+
+    for (uint8_t i = 0; i < TUNE_COUNT; i++) {
+        tune_defaults[i] = tune_get(i);
+    }
+    if (!eeconfig_is_kb_datablock_valid()) {
+        return;
+    }
+    eeconfig_read_kb_datablock(table, EECONFIG_KB_TUNE_OFFSET, sizeof(table));
+    if (table[0] != tune_signature()) {
+        return;
+    }
+    // A saved set that is out of range or inconsistent is dropped whole
+    for (uint8_t i = 0; i < TUNE_COUNT; i++) {
+        if (!tune_store(i, table[1 + i])) {
+            tune_defaults_apply();
+            return;
+        }
+    }
+    if (!tune_consistent()) {
+        tune_defaults_apply();
+    }
+}
+
+void tune_save(void) {
+    uint16_t table[1 + TUNE_COUNT] = {tune_signature()};
+
+    for (uint8_t i = 0; i < TUNE_COUNT; i++) {
+        table[1 + i] = tune_get(i);
+    }
+    eeconfig_update_kb_datablock(table, EECONFIG_KB_TUNE_OFFSET, sizeof(table));
+}
+
+void tune_reset(void) {
+    uint16_t signature = 0;
+
+    tune_defaults_apply();
+    eeconfig_update_kb_datablock(&signature, EECONFIG_KB_TUNE_OFFSET, sizeof(signature));
+}
+
+#ifdef VIRTSER_ENABLE
+static char    tune_line[40];
+static uint8_t tune_line_length;
+
+static void tune_print(const char *str) {
+    while (*str) {
+        virtser_send(*str++);
+    }
+}
+
+static void tune_print_param(uint8_t index) {
+    char line[48];
+
+    snprintf(line, sizeof(line), "%s %u (%u..%u)\r\n", tune_params[index].name, tune_get(index), tune_params[index].min, tune_params[index].max);
+    tune_print(line);
+}
+
+static int8_t tune_find(const char *name) {
+    for (uint8_t i = 0; i < TUNE_COUNT; i++) {
+        if (name && strcmp(name, tune_params[i].name) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool tune_parse(const char *str, uint16_t *value) {
+    uint32_t result = 0;
+
+    if (str == NULL || *str == '\0') {
+        return false;
+    }
+    for (; *str; str++) {
+        if (*str < '0' || *str > '9' || (result = result * 10 + *str - '0') > UINT16_MAX) {
+            return false;
+        }
+    }
+    *value = result;
+    return true;
+}
+
+static void tune_command(char *line) {
+    static const char *const errors[] = {
+        [TUNE_UNKNOWN]      = "unknown name\r\n",
+        [TUNE_OUT_OF_RANGE] = "out of range\r\n",
+        [TUNE_CONFLICT]     = "conflicts with another value\r\n",
+    };
+    char    *command = strtok(line, " ");
+    char    *name    = strtok(NULL, " ");
+    char    *arg     = strtok(NULL, " ");
+    int8_t   index   = tune_find(name);
+    uint16_t value;
+    uint8_t  status;
+
+    // Anything past the value falls through to the usage line
+    if (command == NULL) {
+        return;
+    }
+    if (strtok(NULL, " ")) {
+        command = "";
+    }
+    if (strcmp(command, "list") == 0) {
+        for (uint8_t i = 0; i < TUNE_COUNT; i++) {
+            tune_print_param(i);
+        }
+    } else if (strcmp(command, "get") == 0 && name) {
+        if (index >= 0) {
+            tune_print_param(index);
+        } else {
+            tune_print(errors[TUNE_UNKNOWN]);
+        }
+    } else if (strcmp(command, "set") == 0 && name && arg) {
+        // Anything but a number that fits 16 bits is out of range of every knob
+        if (index < 0) {
+            status = TUNE_UNKNOWN;
+        } else if (!tune_parse(arg, &value)) {
+            status = TUNE_OUT_OF_RANGE;
+        } else {
+            status = tune_set(index, value);
+        }
+        if (status == TUNE_OK) {
+            tune_print_param(index);
+        } else {
+            tune_print(errors[status]);
+        }
+    } else if (strcmp(command, "save") == 0) {
+        tune_save();
+        tune_print("saved\r\n");
+    } else if (strcmp(command, "reset") == 0) {
+        tune_reset();
+        tune_print("defaults\r\n");
+    } else {
+        tune_print("list | get <name> | set <name> <value> | save | reset\r\n");
+    }
+}
+
+void virtser_recv(const uint8_t ch) {
+#    ifdef TELEMETRY_ENABLE
+    telemetry_port_open();
+#    endif
+    if (ch == '\r' || ch == '\n') {
+        tune_line[tune_line_length] = '\0';
+        tune_line_length            = 0;
+#    ifdef TELEMETRY_ENABLE
+        telemetry_text_begin();
+#    endif
+        tune_command(tune_line);
+#    ifdef TELEMETRY_ENABLE
+        telemetry_text_end();
+#    endif
+    } else if (tune_line_length < sizeof(tune_line) - 1) {
+        tune_line[tune_line_length++] = ch;
+    }
+}
+#endif
+
+#ifdef VIA_ENABLE
+bool tune_via_command(uint8_t *data, uint8_t length) {
+    uint8_t *value_id   = &data[2];
+    uint8_t *value_data = &data[3];
+
+    switch (data[0]) {
+        case id_custom_get_value:
+            if (*value_id == id_tune_param && value_data[0] < TUNE_COUNT) {
+                const tune_param_t *param = &tune_params[value_data[0]];
+                uint16_t            words[3] = {tune_get(value_data[0]), param->min, param->max};
+
+                for (uint8_t i = 0; i < 3; i++) {
+                    value_data[1 + 2 * i] = words[i] & 0xFF;
+                    value_data[2 + 2 * i] = words[i] >> 8;
+                }
+                strncpy((char *)&value_data[7], param->name, length - 10);
+                data[length - 1] = '\0';
+                return true;
+            }
+            break;
+        case id_custom_set_value:
+            if (*value_id == id_tune_param) {
+                value_data[3] = value_data[0] < TUNE_COUNT ? tune_set(value_data[0], value_data[1] | value_data[2] << 8) : TUNE_UNKNOWN;
+                return true;
+            }
+            if (*value_id == id_tune_save) {
+                tune_save();
+                return true;
+            }
+            break;
+    }
+    return false;
+}
+#endif
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Saved parameters, the EEPROM block holds a signature and one 16-bit
+// value each
+#ifndef TUNE_PARAMS_MAX
+#    define TUNE_PARAMS_MAX 16
+#endif
+
+// Value ids on the VIA custom channel
+enum tune_value_id {
+    id_tune_param = 0x44, // get: index in data[3], value, min and max as 16-bit LE from data[4], then the name
+                          // set: index in data[3], 16-bit LE value in data[4], tune_status back in data[6]
+    id_tune_save,         // set: current values to EEPROM
+};
+
+// Result of a set, the value is left as it was unless TUNE_OK
+enum tune_status {
+    TUNE_OK,
+    TUNE_UNKNOWN,      // no knob with that index or name
+    TUNE_OUT_OF_RANGE, // outside the knob's range
+    TUNE_CONFLICT,     // against a knob it bounds, debounce_min above debounce_max
+};
+
+// Commands on the virtual serial port, one per line:
+//   list                 every parameter with its value and range
+//   get <name>
+//   set <name> <value>
+//   save                 current values to EEPROM, applied at boot
+//   reset                compiled defaults, saved values dropped
+void tune_load(void);
+void tune_save(void);
+void tune_reset(void);
+bool tune_via_command(uint8_t *data, uint8_t length);
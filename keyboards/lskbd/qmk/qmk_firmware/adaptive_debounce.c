@@ -0,0 +1,309 @@
+#include "quantum.h"
+#include "debounce.h"
+#include "eeconfig.h"
+#include "adaptive_debounce.h"
+#include "hot_path.h"
+#ifdef VIA_ENABLE
+#    include "via.h"
+#    ifdef SPLIT_KEYBOARD
+#        include "transactions.h"
+#    endif
+#endif
+
+// Per-key deferred debounce. A change is cooked once the raw state has
+// been stable for the key's window. The time between the first and the
+// last raw edge of a settle is the bounce of that switch. Bounce near the
+// window or chatter in the cooked state grows the window, long runs of
+// clean settles shrink it towards the bounce actually seen.
+//
+// Each half debounces its own rows, so the table describes the half the
+// code runs on, and is stored in that half's EEPROM. VIA talks to the
+// master only, which asks the slave for its rows in an RPC transaction.
+// The slave resets or saves its table from housekeeping, so the reply is
+// not held up by an EEPROM write.
+
+#define ADAPTIVE_DEBOUNCE_VERSION 1
+
+_Static_assert(1 + MATRIX_ROWS * MATRIX_COLS <= EECONFIG_KB_DEBOUNCE_SIZE, "Debounce table does not fit its EEPROM block");
+_Static_assert(ADAPTIVE_DEBOUNCE_MAX <= UINT8_MAX, "Windows are stored as bytes");
+
+uint8_t adaptive_debounce_min = ADAPTIVE_DEBOUNCE_MIN;
+uint8_t adaptive_debounce_max = ADAPTIVE_DEBOUNCE_MAX;
+
+typedef struct {
+    uint16_t first;     // first raw edge not cooked yet
+    uint16_t last;      // latest raw edge
+    uint16_t cooked_at; // latest cooked change
+    uint8_t  window;
+    uint8_t  peak;      // longest recent bounce, halved on every shrink
+    uint8_t  clean;
+    uint8_t  chatter;
+} debounce_key_t;
+
+static debounce_key_t debounce_keys[MATRIX_ROWS][MATRIX_COLS];
+static matrix_row_t   debounce_raw[MATRIX_ROWS];
+static matrix_row_t   debounce_pending[MATRIX_ROWS];
+static uint8_t        debounce_rows;
+
+#if defined(VIA_ENABLE) && defined(SPLIT_KEYBOARD)
+_Static_assert(1 + 2 * MATRIX_COLS <= RPC_S2M_BUFFER_SIZE, "A row of the debounce table does not fit the RPC reply");
+
+typedef struct {
+    uint8_t command;
+    uint8_t value_id;
+    uint8_t row; // within the slave's half
+} debounce_rpc_t;
+
+static volatile bool debounce_reset_pending;
+static volatile bool debounce_save_pending;
+#endif
+
+static void adaptive_debounce_tune(debounce_key_t *key, uint8_t row, uint8_t col, uint16_t bounce, bool chatter) {
+    uint8_t window = key->window;
+
+    if (chatter) {
+        if (key->chatter < UINT8_MAX) {
+            key->chatter++;
+        }
+        key->clean = 0;
+        window += ADAPTIVE_DEBOUNCE_MARGIN;
+    } else {
+        if (bounce > key->peak) {
+            key->peak = bounce < UINT8_MAX ? bounce : UINT8_MAX;
+        }
+        if (bounce + ADAPTIVE_DEBOUNCE_MARGIN > key->window) {
+            key->clean = 0;
+            window++;
+        } else if (++key->clean >= ADAPTIVE_DEBOUNCE_CLEAN_COUNT) {
+            key->clean = 0;
+            if (key->peak + ADAPTIVE_DEBOUNCE_MARGIN < window) {
+                window--;
+            }
+            key->peak /= 2;
+        }
+    }
+
+    if (window < adaptive_debounce_min) {
+        window = adaptive_debounce_min;
+    } else if (window > adaptive_debounce_max) {
+        window = adaptive_debounce_max;
+    }
+    if (window != key->window) {
+        dprintf("debounce: %ux%u %u -> %u ms (bounce %u, chatter %u)\n", row, col, key->window, window, bounce, key->chatter);
+        key->window = window;
+    }
+}
+
+void debounce_init(uint8_t num_rows) {
+    debounce_rows = num_rows;
+    adaptive_debounce_reset();
+}
+
+void debounce_free(void) {}
+
+HOT_PATH bool debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed) {
+    uint16_t now            = timer_read();
+    bool     cooked_changed = false;
+
+    for (uint8_t row = 0; row < num_rows; row++) {
+        matrix_row_t edges = raw[row] ^ debounce_raw[row];
+
+        // Most rows have no edge and nothing waiting
+        if (!(edges | debounce_pending[row])) {
+            continue;
+        }
+        debounce_raw[row] = raw[row];
+
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            matrix_row_t    bit = (matrix_row_t)1 << col;
+            debounce_key_t *key = &debounce_keys[row][col];
+
+            if (edges & bit) {
+                if (!(debounce_pending[row] & bit)) {
+                    debounce_pending[row] |= bit;
+                    key->first = now;
+                }
+                key->last = now;
+            }
+            if (!(debounce_pending[row] & bit)) {
+                continue;
+            }
+
+            if (TIMER_DIFF_16(now, key->last) < key->window) {
+                continue;
+            }
+            debounce_pending[row] &= ~bit;
+
+            // A key that settled back where it started only glitched, its bounce still counts
+            bool chatter = false;
+            if ((raw[row] ^ cooked[row]) & bit) {
+                chatter = TIMER_DIFF_16(now, key->cooked_at) < ADAPTIVE_DEBOUNCE_CHATTER_TERM;
+                cooked[row] ^= bit;
+                cooked_changed = true;
+                key->cooked_at = now;
+            }
+            adaptive_debounce_tune(key, row, col, TIMER_DIFF_16(key->last, key->first), chatter);
+        }
+    }
+    return cooked_changed;
+}
+
+void adaptive_debounce_reset(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            debounce_keys[row][col] = (debounce_key_t){.window = DEBOUNCE, .cooked_at = timer_read() - ADAPTIVE_DEBOUNCE_CHATTER_TERM};
+        }
+    }
+}
+
+void adaptive_debounce_load(void) {
+    uint8_t table[1 + MATRIX_ROWS * MATRIX_COLS];
+
+    if (!eeconfig_is_kb_datablock_valid()) {
+        return;
+    }
+    eeconfig_read_kb_datablock(table, EECONFIG_KB_DEBOUNCE_OFFSET, sizeof(table));
+    if (table[0] != ADAPTIVE_DEBOUNCE_VERSION) {
+        return;
+    }
+    for (uint8_t row = 0; row < debounce_rows; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            uint8_t window = table[1 + row * MATRIX_COLS + col];
+            if (window >= adaptive_debounce_min && window <= adaptive_debounce_max) {
+                debounce_keys[row][col].window = window;
+            }
+        }
+    }
+}
+
+void adaptive_debounce_save(void) {
+    uint8_t table[1 + MATRIX_ROWS * MATRIX_COLS] = {ADAPTIVE_DEBOUNCE_VERSION};
+
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            table[1 + row * MATRIX_COLS + col] = debounce_keys[row][col].window;
+        }
+    }
+    eeconfig_update_kb_datablock(table, EECONFIG_KB_DEBOUNCE_OFFSET, sizeof(table));
+}
+
+void adaptive_debounce_task(void) {
+#if defined(VIA_ENABLE) && defined(SPLIT_KEYBOARD)
+    if (debounce_reset_pending) {
+        debounce_reset_pending = false;
+        adaptive_debounce_reset();
+    }
+    if (debounce_save_pending) {
+        debounce_save_pending = false;
+        adaptive_debounce_save();
+    }
+#endif
+}
+
+#ifdef VIA_ENABLE
+// Window and chatter count of each column of a row of this half
+static void adaptive_debounce_get_row(uint8_t row, uint8_t *out) {
+    for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+        out[2 * col]     = debounce_keys[row][col].window;
+        out[2 * col + 1] = debounce_keys[row][col].chatter;
+    }
+}
+
+#    ifdef SPLIT_KEYBOARD
+static void adaptive_debounce_slave_handler(uint8_t in_buflen, const void *in_data, uint8_t out_buflen, void *out_data) {
+    const debounce_rpc_t *rpc = in_data;
+    uint8_t              *out = out_data;
+
+    out[0] = false;
+    if (in_buflen != sizeof(debounce_rpc_t)) {
+        return;
+    }
+    switch (rpc->command) {
+        case id_custom_get_value:
+            if (rpc->value_id == id_adaptive_debounce_row && rpc->row < debounce_rows) {
+                adaptive_debounce_get_row(rpc->row, &out[1]);
+                out[0] = true;
+            }
+            break;
+        case id_custom_set_value:
+            if (rpc->value_id == id_adaptive_debounce_reset) {
+                debounce_reset_pending = true;
+                out[0]                 = true;
+            }
+            break;
+        case id_custom_save:
+            debounce_save_pending = true;
+            out[0]                = true;
+            break;
+    }
+}
+
+// Runs a command on the slave, false when it did not answer. out, when
+// given, gets a row of its table.
+static bool adaptive_debounce_remote(uint8_t command, uint8_t value_id, uint8_t row, uint8_t *out) {
+    debounce_rpc_t rpc = {.command = command, .value_id = value_id, .row = row};
+    uint8_t        reply[1 + 2 * MATRIX_COLS];
+
+    if (!is_keyboard_master() || !transaction_rpc_exec(RPC_ID_KB_DEBOUNCE, sizeof(rpc), &rpc, sizeof(reply), reply) || !reply[0]) {
+        return false;
+    }
+    if (out) {
+        memcpy(out, &reply[1], 2 * MATRIX_COLS);
+    }
+    return true;
+}
+#    endif
+#endif
+
+void adaptive_debounce_init(void) {
+#if defined(VIA_ENABLE) && defined(SPLIT_KEYBOARD)
+    transaction_register_rpc(RPC_ID_KB_DEBOUNCE, adaptive_debounce_slave_handler);
+#endif
+    adaptive_debounce_load();
+}
+
+#ifdef VIA_ENABLE
+bool adaptive_debounce_via_command(uint8_t *data, uint8_t length) {
+    uint8_t *value_id   = &data[2];
+    uint8_t *value_data = &data[3];
+
+    switch (data[0]) {
+        case id_custom_get_value: {
+            if (*value_id != id_adaptive_debounce_row || value_data[0] >= MATRIX_ROWS || 4 + 2 * MATRIX_COLS > length) {
+                break;
+            }
+            uint8_t row = value_data[0];
+#    ifdef SPLIT_KEYBOARD
+            uint8_t this_hand = is_keyboard_left() ? 0 : ROWS_PER_HAND;
+            if (row < this_hand || row >= this_hand + ROWS_PER_HAND) {
+                return adaptive_debounce_remote(id_custom_get_value, *value_id, row % ROWS_PER_HAND, &value_data[1]);
+            }
+            row -= this_hand;
+#    endif
+            if (row >= debounce_rows) {
+                break;
+            }
+            adaptive_debounce_get_row(row, &value_data[1]);
+            return true;
+        }
+        case id_custom_set_value:
+            if (*value_id == id_adaptive_debounce_reset) {
+                adaptive_debounce_reset();
+#    ifdef SPLIT_KEYBOARD
+                return adaptive_debounce_remote(id_custom_set_value, *value_id, 0, NULL);
+#    else
+                return true;
+#    endif
+            }
+            break;
+        case id_custom_save:
+            adaptive_debounce_save();
+#    ifdef SPLIT_KEYBOARD
+            return adaptive_debounce_remote(id_custom_save, 0, 0, NULL);
+#    else
+            return true;
+#    endif
+    }
+    return false;
+}
+#endif
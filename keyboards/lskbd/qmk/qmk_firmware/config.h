@@ -0,0 +1,15 @@
+#pragma once
+
+// Keyboard level EEPROM datablock
+#ifdef ADAPTIVE_DEBOUNCE_ENABLE
+#    define EECONFIG_KB_DEBOUNCE_SIZE 64
+#else
+#    define EECONFIG_KB_DEBOUNCE_SIZE 0
+#endif
+#define EECONFIG_KB_DEBOUNCE_OFFSET 0
+
+#define EECONFIG_KB_DATA_SIZE (EECONFIG_KB_DEBOUNCE_OFFSET + EECONFIG_KB_DEBOUNCE_SIZE)
+
+#ifdef ADAPTIVE_DEBOUNCE_ENABLE
+#    define SPLIT_TRANSACTION_IDS_KB RPC_ID_KB_DEBOUNCE
+#endif
@@ -0,0 +1,33 @@
+#include "quantum.h"
+
+#ifdef VIA_ENABLE
+#    include "via.h"
+#endif
+#ifdef ADAPTIVE_DEBOUNCE_ENABLE
+#    include "adaptive_debounce.h"
+#endif
+
+void keyboard_post_init_kb(void) {
+#ifdef ADAPTIVE_DEBOUNCE_ENABLE
+    adaptive_debounce_init();
+#endif
+    keyboard_post_init_user();
+}
+
+void housekeeping_task_kb(void) {
+#ifdef ADAPTIVE_DEBOUNCE_ENABLE
+    adaptive_debounce_task();
+#endif
+    housekeeping_task_user();
+}
+
+#ifdef VIA_ENABLE
+void via_custom_value_command_kb(uint8_t *data, uint8_t length) {
+#    ifdef ADAPTIVE_DEBOUNCE_ENABLE
+    if (data[1] == id_custom_channel && adaptive_debounce_via_command(data, length)) {
+        return;
+    }
+#    endif
+    data[0] = id_unhandled;
+}
+#endif
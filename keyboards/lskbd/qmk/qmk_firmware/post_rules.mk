@@ -0,0 +1,18 @@
+# Keyboard level features, evaluated after the keymap rules.mk
+
+# Per-key debounce windows tuned from the bounce each switch shows. The
+# sources are a copy of crkbd's, so this board builds on its own; make
+# host-test checks that the copies match.
+ADAPTIVE_DEBOUNCE_ENABLE ?= no
+ifeq ($(strip $(ADAPTIVE_DEBOUNCE_ENABLE)), yes)
+    DEBOUNCE_TYPE = custom
+    SRC += adaptive_debounce.c
+    OPT_DEFS += -DADAPTIVE_DEBOUNCE_ENABLE
+endif
+
+# Functions marked HOT_PATH run from SRAM instead of XIP flash, hot_path.h
+# is a copy of crkbd's as well
+HOT_PATH_SRAM_ENABLE ?= no
+ifeq ($(strip $(HOT_PATH_SRAM_ENABLE)), yes)
+    OPT_DEFS += -DHOT_PATH_SRAM_ENABLE
+endif
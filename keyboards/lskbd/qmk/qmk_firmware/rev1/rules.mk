@@ -1 +1,4 @@
-SERIAL_DRIVER = vendor
\ No newline at end of file
+SERIAL_DRIVER = vendor
+
+# Direct pin switches, tune debounce per key
+ADAPTIVE_DEBOUNCE_ENABLE = yes
@@ -0,0 +1,107 @@
+// Column tables of the rev2 bank scanner against the info.json pins, and
+// the cost of moving a bank read to its columns against testing each
+// column pin as the stock scanner does.
+//
+// matrix_bank.h is generated by the Makefile with matrix_bank.py, as the
+// firmware build does.
+
+#define MATRIX_ROWS 4
+#define MATRIX_COLS 12
+#include "quantum.h"
+#include "matrix_bank.h"
+#include <stdlib.h>
+#include <time.h>
+#include "fake.h"
+#include "test.h"
+
+static uint8_t col_gpio[MATRIX_COLS];
+
+static void read_cols(void) {
+    char        text[4096] = {0};
+    FILE       *file       = fopen(CORNELIUS_PATH "/info.json", "r");
+    const char *p;
+    uint8_t     count = 0;
+
+    CHECK(file != NULL);
+    if (file == NULL) {
+        exit(1);
+    }
+    fread(text, 1, sizeof(text) - 1, file);
+    fclose(file);
+    p = strstr(text, "\"cols\"");
+    while (count < MATRIX_COLS && (p = strstr(p, "\"GP"))) {
+        col_gpio[count++] = strtoul(p + 3, NULL, 10);
+        p += 3;
+    }
+    CHECK_EQ(count, MATRIX_COLS);
+}
+
+// What a per-pin scanner builds from the same read
+static matrix_row_t per_pin(uint32_t bank) {
+    matrix_row_t cols = 0;
+
+    for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+        if (bank & (1u << col_gpio[col])) {
+            cols |= (matrix_row_t)1 << col;
+        }
+    }
+    return cols;
+}
+
+static uint32_t seed = 1;
+
+static uint32_t random_below(uint32_t limit) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % limit;
+}
+
+// Every column alone, then random reads with bits outside the mask set
+static void test_permute(void) {
+    for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+        CHECK_EQ(matrix_bank_permute(1u << col_gpio[col]), (matrix_row_t)1 << col);
+        CHECK(MATRIX_BANK_COL_MASK & (1u << col_gpio[col]));
+    }
+    for (uint32_t i = 0; i < 10000; i++) {
+        uint32_t bank = random_below(1 << 16) << 16 | random_below(1 << 16);
+        CHECK_EQ(matrix_bank_permute(bank & MATRIX_BANK_COL_MASK), per_pin(bank));
+    }
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void bench(void) {
+    enum { READS = 1 << 20 };
+    static uint32_t       banks[1024];
+    volatile matrix_row_t sink;
+    uint64_t              start, tables, pins;
+
+    for (uint16_t i = 0; i < ARRAY_SIZE(banks); i++) {
+        banks[i] = (random_below(1 << 16) << 16 | random_below(1 << 16)) & MATRIX_BANK_COL_MASK;
+    }
+    start = now_ns();
+    for (uint32_t i = 0; i < READS; i++) {
+        sink = matrix_bank_permute(banks[i % ARRAY_SIZE(banks)]);
+    }
+    tables = now_ns() - start;
+    start  = now_ns();
+    for (uint32_t i = 0; i < READS; i++) {
+        sink = per_pin(banks[i % ARRAY_SIZE(banks)]);
+    }
+    pins = now_ns() - start;
+    (void)sink;
+
+    printf("matrix bank, %u columns on GPIO bank 0\n", MATRIX_COLS);
+    printf("  per row read: tables %.2f ns, per column pin %.2f ns\n", (double)tables / READS, (double)pins / READS);
+    test_bench("matrix_bank/row", (double)tables / READS);
+}
+
+int main(void) {
+    read_cols();
+    test_permute();
+    bench();
+    return test_report("matrix_bank");
+}
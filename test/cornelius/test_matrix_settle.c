@@ -0,0 +1,165 @@
+// Row settle calibration of the rev2 scanner on a board whose rows each
+// need a number of port reads after being selected before the columns
+// read true.
+//
+// The pins are the info.json ones. A port read takes READ_NS and keeps
+// the time, clk_sys is whatever the test sets.
+
+#define MATRIX_ROWS 4
+#define MATRIX_COLS 12
+#define MATRIX_ROW_PINS {1, 29, 28, 16}
+#define MATRIX_COL_PINS {27, 26, 25, 24, 18, 17, 11, 6, 5, 4, 3, 2}
+#define MATRIX_SETTLE
+#define MATRIX_SETTLE_REPORT
+#define EECONFIG_KB_DATA_SIZE 8
+#include "matrix.c"
+#include "fake.h"
+#include "test.h"
+
+#define READ_NS 40
+
+static const uint8_t need[MATRIX_ROWS] = {5, 9, 3, 12};
+
+static matrix_row_t keys[MATRIX_ROWS];
+static int8_t       selected = -1;
+static uint8_t      reads_since;
+static uint64_t     now_ns;
+static uint32_t     clk_sys_hz = 125000000;
+
+systime_t chVTGetSystemTimeX(void) {
+    return now_ns / 1000;
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+    return clk_sys_hz;
+}
+
+void setPinOutput(pin_t pin) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        if (row_pins[row] == pin) {
+            selected    = row;
+            reads_since = 0;
+        }
+    }
+}
+
+void setPinInputHigh(pin_t pin) {
+    if (selected >= 0 && row_pins[selected] == pin) {
+        selected = -1;
+    }
+}
+
+void writePinLow(pin_t pin) {}
+
+// Held keys pull their columns low once the selected row has settled
+uint32_t palReadPort(uint32_t port) {
+    uint32_t bank = UINT32_MAX;
+
+    now_ns += READ_NS;
+    if (selected >= 0 && reads_since++ >= need[selected]) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            if (keys[selected] & ((matrix_row_t)1 << col)) {
+                bank &= ~(1u << col_pins[col]);
+            }
+        }
+    }
+    return bank;
+}
+
+// The core's raw matrix, empty at boot
+static matrix_row_t raw[MATRIX_ROWS];
+
+static void scan(uint16_t times) {
+    while (times--) {
+        matrix_scan_custom(raw);
+        CHECK(memcmp(raw, keys, sizeof(keys)) == 0);
+    }
+}
+
+static bool waits_max(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        if (settle[row] != MATRIX_SETTLE_MAX) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Nothing is saved or shortened while a row has not been sampled, and the
+// margin is a microsecond of reads
+static void test_all_rows(void) {
+    memset(fake_eeprom, 0, sizeof(fake_eeprom));
+    fake_eeprom_writes = 0;
+    matrix_init_custom();
+    CHECK(settle_calibrating);
+    CHECK(settle_margin * READ_NS >= 1000);
+    CHECK(settle_margin * READ_NS <= 1000 + 2 * READ_NS);
+
+    for (uint8_t row = 0; row < MATRIX_ROWS - 1; row++) {
+        keys[row] = 1 << row;
+        scan(200);
+        keys[row] = 0;
+        scan(1);
+    }
+    CHECK(settle_calibrating);
+    CHECK_EQ(settle_rows_left, 1);
+    CHECK_EQ(fake_eeprom_writes, 0);
+    CHECK(waits_max());
+
+    keys[3] = 0x801;
+    scan(200);
+    keys[3] = 0;
+    scan(1);
+    CHECK(!settle_calibrating);
+    CHECK_EQ(fake_eeprom_writes, 1);
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        CHECK_EQ(settle_trial[row], need[row]);
+        CHECK_EQ(settle[row], need[row] + settle_margin);
+    }
+    printf("matrix settle, rows need %u %u %u %u reads of %u ns, wait %u %u %u %u\n", need[0], need[1], need[2], need[3], READ_NS, settle[0], settle[1], settle[2], settle[3]);
+}
+
+// The saved profile is used at the clock it was measured at only
+static void test_clock(void) {
+    uint8_t saved[MATRIX_ROWS];
+
+    memcpy(saved, settle, sizeof(saved));
+    memset(settle, 0, sizeof(settle));
+    matrix_init_custom();
+    CHECK(!settle_calibrating);
+    CHECK(memcmp(settle, saved, sizeof(saved)) == 0);
+
+    clk_sys_hz = 133000000;
+    matrix_init_custom();
+    CHECK(settle_calibrating);
+    CHECK(waits_max());
+
+    clk_sys_hz = 125000000;
+    matrix_init_custom();
+    CHECK(!settle_calibrating);
+    CHECK(memcmp(settle, saved, sizeof(saved)) == 0);
+    scan(100);
+}
+
+// The profile is reported at the first key, when the console is likely open
+static void test_print(void) {
+    matrix_init_custom();
+    fake_prints = 0;
+    scan(100);
+    CHECK(settle_report);
+    CHECK_EQ(fake_prints, 0);
+    keys[1] = 0x20;
+    scan(1);
+    CHECK(!settle_report);
+    CHECK_EQ(fake_prints, MATRIX_ROWS);
+    keys[1] = 0;
+    scan(1);
+    CHECK_EQ(fake_prints, MATRIX_ROWS);
+}
+
+int main(void) {
+    test_all_rows();
+    test_clock();
+    test_print();
+    return test_report("matrix_settle");
+}
@@ -0,0 +1,345 @@
+// Adaptive debounce over simulated switches, and the VIA table of a split.
+//
+// Switches bounce for a set number of milliseconds on every change, the
+// matrix is scanned once per millisecond. Both halves run this same unit:
+// the test keeps the half it is not running as on the side and swaps it
+// in to answer RPC transactions, each with its own EEPROM.
+
+#define SPLIT_KEYBOARD
+#define VIA_ENABLE
+#define EECONFIG_KB_DEBOUNCE_OFFSET 0
+#define EECONFIG_KB_DEBOUNCE_SIZE 64
+#include "adaptive_debounce.c"
+#include <time.h>
+#include "fake.h"
+#include "test.h"
+
+typedef struct {
+    debounce_key_t keys[MATRIX_ROWS][MATRIX_COLS];
+    matrix_row_t   raw[MATRIX_ROWS];
+    matrix_row_t   pending[MATRIX_ROWS];
+    uint8_t        rows;
+    bool           reset_pending;
+    bool           save_pending;
+    uint8_t        eeprom[EECONFIG_KB_DEBOUNCE_SIZE];
+} half_t;
+
+static half_t           other;
+static bool             master_left = true;
+static bool             running_master;
+static bool             linked;
+static slave_callback_t debounce_handler;
+
+static matrix_row_t raw[MATRIX_ROWS];
+static matrix_row_t cooked[MATRIX_ROWS];
+
+bool is_keyboard_master(void) {
+    return running_master;
+}
+bool is_keyboard_left(void) {
+    return running_master == master_left;
+}
+
+void transaction_register_rpc(int8_t transaction_id, slave_callback_t callback) {
+    if (transaction_id == RPC_ID_KB_DEBOUNCE) {
+        debounce_handler = callback;
+    }
+}
+
+static void swap_bytes(void *a, void *b, size_t size) {
+    uint8_t swap[sizeof(half_t)];
+
+    memcpy(swap, a, size);
+    memcpy(a, b, size);
+    memcpy(b, swap, size);
+}
+
+static void swap_halves(void) {
+    bool reset_pending = debounce_reset_pending;
+    bool save_pending  = debounce_save_pending;
+
+    swap_bytes(debounce_keys, other.keys, sizeof(other.keys));
+    swap_bytes(debounce_raw, other.raw, sizeof(other.raw));
+    swap_bytes(debounce_pending, other.pending, sizeof(other.pending));
+    swap_bytes(&debounce_rows, &other.rows, sizeof(other.rows));
+    swap_bytes(fake_eeprom, other.eeprom, sizeof(other.eeprom));
+    debounce_reset_pending = other.reset_pending;
+    debounce_save_pending  = other.save_pending;
+    other.reset_pending    = reset_pending;
+    other.save_pending     = save_pending;
+    running_master         = !running_master;
+}
+
+bool transaction_rpc_exec(int8_t transaction_id, uint8_t initiator2target_buffer_size, const void *initiator2target_buffer, uint8_t target2initiator_buffer_size, void *target2initiator_buffer) {
+    if (!linked || transaction_id != RPC_ID_KB_DEBOUNCE || !debounce_handler) {
+        return false;
+    }
+    swap_halves();
+    debounce_handler(initiator2target_buffer_size, initiator2target_buffer, target2initiator_buffer_size, target2initiator_buffer);
+    swap_halves();
+    return true;
+}
+
+static void boot(void) {
+    memset(fake_eeprom, 0, sizeof(fake_eeprom));
+    memset(&other, 0, sizeof(other));
+    memset(raw, 0, sizeof(raw));
+    memset(cooked, 0, sizeof(cooked));
+    memset(debounce_raw, 0, sizeof(debounce_raw));
+    memset(debounce_pending, 0, sizeof(debounce_pending));
+    running_master = false;
+    debounce_init(ROWS_PER_HAND);
+    adaptive_debounce_init();
+    swap_halves();
+    debounce_init(ROWS_PER_HAND);
+    adaptive_debounce_init();
+    linked = true;
+}
+
+static void scan(uint16_t ms) {
+    while (ms--) {
+        test_now++;
+        debounce(raw, cooked, debounce_rows, true);
+    }
+}
+
+// Flips the switch, bouncing for an even number of milliseconds first
+static void flip(uint8_t row, uint8_t col, uint8_t bounce) {
+    for (uint8_t ms = 0; ms <= bounce; ms++) {
+        raw[row] ^= (matrix_row_t)1 << col;
+        scan(1);
+    }
+}
+
+static bool is_on(uint8_t row, uint8_t col) {
+    return cooked[row] & ((matrix_row_t)1 << col);
+}
+
+// A worn switch that opens for 6 ms while held, returns the presses seen
+static uint8_t worn_press(uint8_t row, uint8_t col) {
+    uint8_t presses = 0;
+    bool    was_on  = false;
+
+    for (uint8_t step = 0; step < 4; step++) {
+        static const uint8_t hold[] = {10, 5, 30, 40};
+        flip(row, col, 0);
+        for (uint8_t ms = 0; ms < hold[step]; ms++) {
+            scan(1);
+            presses += is_on(row, col) && !was_on;
+            was_on = is_on(row, col);
+        }
+    }
+    return presses;
+}
+
+// A change is only reported once the switch has been stable for the window
+static void test_settle(void) {
+    boot();
+    flip(0, 0, 2);
+    CHECK(!is_on(0, 0));
+    scan(DEBOUNCE - 1);
+    CHECK(!is_on(0, 0));
+    scan(1);
+    CHECK(is_on(0, 0));
+
+    // A glitch that returns is never reported
+    flip(0, 0, 0);
+    scan(1);
+    flip(0, 0, 0);
+    scan(2 * ADAPTIVE_DEBOUNCE_MAX);
+    CHECK(is_on(0, 0));
+}
+
+// Clean switches shrink towards their bounce, chatter grows the window
+static void test_tune(void) {
+    boot();
+    for (uint16_t i = 0; i < 20 * ADAPTIVE_DEBOUNCE_CLEAN_COUNT; i++) {
+        flip(0, 1, 0);
+        scan(40);
+        flip(1, 2, 2);
+        scan(40);
+    }
+    CHECK_EQ(debounce_keys[0][1].window, MAX(ADAPTIVE_DEBOUNCE_MIN, ADAPTIVE_DEBOUNCE_MARGIN));
+    CHECK_EQ(debounce_keys[1][2].window, 2 + ADAPTIVE_DEBOUNCE_MARGIN);
+    CHECK_EQ(debounce_keys[0][1].chatter, 0);
+
+    // Chatter grows the window past the gap, then the switch reads clean
+    uint8_t presses = 0;
+    for (uint8_t i = 0; i < 20; i++) {
+        presses = worn_press(2, 3);
+    }
+    CHECK(debounce_keys[2][3].chatter > 0);
+    CHECK(debounce_keys[2][3].window > 6);
+    CHECK(debounce_keys[2][3].window < ADAPTIVE_DEBOUNCE_MAX);
+    CHECK_EQ(presses, 1);
+
+    // A saved window outside the bounds set at runtime is not loaded
+    adaptive_debounce_save();
+    adaptive_debounce_min = 3;
+    adaptive_debounce_max = 8;
+    adaptive_debounce_reset();
+    adaptive_debounce_load();
+    CHECK_EQ(debounce_keys[0][1].window, DEBOUNCE);
+    CHECK_EQ(debounce_keys[1][2].window, 2 + ADAPTIVE_DEBOUNCE_MARGIN);
+    adaptive_debounce_min = ADAPTIVE_DEBOUNCE_MIN;
+    adaptive_debounce_max = ADAPTIVE_DEBOUNCE_MAX;
+}
+
+static bool via(uint8_t command, uint8_t value_id, uint8_t row, uint8_t *data) {
+    memset(data, 0, 32);
+    data[0] = command;
+    data[1] = id_custom_channel;
+    data[2] = value_id;
+    data[3] = row;
+    return adaptive_debounce_via_command(data, 32);
+}
+
+// VIA sees the rows of both halves, in keymap order
+static void test_split_table(void) {
+    uint8_t data[32];
+
+    for (uint8_t left = 0; left < 2; left++) {
+        master_left = left;
+        boot();
+        for (uint8_t row = 0; row < ROWS_PER_HAND; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                debounce_keys[row][col].window = 1 + row;
+                other.keys[row][col].window    = 11 + row;
+                other.keys[row][col].chatter   = col;
+            }
+        }
+        uint8_t this_hand = left ? 0 : ROWS_PER_HAND;
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            bool local = row >= this_hand && row < this_hand + ROWS_PER_HAND;
+            CHECK(via(id_custom_get_value, id_adaptive_debounce_row, row, data));
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                CHECK_EQ(data[4 + 2 * col], (local ? 1 : 11) + row % ROWS_PER_HAND);
+                CHECK_EQ(data[5 + 2 * col], local ? 0 : col);
+            }
+        }
+        CHECK(!via(id_custom_get_value, id_adaptive_debounce_row, MATRIX_ROWS, data));
+
+        // Save and reset reach the slave, which runs them from housekeeping
+        CHECK(via(id_custom_save, 0, 0, data));
+        CHECK_EQ(fake_eeprom[1], 1);
+        CHECK_EQ(other.eeprom[0], 0);
+        swap_halves();
+        adaptive_debounce_task();
+        swap_halves();
+        CHECK_EQ(other.eeprom[0], ADAPTIVE_DEBOUNCE_VERSION);
+        CHECK_EQ(other.eeprom[1], 11);
+
+        CHECK(via(id_custom_set_value, id_adaptive_debounce_reset, 0, data));
+        CHECK_EQ(debounce_keys[0][0].window, DEBOUNCE);
+        CHECK_EQ(other.keys[0][0].window, 11);
+        swap_halves();
+        adaptive_debounce_task();
+        swap_halves();
+        CHECK_EQ(other.keys[0][0].window, DEBOUNCE);
+
+        // The slave keeps its saved table across a restart
+        swap_halves();
+        adaptive_debounce_load();
+        CHECK_EQ(debounce_keys[ROWS_PER_HAND - 1][0].window, 11 + ROWS_PER_HAND - 1);
+        swap_halves();
+
+        // Without the slave its rows fail instead of reading stale values
+        linked = false;
+        CHECK(!via(id_custom_get_value, id_adaptive_debounce_row, (this_hand + ROWS_PER_HAND) % MATRIX_ROWS, data));
+        CHECK(via(id_custom_get_value, id_adaptive_debounce_row, this_hand, data));
+        CHECK(!via(id_custom_save, 0, 0, data));
+    }
+    master_left = true;
+}
+
+// Tuned on the slave, read on the master
+static void test_slave_tuning(void) {
+    uint8_t data[32];
+
+    boot();
+    swap_halves();
+    CHECK_EQ(worn_press(1, 4), 2);
+    for (uint8_t i = 0; i < 10; i++) {
+        worn_press(1, 4);
+    }
+    uint8_t window  = debounce_keys[1][4].window;
+    uint8_t chatter = debounce_keys[1][4].chatter;
+    swap_halves();
+    CHECK(chatter > 0);
+    CHECK(via(id_custom_get_value, id_adaptive_debounce_row, ROWS_PER_HAND + 1, data));
+    CHECK_EQ(data[4 + 2 * 4], window);
+    CHECK_EQ(data[5 + 2 * 4], chatter);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static uint32_t seed = 1;
+
+static uint32_t random_below(uint32_t limit) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % limit;
+}
+
+// Time per scan of one half, with nothing changed, with a scan that read
+// no change while a window runs, and while typing with bouncing switches
+static void bench(void) {
+    enum { SCANS = 200000 };
+    uint64_t start, idle, settling, typing;
+
+    boot();
+    start = now_ns();
+    for (uint32_t i = 0; i < SCANS; i++) {
+        test_now++;
+        debounce(raw, cooked, debounce_rows, false);
+    }
+    idle = now_ns() - start;
+
+    raw[0] = 1;
+    debounce(raw, cooked, debounce_rows, true);
+    start = now_ns();
+    for (uint32_t i = 0; i < SCANS; i++) {
+        debounce(raw, cooked, debounce_rows, false);
+    }
+    settling = now_ns() - start;
+
+    // A key every 150 ms, bouncing for up to 4 ms on each edge
+    boot();
+    uint32_t next = 0, bounce_until = 0;
+    uint8_t  row = 0, col = 0;
+    start = now_ns();
+    for (uint32_t i = 0; i < SCANS; i++) {
+        bool changed = false;
+        test_now++;
+        if (i == next) {
+            row          = random_below(debounce_rows);
+            col          = random_below(MATRIX_COLS);
+            bounce_until = i + random_below(5);
+            next         = i + 150;
+        }
+        if (i <= bounce_until) {
+            raw[row] ^= (matrix_row_t)1 << col;
+            changed = true;
+        }
+        debounce(raw, cooked, debounce_rows, changed);
+    }
+    typing = now_ns() - start;
+
+    printf("adaptive debounce, %u rows of %u columns\n", debounce_rows, MATRIX_COLS);
+    printf("  per scan: %.1f ns idle, %.1f ns with a window running, %.1f ns typing\n", (double)idle / SCANS, (double)settling / SCANS, (double)typing / SCANS);
+    test_bench("adaptive_debounce/idle", (double)idle / SCANS);
+    test_bench("adaptive_debounce/window", (double)settling / SCANS);
+    test_bench("adaptive_debounce/typing", (double)typing / SCANS);
+}
+
+int main(void) {
+    test_settle();
+    test_tune();
+    test_split_table();
+    test_slave_tuning();
+    bench();
+    return test_report("adaptive_debounce");
+}
@@ -0,0 +1,321 @@
+// Clock governor over stand-in RP2040 clock, PIO, UART, I2C and regulator
+// registers, on the master and the slave of a split.
+//
+// The registers are plain memory. clock_configure records the clock and
+// which state machines were running when it switched. Time is kept in
+// microseconds. A loop scans, then processes and reports what it found,
+// both taking longer the slower the clock. Reports go to a host driver
+// that records when they arrived.
+
+#define SPLIT_KEYBOARD
+#include "clock_governor.c"
+#include "fake.h"
+#include "test.h"
+
+#define FULL_HZ 125000000
+#define SCAN_US 250
+#define PROCESS_US 400
+
+static uint32_t now_us;
+
+clocks_hw_t              fake_clocks;
+pio_hw_t                 fake_pio[2];
+uart_hw_t                fake_uart[2];
+i2c_hw_t                 fake_i2c[2];
+vreg_and_chip_reset_hw_t fake_vreg;
+
+static int      reports;
+static uint32_t reported_at;
+
+static void host_send_keyboard(report_keyboard_t *report) {
+    reports++;
+    reported_at = now_us;
+}
+
+static host_driver_t host_driver = {.send_keyboard = host_send_keyboard};
+
+static uint32_t clk_sys_hz = FULL_HZ;
+static uint32_t input_at;
+static bool     running_master = true;
+static int      switches;
+static int      switches_running;
+
+uint32_t time_us_32(void) {
+    return now_us;
+}
+
+uint32_t last_input_activity_elapsed(void) {
+    return test_now - input_at;
+}
+
+bool is_keyboard_master(void) {
+    return running_master;
+}
+
+bool clock_configure(enum clock_index clk_index, uint32_t src, uint32_t auxsrc, uint32_t src_freq, uint32_t freq) {
+    CHECK_EQ(clk_index, clk_sys);
+    CHECK_EQ(src_freq, FULL_HZ);
+    switches++;
+    if ((fake_pio[0].ctrl | fake_pio[1].ctrl) & PIO_CTRL_SM_ENABLE_BITS) {
+        switches_running++;
+    }
+    clk_sys_hz = freq;
+    now_us += 10;
+    return true;
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) {
+    return clk_sys_hz;
+}
+
+static void advance_us(uint32_t us) {
+    now_us += us;
+    test_now = now_us / 1000;
+}
+
+static void loop(void) {
+    advance_us(SCAN_US * (FULL_HZ / clk_sys_hz));
+    advance_us(PROCESS_US * (FULL_HZ / clk_sys_hz));
+    clock_governor_task();
+}
+
+static void run_ms(uint32_t ms) {
+    uint32_t until = now_us + ms * 1000;
+
+    while (now_us < until) {
+        loop();
+    }
+}
+
+// Divisors at full speed. Fractions that do not divide evenly are in
+// there on purpose, the split serial one is the one that used to drift.
+static const uint32_t boot_clkdiv[2][NUM_PIO_STATE_MACHINES] = {
+    {0x000F9F00, 0x00100000, 0x00100000, 0x00010000}, // WS2812, two encoders, unused
+    {0x0043D100, 0x00000000, 0x00000000, 0x00000000}, // split serial
+};
+
+static void boot(void) {
+    memset(fake_pio, 0, sizeof(fake_pio));
+    memset(fake_uart, 0, sizeof(fake_uart));
+    memset(&fake_clocks, 0, sizeof(fake_clocks));
+    for (uint8_t p = 0; p < 2; p++) {
+        for (uint8_t sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            fake_pio[p].sm[sm].clkdiv = boot_clkdiv[p][sm];
+        }
+    }
+    fake_pio[0].ctrl = 0x7;
+    fake_pio[1].ctrl = 0x1;
+    // uart0 at 115200 from 125 MHz, uart1 off
+    fake_uart[0].cr    = UART_UARTCR_UARTEN_BITS;
+    fake_uart[0].ibrd  = 67;
+    fake_uart[0].fbrd  = 52;
+    // i2c1 at 400 kHz from 125 MHz as the pico-sdk sets it, i2c0 off
+    memset(fake_i2c, 0, sizeof(fake_i2c));
+    fake_i2c[1].enable      = I2C_IC_ENABLE_ENABLE_BITS;
+    fake_i2c[1].ss_scl_hcnt = 625;
+    fake_i2c[1].ss_scl_lcnt = 625;
+    fake_i2c[1].fs_scl_hcnt = 125;
+    fake_i2c[1].fs_scl_lcnt = 188;
+    fake_i2c[1].fs_spklen   = 11;
+    fake_i2c[1].sda_hold    = 38;
+    host_set_driver(&host_driver);
+    reports = 0;
+    fake_vreg.vreg     = CLOCK_GOVERNOR_VSEL_1_10 << VREG_AND_CHIP_RESET_VREG_VSEL_LSB;
+    clk_sys_hz         = FULL_HZ;
+    governor_full_hz   = 0;
+    governor_level     = 0;
+    governor_stats     = (clock_governor_stats_t){0};
+    switches           = 0;
+    switches_running   = 0;
+    running_master     = true;
+    input_at           = test_now;
+    clock_governor_task();
+}
+
+static bool at_boot_divisors(void) {
+    for (uint8_t p = 0; p < 2; p++) {
+        for (uint8_t sm = 0; sm < NUM_PIO_STATE_MACHINES; sm++) {
+            if (fake_pio[p].sm[sm].clkdiv != boot_clkdiv[p][sm]) {
+                return false;
+            }
+        }
+    }
+    return fake_uart[0].ibrd == 67 && fake_uart[0].fbrd == 52 && fake_i2c[1].fs_scl_hcnt == 125 && fake_i2c[1].fs_scl_lcnt == 188 && fake_i2c[1].ss_scl_lcnt == 625 && fake_i2c[1].fs_spklen == 11 && fake_i2c[1].sda_hold == 38;
+}
+
+// Every level is set from the saved divisors, full speed puts them back
+// exactly, however many times it goes round
+static void test_restore(void) {
+    boot();
+    for (uint8_t round = 0; round < 50; round++) {
+        run_ms(CLOCK_GOVERNOR_HALF_IDLE + 10);
+        CHECK_EQ(clk_sys_hz, FULL_HZ / 2);
+        CHECK_EQ(fake_pio[0].sm[0].clkdiv, 0x000F9F00 / 2 & ~0xFFu);
+        CHECK_EQ(fake_pio[1].sm[0].clkdiv, 0x0043D100 / 2 & ~0xFFu);
+        run_ms(CLOCK_GOVERNOR_QUARTER_IDLE);
+        CHECK_EQ(clk_sys_hz, FULL_HZ / 4);
+        CHECK_EQ(fake_vreg.vreg >> VREG_AND_CHIP_RESET_VREG_VSEL_LSB, CLOCK_GOVERNOR_VSEL_1_00);
+        CHECK_EQ(fake_pio[0].sm[1].clkdiv, 0x00040000);
+        CHECK_EQ(fake_uart[0].ibrd << 6 | fake_uart[0].fbrd, (67u << 6 | 52) / 4);
+        // The OLED bus keeps its 400 kHz, to the rounding of the counts
+        CHECK_EQ(fake_i2c[1].fs_scl_hcnt + fake_i2c[1].fs_scl_lcnt, (125 + 188) / 4);
+        CHECK_EQ(fake_i2c[1].fs_spklen, 2);
+        CHECK_EQ(fake_i2c[1].sda_hold, 9);
+        CHECK_EQ(fake_i2c[1].enable, I2C_IC_ENABLE_ENABLE_BITS);
+
+        input_at = test_now;
+        clock_governor_wake();
+        CHECK_EQ(clk_sys_hz, FULL_HZ);
+        CHECK_EQ(fake_vreg.vreg >> VREG_AND_CHIP_RESET_VREG_VSEL_LSB, CLOCK_GOVERNOR_VSEL_1_10);
+        CHECK(at_boot_divisors());
+    }
+    // Stopped SMs and the UART and I2C that are off are left alone
+    CHECK_EQ(fake_pio[1].sm[1].clkdiv, 0);
+    CHECK_EQ(fake_uart[1].ibrd, 0);
+    CHECK_EQ(fake_i2c[0].fs_scl_hcnt, 0);
+    CHECK_EQ(fake_i2c[0].enable, 0);
+    CHECK_EQ(fake_pio[0].ctrl, 0x7);
+    CHECK_EQ(fake_pio[1].ctrl, 0x1);
+    // Nothing clocked out while clk_sys and the divisors disagreed
+    CHECK(switches > 0);
+    CHECK_EQ(switches_running, 0);
+}
+
+// A state machine that cannot be slowed by four keeps the board at half
+static void test_fits(void) {
+    boot();
+    fake_pio[1].sm[0].clkdiv = 0x00028000; // 2.5
+    run_ms(CLOCK_GOVERNOR_QUARTER_IDLE + 10);
+    CHECK_EQ(clk_sys_hz, FULL_HZ / 2);
+    CHECK_EQ(fake_pio[1].sm[0].clkdiv, 0x00014000);
+
+    fake_pio[1].sm[0].clkdiv = 0x00018000; // 1.5 at full speed
+    input_at                 = test_now;
+    clock_governor_wake();
+    CHECK_EQ(fake_pio[1].sm[0].clkdiv, 0x00028000);
+    fake_pio[1].sm[0].clkdiv = 0x00018000;
+    run_ms(CLOCK_GOVERNOR_QUARTER_IDLE + 10);
+    CHECK_EQ(clk_sys_hz, FULL_HZ);
+    CHECK_EQ(switches, 2);
+
+    // An I2C bus too fast to run at a quarter of the clock
+    boot();
+    fake_i2c[1].fs_scl_hcnt = 20;
+    fake_i2c[1].fs_scl_lcnt = 30;
+    fake_i2c[1].fs_spklen   = 4;
+    run_ms(CLOCK_GOVERNOR_QUARTER_IDLE + 10);
+    CHECK_EQ(clk_sys_hz, FULL_HZ / 2);
+    CHECK_EQ(fake_i2c[1].fs_scl_hcnt, 10);
+}
+
+// The slave answers the master at any time and never switches
+static void test_slave(void) {
+    boot();
+    running_master = false;
+    run_ms(CLOCK_GOVERNOR_QUARTER_IDLE + 10);
+    CHECK_EQ(clk_sys_hz, FULL_HZ);
+    CHECK_EQ(switches, 0);
+    CHECK(at_boot_divisors());
+}
+
+static void send_report(void) {
+    report_keyboard_t report = {0};
+
+    host_get_driver()->send_keyboard(&report);
+}
+
+// A key press seen by the record hook at the given level, reported at the
+// end of its loop
+static uint16_t wake_by_key(uint8_t level) {
+    uint32_t start;
+
+    run_ms(level == 2 ? CLOCK_GOVERNOR_QUARTER_IDLE + 10 : CLOCK_GOVERNOR_HALF_IDLE + 10);
+    CHECK_EQ(governor_level, level);
+
+    // Only the scan of the input loop runs at the slow clock
+    start = now_us;
+    advance_us(SCAN_US * (FULL_HZ / clk_sys_hz));
+    input_at = test_now;
+    clock_governor_wake();
+    CHECK_EQ(clk_sys_hz, FULL_HZ);
+    advance_us(PROCESS_US);
+    send_report();
+    clock_governor_task();
+    CHECK_EQ(governor_stats.wake_last_level, level);
+    CHECK_EQ(governor_stats.wake_last_us, reported_at - start);
+    return governor_stats.wake_last_us;
+}
+
+// Wakes are timed to the first report the host driver gets, from the
+// record hook in the loop that saw the input, from housekeeping a whole
+// slow loop later
+static void test_wake(void) {
+    boot();
+    CHECK(host_get_driver() != &host_driver);
+    uint16_t half    = wake_by_key(1);
+    uint16_t quarter = wake_by_key(2);
+    CHECK_EQ(governor_stats.wakes, 2);
+    CHECK(half < quarter);
+    CHECK_EQ(reports, 2);
+
+    // Later reports are not wakes
+    loop();
+    send_report();
+    CHECK_EQ(governor_stats.wake_last_us, quarter);
+
+    run_ms(CLOCK_GOVERNOR_QUARTER_IDLE + 10);
+    input_at = test_now;
+    uint32_t start = now_us;
+    loop();
+    CHECK_EQ(clk_sys_hz, FULL_HZ);
+    loop();
+    send_report();
+    uint16_t polled = reported_at - start;
+    CHECK_EQ(governor_stats.wakes, 3);
+    CHECK_EQ(governor_stats.wake_last_us, polled);
+    CHECK(quarter < polled);
+    CHECK_EQ(governor_stats.wake_max_us[1], half);
+    CHECK_EQ(governor_stats.wake_max_us[2], polled);
+
+    // A wake that sends nothing is not timed by a report long after
+    run_ms(CLOCK_GOVERNOR_HALF_IDLE + 10);
+    input_at = test_now;
+    clock_governor_wake();
+    run_ms(CLOCK_GOVERNOR_HALF_IDLE + 10);
+    send_report();
+    CHECK_EQ(governor_stats.wake_last_us, polled);
+
+    printf("clock governor, %u us scan and %u us processing at %u MHz\n", SCAN_US, PROCESS_US, FULL_HZ / 1000000);
+    printf("  first report from the record hook %u us after input at /2, %u us at /4, from housekeeping %u us at /4\n", half, quarter, polled);
+}
+
+// Time at each level adds up to the time run
+static void test_level_time(void) {
+    uint32_t total = 0;
+
+    boot();
+    clock_governor_stats();
+    memset(governor_stats.level_ms, 0, sizeof(governor_stats.level_ms));
+    uint32_t start = test_now;
+    run_ms(CLOCK_GOVERNOR_QUARTER_IDLE + 5000);
+    input_at = test_now;
+    clock_governor_wake();
+    run_ms(500);
+    const clock_governor_stats_t *stats = clock_governor_stats();
+    for (uint8_t level = 0; level < CLOCK_GOVERNOR_LEVELS; level++) {
+        total += stats->level_ms[level];
+    }
+    CHECK_EQ(total, test_now - start);
+    CHECK(stats->level_ms[2] >= 5000);
+    CHECK(stats->level_ms[1] >= CLOCK_GOVERNOR_QUARTER_IDLE - CLOCK_GOVERNOR_HALF_IDLE - 10);
+    CHECK(stats->level_ms[0] >= CLOCK_GOVERNOR_HALF_IDLE + 500 - 10);
+}
+
+int main(void) {
+    test_restore();
+    test_fits();
+    test_slave();
+    test_wake();
+    test_level_time();
+    return test_report("clock_governor");
+}
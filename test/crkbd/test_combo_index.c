@@ -0,0 +1,309 @@
+// Combo index matching, and its cost per key event against a linear scan
+// of every combo as the table grows.
+//
+// Outputs are logged by the fake process_record.
+//
+// The keymap has a distinct keycode on every position of layer 0, and
+// layer 1 changes one position. Combos the index cannot place, because a
+// key is on no position of the active layers or on several, must be left
+// to the stock engine through combo_should_trigger.
+
+#define VIAL_COMBO_ENTRIES 512
+#include "combo_index.c"
+#include <stdlib.h>
+#include <time.h>
+#include "fake.h"
+#include "test.h"
+
+#define LAYER_KEY KC_VOLU
+
+static vial_combo_entry_t combos[VIAL_COMBO_ENTRIES];
+static uint16_t           keymap[2][COMBO_INDEX_KEYS];
+static uint16_t           replayed;
+
+int dynamic_keymap_get_combo(uint16_t index, vial_combo_entry_t *entry) {
+    *entry = combos[index];
+    return 0;
+}
+
+uint16_t keymap_key_to_keycode(uint8_t layer, keypos_t key) {
+    return keymap[layer][key.row * MATRIX_COLS + key.col];
+}
+
+uint8_t layer_switch_get_layer(keypos_t key) {
+    layer_state_t state = layer_state | default_layer_state;
+
+    for (int8_t layer = 1; layer > 0; layer--) {
+        if ((state & (1 << layer)) && keymap_key_to_keycode(layer, key) != KC_TRNS) {
+            return layer;
+        }
+    }
+    return 0;
+}
+
+void action_exec(keyevent_t event) {
+    replayed++;
+}
+
+static void reset(void) {
+    memset(combos, 0, sizeof(combos));
+    for (uint8_t pos = 0; pos < COMBO_INDEX_KEYS; pos++) {
+        keymap[0][pos] = KC_A + pos;
+        keymap[1][pos] = KC_TRNS;
+    }
+    keymap[1][0]   = LAYER_KEY;
+    layer_state    = 0;
+    combo_buffered = 0;
+    combo_pressed  = 0;
+    combo_best     = -1;
+    combo_consumed = 0;
+    memset(combo_active_keys, 0, sizeof(combo_active_keys));
+    fake_key_count = 0;
+    replayed       = 0;
+}
+
+static bool key(uint8_t pos, bool pressed) {
+    keyrecord_t record = {.event = {.key = {.col = pos % MATRIX_COLS, .row = pos / MATRIX_COLS}, .type = KEY_EVENT, .pressed = pressed, .time = test_now}};
+
+    return pre_process_combo_index(keymap[0][pos], &record);
+}
+
+// Vial entry i with the keycodes of the given layer 0 positions
+static void combo(uint16_t i, uint16_t output, uint8_t a, uint8_t b) {
+    combos[i] = (vial_combo_entry_t){.input = {keymap[0][a], keymap[0][b]}, .output = output};
+}
+
+static void test_fire(void) {
+    reset();
+    combo(3, KC_ESC, 10, 11);
+    combo_index_init();
+    combo_index_task();
+
+    CHECK(!key(10, true));
+    CHECK(!key(11, true));
+    CHECK_EQ(fake_key_count, 1);
+    CHECK_EQ(fake_keys[0].code, KC_ESC);
+    CHECK_EQ(fake_keys[0].action, FAKE_PRESS);
+    CHECK(!combo_should_trigger(3, NULL, 0, NULL));
+    CHECK(!key(10, false));
+    CHECK_EQ(fake_keys[1].action, FAKE_RELEASE);
+    CHECK(!key(11, false));
+    CHECK_EQ(replayed, 0);
+
+    // A key outside every combo goes straight through
+    CHECK(key(20, true));
+    CHECK(key(20, false));
+
+    // Only one key of the combo is replayed once the term runs out
+    CHECK(!key(10, true));
+    test_now += COMBO_TERM;
+    combo_index_task();
+    CHECK_EQ(replayed, 1);
+    CHECK(key(10, false));
+}
+
+// Outputs the basic key functions cannot send reach process_record whole,
+// pressed while the combo is held
+static void test_outputs(void) {
+    static const uint16_t outputs[] = {LT(1, KC_SPC), QK_MACRO, QK_USER_0};
+
+    reset();
+    for (uint8_t i = 0; i < ARRAY_SIZE(outputs); i++) {
+        combo(i, outputs[i], 2 * i, 2 * i + 1);
+    }
+    combo_index_init();
+    combo_index_task();
+    for (uint8_t i = 0; i < ARRAY_SIZE(outputs); i++) {
+        fake_key_count = 0;
+        CHECK(!key(2 * i, true));
+        CHECK(!key(2 * i + 1, true));
+        CHECK(!key(2 * i, false));
+        CHECK(!key(2 * i + 1, false));
+        CHECK_EQ(fake_key_count, 2);
+        CHECK_EQ(fake_keys[0].code, outputs[i]);
+        CHECK_EQ(fake_keys[0].action, FAKE_PRESS);
+        CHECK_EQ(fake_keys[1].code, outputs[i]);
+        CHECK_EQ(fake_keys[1].action, FAKE_RELEASE);
+    }
+}
+
+// A combo on a key that only layer 1 has is the stock engine's on layer 0
+// and the index's once layer 1 is on
+static void test_layers(void) {
+    reset();
+    combos[0] = (vial_combo_entry_t){.input = {LAYER_KEY, keymap[0][1]}, .output = KC_TAB};
+    combo_index_init();
+    combo_index_task();
+
+    CHECK(key(1, true));
+    CHECK(combo_should_trigger(0, NULL, 0, NULL));
+    CHECK(key(1, false));
+
+    // Until housekeeping maps layer 1 the stock engine has every combo
+    layer_state = 1 << 1;
+    CHECK(combo_should_trigger(0, NULL, 0, NULL));
+    CHECK(key(1, true));
+    CHECK(key(1, false));
+    combo_index_task();
+    CHECK(!key(0, true));
+    CHECK(!combo_should_trigger(0, NULL, 0, NULL));
+    CHECK(!key(1, true));
+    CHECK_EQ(fake_key_count, 1);
+    CHECK_EQ(fake_keys[0].code, KC_TAB);
+    key(0, false);
+    key(1, false);
+
+    // The combo's first key on layer 0 is gone on layer 1
+    combo(1, KC_ENT, 0, 2);
+    combo_index_invalidate();
+    test_now += COMBO_INDEX_REBUILD_DELAY;
+    combo_index_task();
+    CHECK(key(2, true));
+    CHECK(combo_should_trigger(1, NULL, 0, NULL));
+    key(2, false);
+    layer_state = 0;
+    combo_index_task();
+    CHECK(!key(2, true));
+    CHECK(!combo_should_trigger(1, NULL, 0, NULL));
+}
+
+// A keycode on two positions matches either for the stock engine
+static void test_duplicate(void) {
+    reset();
+    keymap[0][30] = keymap[0][5];
+    combo(0, KC_BSPC, 5, 6);
+    combo(1, KC_ESC, 7, 8);
+    combo_index_init();
+    combo_index_task();
+
+    CHECK(key(6, true));
+    CHECK(combo_should_trigger(0, NULL, 0, NULL));
+    CHECK(!combo_should_trigger(1, NULL, 0, NULL));
+}
+
+// Until an edit is rebuilt, the stock engine has every combo
+static void test_edit(void) {
+    reset();
+    combo(0, KC_ESC, 10, 11);
+    combo_index_init();
+    combo_index_task();
+
+    combo_index_invalidate();
+    CHECK(combo_should_trigger(0, NULL, 0, NULL));
+    CHECK(key(10, true));
+    CHECK(key(10, false));
+    test_now += COMBO_INDEX_REBUILD_DELAY;
+    combo_index_task();
+    CHECK(!key(10, true));
+    CHECK(!combo_should_trigger(0, NULL, 0, NULL));
+}
+
+static uint32_t seed = 1;
+
+static uint32_t random_below(uint32_t limit) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % limit;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// What an engine without the index does: every press tests every combo
+static combo_keys_t linear_keys[VIAL_COMBO_ENTRIES];
+static combo_keys_t linear_pressed;
+static uint16_t     linear_count;
+
+static bool linear_key(uint8_t pos, bool pressed) {
+    bool partial = false;
+
+    if (!pressed) {
+        linear_pressed = 0;
+        return true;
+    }
+    linear_pressed |= COMBO_INDEX_BIT(pos);
+    for (uint16_t c = 0; c < linear_count; c++) {
+        if ((linear_keys[c] & linear_pressed) == linear_pressed) {
+            partial = true;
+        }
+    }
+    return partial;
+}
+
+#define BENCH_EVENTS 200000
+
+static void bench(uint16_t count) {
+    static uint8_t typed[BENCH_EVENTS];
+    uint64_t       examined = 0, presses = 0;
+    char           name[32];
+
+    reset();
+    for (uint16_t i = 0; i < count; i++) {
+        uint8_t a = random_below(COMBO_INDEX_KEYS), b = random_below(COMBO_INDEX_KEYS - 1);
+        combo(i, KC_ESC, a, b >= a ? b + 1 : b);
+        if (random_below(3) == 0) {
+            combos[i].input[2] = keymap[0][random_below(COMBO_INDEX_KEYS)];
+        }
+    }
+    combo_index_init();
+    combo_index_task();
+    CHECK_EQ(combo_count, count);
+
+    linear_count = count;
+    for (uint16_t c = 0; c < count; c++) {
+        linear_keys[c] = combo_keys[c];
+    }
+    for (uint32_t i = 0; i < BENCH_EVENTS; i++) {
+        typed[i] = random_below(COMBO_INDEX_KEYS);
+    }
+
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < BENCH_EVENTS; i += 2) {
+        test_now += 30;
+        key(typed[i], true);
+        examined += combo_first[typed[i] + 1] - combo_first[typed[i]];
+        presses++;
+        test_now += 30;
+        key(typed[i], false);
+        combo_index_task();
+        fake_key_count = 0;
+    }
+    uint64_t indexed = now_ns() - start;
+
+    start = now_ns();
+    for (uint32_t i = 0; i < BENCH_EVENTS; i += 2) {
+        linear_key(typed[i], true);
+        linear_key(typed[i], false);
+    }
+    uint64_t linear = now_ns() - start;
+
+    // A layer change maps the positions again from housekeeping
+    start = now_ns();
+    for (uint8_t i = 0; i < 100; i++) {
+        combo_index_map();
+    }
+    uint64_t map = now_ns() - start;
+
+    printf("  %3u combos: index %5.1f ns/event, %4.1f candidates/press; linear scan %6.1f ns/event; remap %5.1f us\n", count, (double)indexed / BENCH_EVENTS, (double)examined / presses, (double)linear / BENCH_EVENTS, (double)map / 100 / 1000);
+    CHECK(examined / presses <= (uint64_t)count * 3 * 4 / COMBO_INDEX_KEYS + 1);
+    snprintf(name, sizeof(name), "combo_index/event_%u", count);
+    test_bench(name, (double)indexed / BENCH_EVENTS);
+    snprintf(name, sizeof(name), "combo_index/remap_%u", count);
+    test_bench(name, (double)map / 100);
+}
+
+int main(void) {
+    test_fire();
+    test_outputs();
+    test_layers();
+    test_duplicate();
+    test_edit();
+
+    printf("combo index cost per key event\n");
+    bench(10);
+    bench(100);
+    bench(500);
+    return test_report("combo_index");
+}
@@ -0,0 +1,145 @@
+#define RGB_MATRIX_ENABLE
+#include "encoder_accel.c"
+#include "fake.h"
+#include "test.h"
+
+static void detent(uint8_t encoder, uint16_t keycode) {
+    keyrecord_t record = {.event = {.key = {.col = encoder, .row = 0}, .type = ENCODER_CW_EVENT, .pressed = true, .time = test_now}};
+
+    CHECK(!process_encoder_accel(keycode, &record));
+    record.event.pressed = false;
+    process_encoder_accel(keycode, &record);
+}
+
+// Runs housekeeping once per millisecond
+static void run(uint16_t ms) {
+    while (ms--) {
+        test_now++;
+        encoder_accel_task();
+    }
+}
+
+static void reset(void) {
+    memset(encoder_accel, 0, sizeof(encoder_accel));
+    encoder_accel_rgb_dirty = false;
+    fake_key_count          = 0;
+    fake_mods               = 0;
+    fake_rgb                = (fake_rgb_t){.mode = 1, .val = 100};
+    run(ENCODER_ACCEL_IDLE_MS);
+}
+
+static void test_curve(void) {
+    uint8_t last = ENCODER_ACCEL_MAX_MULTIPLIER;
+
+    CHECK_EQ(encoder_accel_multiplier(0), ENCODER_ACCEL_MAX_MULTIPLIER);
+    CHECK_EQ(encoder_accel_multiplier(ENCODER_ACCEL_FAST_MS), ENCODER_ACCEL_MAX_MULTIPLIER);
+    CHECK_EQ(encoder_accel_multiplier(ENCODER_ACCEL_SLOW_MS), 1);
+    CHECK_EQ(encoder_accel_multiplier(UINT16_MAX), 1);
+    for (uint16_t interval = 0; interval <= ENCODER_ACCEL_SLOW_MS + 10; interval++) {
+        uint8_t multiplier = encoder_accel_multiplier(interval);
+        CHECK(multiplier >= 1 && multiplier <= last);
+        last = multiplier;
+    }
+}
+
+// Slow detents are one volume step each, sent in the frame they land in
+static void test_slow_volume(void) {
+    reset();
+    for (uint8_t i = 0; i < 5; i++) {
+        detent(0, KC_VOLU);
+        run(100);
+    }
+    CHECK_EQ(fake_key_count, 5);
+    for (uint16_t i = 0; i < fake_key_count; i++) {
+        CHECK_EQ(fake_keys[i].code, KC_VOLU);
+    }
+}
+
+// A fast spin sends more steps than detents, as stock firmware sends one
+// per detent, spaced for the host and stopping soon after the encoder does
+static void test_fast_volume(void) {
+    for (uint8_t interval = 5; interval <= 30; interval += 5) {
+        reset();
+        for (uint8_t i = 0; i < 40; i++) {
+            detent(0, KC_VOLD);
+            run(interval);
+        }
+        uint16_t spinning = fake_key_count;
+        uint32_t stopped  = test_now;
+        run(ENCODER_ACCEL_IDLE_MS);
+
+        CHECK(spinning > 40);
+        CHECK((int32_t)(fake_keys[fake_key_count - 1].time - stopped) <= ENCODER_ACCEL_FRAME_MS + encoder_accel_volume_cap() * ENCODER_ACCEL_VOLUME_MS);
+        for (uint16_t i = 1; i < fake_key_count; i++) {
+            CHECK(fake_keys[i].time - fake_keys[i - 1].time >= ENCODER_ACCEL_VOLUME_MS);
+        }
+        if (interval == 10) {
+            printf("encoder accel, 40 detents %u ms apart: %u volume steps while spinning, the last %u ms after\n", interval, spinning, fake_keys[fake_key_count - 1].time - stopped);
+        }
+    }
+}
+
+// Turning back drops the steps still queued the old way
+static void test_reverse_volume(void) {
+    reset();
+    for (uint8_t i = 0; i < 10; i++) {
+        detent(0, KC_VOLU);
+        run(2);
+    }
+    run(ENCODER_ACCEL_FRAME_MS);
+    uint16_t up = fake_key_count;
+    detent(0, KC_VOLD);
+    run(ENCODER_ACCEL_FRAME_MS * (ENCODER_ACCEL_MAX_MULTIPLIER + 2));
+    for (uint16_t i = up; i < fake_key_count; i++) {
+        CHECK_EQ(fake_keys[i].code, KC_VOLD);
+    }
+}
+
+// Brightness moves by the accelerated amount in one update, without an
+// EEPROM write until the encoder rests
+static void test_rgb_value(void) {
+    reset();
+    for (uint8_t i = 0; i < 4; i++) {
+        detent(1, RGB_VAI);
+        run(5);
+    }
+    run(ENCODER_ACCEL_FRAME_MS);
+    CHECK(fake_rgb.val > 100 + 4 * RGB_MATRIX_VAL_STEP);
+    CHECK(fake_rgb.val <= RGB_MATRIX_MAXIMUM_BRIGHTNESS);
+    CHECK_EQ(fake_rgb.eeprom_writes, 0);
+    run(ENCODER_ACCEL_IDLE_MS);
+    CHECK_EQ(fake_rgb.eeprom_writes, 1);
+    run(ENCODER_ACCEL_IDLE_MS);
+    CHECK_EQ(fake_rgb.eeprom_writes, 1);
+}
+
+// Effects step once per detent, backwards with Shift held
+static void test_rgb_mode_shift(void) {
+    reset();
+    fake_rgb.mode = 5;
+    detent(0, RGB_MOD);
+    run(ENCODER_ACCEL_FRAME_MS);
+    CHECK_EQ(fake_rgb.mode, 6);
+
+    fake_mods = MOD_BIT(KC_LSFT);
+    detent(0, RGB_MOD);
+    run(100);
+    detent(0, RGB_MOD);
+    run(ENCODER_ACCEL_FRAME_MS);
+    CHECK_EQ(fake_rgb.mode, 4);
+
+    fake_rgb.mode = 1;
+    detent(0, RGB_MOD);
+    run(ENCODER_ACCEL_FRAME_MS);
+    CHECK_EQ(fake_rgb.mode, RGB_MATRIX_EFFECT_MAX - 1);
+}
+
+int main(void) {
+    test_curve();
+    test_slow_volume();
+    test_fast_volume();
+    test_reverse_volume();
+    test_rgb_value();
+    test_rgb_mode_shift();
+    return test_report("encoder_accel");
+}
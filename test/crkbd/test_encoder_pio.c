@@ -0,0 +1,262 @@
+// PIO encoder driver over stand-in state machines. Each one keeps the
+// count the test turned it to and pushes it into a four deep RX FIFO that
+// drops pushes when full, as push noblock does. A sample loop is a few
+// microseconds, so the FIFO is full again right after every read, with
+// the count of that moment. The event queue takes as many events a loop
+// as the test allows.
+
+#define ENCODER_A_PINS {2, 4}
+#define ENCODER_B_PINS {3, 5}
+#include "encoder_pio.c"
+#include "fake.h"
+#include "test.h"
+
+#define FIFO_DEPTH 4
+
+pio_hw_t fake_pio[2];
+
+static uint32_t unreset;
+static bool     unreset_before_add;
+static int      programs;
+static int      claimed;
+static uint32_t preload[NUM_PIO_STATE_MACHINES];
+static uint32_t tx[NUM_PIO_STATE_MACHINES];
+static uint32_t counts[NUM_PIO_STATE_MACHINES];
+static uint32_t fifo[NUM_PIO_STATE_MACHINES][FIFO_DEPTH];
+static uint8_t  fifo_level[NUM_PIO_STATE_MACHINES];
+static uint8_t  pins[32];
+static uint8_t  queue_room;
+static int      events[2][2];
+
+void hal_lld_peripheral_unreset(uint32_t mask) {
+    unreset |= mask;
+}
+
+bool pio_can_add_program(PIO pio, const pio_program_t *program) {
+    CHECK(pio == ENCODER_PIO);
+    return programs == 0;
+}
+
+uint pio_add_program(PIO pio, const pio_program_t *program) {
+    unreset_before_add = unreset & RESETS_ALLREG_PIO1;
+    CHECK_EQ(program->length, ENCODER_PIO_LENGTH);
+    programs++;
+    return 0;
+}
+
+int pio_claim_unused_sm(PIO pio, bool required) {
+    return claimed < NUM_PIO_STATE_MACHINES ? claimed++ : -1;
+}
+
+void pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config) {
+    CHECK_EQ(initial_pc, ENCODER_PIO_UPDATE);
+    fifo_level[sm] = 0;
+}
+
+void pio_sm_put(PIO pio, uint sm, uint32_t data) {
+    tx[sm] = data;
+}
+
+// Only the preload of the previous AB, which is pulled from TX
+void pio_sm_exec(PIO pio, uint sm, uint instr) {
+    if (instr == pio_encode_pull(false, false)) {
+        preload[sm] = tx[sm];
+    }
+}
+
+static void refill(uint8_t sm) {
+    while (fifo_level[sm] < FIFO_DEPTH) {
+        fifo[sm][fifo_level[sm]++] = counts[sm];
+    }
+}
+
+void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) {
+    hw_write_masked(&pio->ctrl, enabled << sm, 1u << sm);
+    refill(sm);
+}
+
+bool pio_sm_is_rx_fifo_empty(PIO pio, uint sm) {
+    return fifo_level[sm] == 0;
+}
+
+uint32_t pio_sm_get(PIO pio, uint sm) {
+    uint32_t count = fifo[sm][0];
+
+    CHECK(fifo_level[sm] > 0);
+    memmove(&fifo[sm][0], &fifo[sm][1], sizeof(fifo[sm][0]) * (FIFO_DEPTH - 1));
+    fifo_level[sm]--;
+    return count;
+}
+
+void gpio_set_pin_input_high(pin_t pin) {}
+
+uint8_t gpio_read_pin(pin_t pin) {
+    return pins[pin];
+}
+
+bool encoder_queue_event(uint8_t index, bool clockwise) {
+    if (queue_room == 0) {
+        return false;
+    }
+    queue_room--;
+    events[index][clockwise]++;
+    return true;
+}
+
+// Steps of a quarter detent each, while the FIFO is full
+static void turn(uint8_t sm, int32_t steps) {
+    counts[sm] += steps;
+}
+
+static void task(uint8_t room) {
+    queue_room = room;
+    encoder_driver_task();
+    for (uint8_t sm = 0; sm < claimed; sm++) {
+        refill(sm);
+    }
+}
+
+// The loop that reads the FIFO filled after a turn
+static void tasks(uint8_t room) {
+    task(0);
+    task(room);
+}
+
+static void boot(void) {
+    memset(fake_pio, 0, sizeof(fake_pio));
+    memset(counts, 0, sizeof(counts));
+    memset(fifo_level, 0, sizeof(fifo_level));
+    memset(events, 0, sizeof(events));
+    memset(encoder_residual, 0, sizeof(encoder_residual));
+    unreset  = 0;
+    programs = 0;
+    claimed  = 0;
+    encoder_driver_init();
+}
+
+static void test_detents(void) {
+    int32_t residual = 0;
+
+    CHECK_EQ(encoder_pio_detents(&residual, 3), 0);
+    CHECK_EQ(residual, 3);
+    CHECK_EQ(encoder_pio_detents(&residual, 1), 1);
+    CHECK_EQ(residual, 0);
+    CHECK_EQ(encoder_pio_detents(&residual, 9), 2);
+    CHECK_EQ(residual, 1);
+    CHECK_EQ(encoder_pio_detents(&residual, -2), 0);
+    CHECK_EQ(residual, -1);
+    CHECK_EQ(encoder_pio_detents(&residual, -7), -2);
+    CHECK_EQ(residual, 0);
+    CHECK_EQ(encoder_pio_detents(&residual, -ENCODER_RESOLUTION * 1000 - 1), -1000);
+    CHECK_EQ(residual, -1);
+}
+
+// The block comes out of reset before the program goes in, and every state
+// machine starts from the AB its pins read
+static void test_init(void) {
+    pins[2] = 1;
+    pins[3] = 0;
+    pins[4] = 1;
+    pins[5] = 1;
+    boot();
+    CHECK(unreset_before_add);
+    CHECK_EQ(unreset, RESETS_ALLREG_PIO1);
+    CHECK_EQ(fake_pio[1].ctrl, 0x3);
+    CHECK_EQ(preload[0], 0x2);
+    CHECK_EQ(preload[1], 0x3);
+    CHECK_EQ(encoder_count[0], 0);
+
+    // Nothing pushed yet, nothing turned
+    tasks(8);
+    CHECK_EQ(events[0][0] + events[0][1] + events[1][0] + events[1][1], 0);
+
+    // Instruction memory taken, no encoders and no reads
+    encoder_driver_init();
+    CHECK_EQ(encoder_local, 0);
+    tasks(8);
+}
+
+// A turn is seen in the loop after it, from the newest count in the
+// FIFO. An empty FIFO keeps the last count.
+static void test_read(void) {
+    boot();
+    turn(0, 4);
+    turn(1, -8);
+    task(8);
+    CHECK_EQ(events[0][ENCODER_PIO_CLOCKWISE], 0);
+    task(8);
+    CHECK_EQ(events[0][ENCODER_PIO_CLOCKWISE], 1);
+    CHECK_EQ(events[1][!ENCODER_PIO_CLOCKWISE], 2);
+    CHECK_EQ(encoder_count[0], 4);
+
+    fifo[0][FIFO_DEPTH - 1] = 8;
+    task(8);
+    CHECK_EQ(events[0][ENCODER_PIO_CLOCKWISE], 2);
+    CHECK_EQ(fifo_level[0], FIFO_DEPTH);
+
+    fifo_level[0] = 0;
+    counts[0]     = 12;
+    encoder_driver_task();
+    CHECK_EQ(encoder_count[0], 8);
+    CHECK_EQ(events[0][ENCODER_PIO_CLOCKWISE], 2);
+    tasks(8);
+    CHECK_EQ(events[0][ENCODER_PIO_CLOCKWISE], 3);
+}
+
+// Y wraps both ways, the difference of two counts is still the turn
+static void test_wrap(void) {
+    boot();
+    turn(0, -6);
+    tasks(8);
+    CHECK_EQ(encoder_count[0], (uint32_t)-6);
+    CHECK_EQ(events[0][!ENCODER_PIO_CLOCKWISE], 1);
+    turn(0, 10);
+    tasks(8);
+    CHECK_EQ(encoder_count[0], 4);
+    CHECK_EQ(events[0][ENCODER_PIO_CLOCKWISE], 2);
+    CHECK_EQ(encoder_residual[0], 0);
+
+    counts[0]        = INT32_MAX - 1;
+    encoder_count[0] = INT32_MAX - 1;
+    turn(0, 8);
+    tasks(8);
+    CHECK_EQ(events[0][ENCODER_PIO_CLOCKWISE], 4);
+}
+
+// Detents that do not fit in the event queue are sent in later loops, and
+// a turn back cancels those still waiting
+static void test_requeue(void) {
+    boot();
+    turn(0, 4 * ENCODER_RESOLUTION);
+    tasks(1);
+    CHECK_EQ(events[0][ENCODER_PIO_CLOCKWISE], 1);
+    CHECK_EQ(encoder_residual[0], 3 * ENCODER_RESOLUTION);
+    task(0);
+    CHECK_EQ(events[0][ENCODER_PIO_CLOCKWISE], 1);
+    task(2);
+    CHECK_EQ(events[0][ENCODER_PIO_CLOCKWISE], 3);
+
+    // One detent still waits, the turn back takes it and one more
+    CHECK_EQ(encoder_residual[0], ENCODER_RESOLUTION);
+    turn(0, -2 * ENCODER_RESOLUTION - 1);
+    tasks(8);
+    CHECK_EQ(events[0][ENCODER_PIO_CLOCKWISE], 3);
+    CHECK_EQ(events[0][!ENCODER_PIO_CLOCKWISE], 1);
+    CHECK_EQ(encoder_residual[0], -1);
+
+    turn(0, -1);
+    tasks(8);
+    CHECK_EQ(events[0][ENCODER_PIO_CLOCKWISE], 3);
+    CHECK_EQ(events[0][!ENCODER_PIO_CLOCKWISE], 1);
+    CHECK_EQ(encoder_residual[0], -2);
+    CHECK_EQ(events[1][0] + events[1][1], 0);
+}
+
+int main(void) {
+    test_detents();
+    test_init();
+    test_read();
+    test_wrap();
+    test_requeue();
+    return test_report("encoder_pio");
+}
@@ -0,0 +1,265 @@
+// Fast send through a simulated keyboard endpoint.
+//
+// The endpoint holds one report. The host polls it every millisecond and
+// types the keys that went down since the last report, in usage order, or
+// in reverse for a host that does not keep the order. A report sent while
+// the last one is still waiting blocks until the next poll, as on the
+// board. Housekeeping runs several times per millisecond. The report gives
+// characters per second for each batch size and checks the text typed.
+
+#define NKRO_ENABLE
+#define VIA_ENABLE
+#include "fast_send.c"
+#include <stdlib.h>
+#include "fake.h"
+#include "test.h"
+
+// US layout, as in QMK's keymap_us.h
+const uint8_t ascii_to_shift_lut[16] = {0x00, 0x00, 0x00, 0x00, 0x7E, 0x0F, 0x00, 0xD4, 0xFF, 0xFF, 0xFF, 0xC7, 0x00, 0x00, 0x00, 0x78};
+const uint8_t ascii_to_altgr_lut[16];
+const uint8_t ascii_to_dead_lut[16];
+const uint8_t ascii_to_keycode_lut[128] = {
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2A, 0x2B, 0x28, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x29, 0x00, 0x00, 0x00, 0x00,
+    0x2C, 0x1E, 0x34, 0x20, 0x21, 0x22, 0x24, 0x34, 0x26, 0x27, 0x25, 0x2E, 0x36, 0x2D, 0x37, 0x38,
+    0x27, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x33, 0x33, 0x36, 0x2E, 0x37, 0x38,
+    0x1F, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12,
+    0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x2F, 0x31, 0x30, 0x23, 0x2D,
+    0x35, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12,
+    0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x2F, 0x31, 0x30, 0x35, 0x00,
+};
+
+typedef struct {
+    uint8_t keys[32];
+    uint8_t mods;
+} report_t;
+
+// Board side
+static report_t board;
+static uint8_t  weak_mods;
+
+// Endpoint and host
+static report_t endpoint, host;
+static bool     endpoint_full;
+static bool     host_reorders;
+static uint32_t host_blocked;
+static char     typed[4096];
+static uint16_t typed_length;
+static char     from_key[2][256];
+
+static bool has(const report_t *report, uint8_t key) {
+    return report->keys[key / 8] & (1 << (key % 8));
+}
+
+static void host_type(uint8_t key, uint8_t mods) {
+    char c = from_key[(mods & MOD_MASK_SHIFT) != 0][key];
+    if (c && typed_length < sizeof(typed) - 1) {
+        typed[typed_length++] = c;
+    }
+}
+
+static void host_poll(void) {
+    if (!endpoint_full) {
+        return;
+    }
+    for (uint16_t i = 0; i < 256; i++) {
+        uint8_t key = host_reorders ? 255 - i : i;
+        if (has(&endpoint, key) && !has(&host, key)) {
+            host_type(key, endpoint.mods);
+        }
+    }
+    host          = endpoint;
+    endpoint_full = false;
+}
+
+void send_keyboard_report(void) {
+    if (endpoint_full) {
+        host_blocked++;
+        host_poll();
+    }
+    endpoint      = board;
+    endpoint.mods = fake_mods | weak_mods;
+    endpoint_full = true;
+}
+
+void add_key(uint8_t key) {
+    board.keys[key / 8] |= 1 << (key % 8);
+}
+void del_key(uint8_t key) {
+    board.keys[key / 8] &= ~(1 << (key % 8));
+}
+void set_weak_mods(uint8_t mods) {
+    weak_mods = mods;
+}
+void clear_weak_mods(void) {
+    weak_mods = 0;
+}
+
+void register_code(uint8_t code) {
+    if (IS_MODIFIER_KEYCODE(code)) {
+        fake_mods |= MOD_BIT(code);
+    } else {
+        add_key(code);
+    }
+    send_keyboard_report();
+}
+void unregister_code(uint8_t code) {
+    if (IS_MODIFIER_KEYCODE(code)) {
+        fake_mods &= ~MOD_BIT(code);
+    } else {
+        del_key(code);
+    }
+    send_keyboard_report();
+}
+
+static uint8_t  macros[64];
+static uint16_t macros_size;
+
+uint16_t dynamic_keymap_macro_get_buffer_size(void) {
+    return sizeof(macros);
+}
+void dynamic_keymap_macro_get_buffer(uint16_t offset, uint16_t size, uint8_t *data) {
+    memcpy(data, &macros[offset], size);
+}
+
+static void reset(uint8_t batch, bool reorders) {
+    memset(&board, 0, sizeof(board));
+    memset(&host, 0, sizeof(host));
+    endpoint_full   = false;
+    host_reorders   = reorders;
+    host_blocked    = 0;
+    typed_length    = 0;
+    memset(typed, 0, sizeof(typed));
+    fast_send_batch    = batch;
+    keymap_config.nkro = true;
+    fake_mods          = 0;
+    fake_sends         = 0;
+}
+
+// Runs until the queue is empty, returns the milliseconds it took
+static uint32_t run(void) {
+    uint32_t start = test_now;
+
+    while (fast_send_busy() || endpoint_full) {
+        for (uint8_t i = 0; i < 4; i++) {
+            fast_send_task();
+        }
+        host_poll();
+        test_now++;
+    }
+    return test_now - start;
+}
+
+static const char text[] =
+    "The quick brown fox jumps over the lazy dog, 1234567890 times!\n"
+    "Hello, World: aabbcc \"quoted\" (parens) [brackets] {braces} a+b=c; x_y-z.\n"
+    "Mixed CaSe TeXt with ~tilde~ and `backticks` and a/b\\c|d?\n";
+
+static void test_rate(void) {
+    uint32_t ms;
+
+    printf("fast send, %u characters\n", (unsigned)strlen(text));
+    for (uint8_t batch = 1; batch <= FAST_SEND_BATCH_MAX; batch = batch == 1 ? 6 : batch + 10) {
+        reset(batch, false);
+        uint32_t before = test_now;
+        fast_send_string(text);
+        // Queuing returns right away, nothing is sent from the caller
+        CHECK_EQ(test_now, before);
+        CHECK(!endpoint_full);
+        ms = run();
+        CHECK(strcmp(typed, text) == 0);
+        printf("  batch %2u: %5u chars/s, %u blocked sends\n", batch, (unsigned)(strlen(text) * 1000 / ms), (unsigned)host_blocked);
+    }
+
+    // Without NKRO a report holds six keys
+    reset(FAST_SEND_BATCH_MAX, false);
+    keymap_config.nkro = false;
+    fast_send_string(text);
+    run();
+    CHECK(strcmp(typed, text) == 0);
+}
+
+// A host that reorders the keys of a report garbles batches, one key per
+// report is right on any host
+static void test_reordering_host(void) {
+    reset(6, true);
+    fast_send_string("abcdef");
+    run();
+    CHECK(strcmp(typed, "abcdef") != 0);
+
+    reset(1, true);
+    fast_send_string(text);
+    run();
+    CHECK(strcmp(typed, text) == 0);
+}
+
+static void test_stock_fallback(void) {
+    reset(0, false);
+    fast_send_string("stock");
+    CHECK(!fast_send_busy());
+    CHECK_EQ(fake_sends, 1);
+    CHECK(strcmp(fake_sent, "stock") == 0);
+    CHECK(!fast_send_macro(0));
+}
+
+static void macro_add(const char *bytes, size_t length) {
+    memcpy(&macros[macros_size], bytes, length);
+    macros_size += length + 1;
+}
+
+// SEND_STRING codes in a VIA macro: taps, holds and delays
+static void test_macro(void) {
+    static const char first[]  = "x";
+    static const char second[] = "ab" "\x01\x01\x28" "\x01\x02\xE1" "cd" "\x01\x03\xE1" "\x01\x04" "20|" "e";
+    static const char vial[]   = "a" "\x01\x05\x04\x01";
+
+    memset(macros, 0, sizeof(macros));
+    macros_size = 0;
+    macro_add(first, sizeof(first) - 1);
+    macro_add(second, sizeof(second) - 1);
+    macro_add(vial, sizeof(vial) - 1);
+
+    reset(6, false);
+    CHECK(fast_send_macro(1));
+    uint32_t ms = run();
+    CHECK(strcmp(typed, "ab\nCDe") == 0);
+    CHECK(ms >= 20);
+    CHECK_EQ(fake_mods, 0);
+
+    reset(6, false);
+    CHECK(fast_send_macro(0));
+    run();
+    CHECK(strcmp(typed, "x") == 0);
+
+    // Codes only the stock player knows leave the macro to it
+    CHECK(!fast_send_macro(2));
+    CHECK(!fast_send_busy());
+}
+
+// A string longer than the queue is sent in place until the rest fits
+static void test_overflow(void) {
+    static char long_text[1024];
+
+    for (uint16_t i = 0; i < sizeof(long_text) - 1; i++) {
+        long_text[i] = 'a' + i % 26;
+    }
+    reset(6, false);
+    fast_send_string(long_text);
+    run();
+    CHECK(strcmp(typed, long_text) == 0);
+}
+
+int main(void) {
+    for (uint8_t c = 0; c < 128; c++) {
+        uint8_t key = ascii_to_keycode_lut[c];
+        if (key && !from_key[FAST_SEND_LOADBIT(ascii_to_shift_lut, c)][key]) {
+            from_key[FAST_SEND_LOADBIT(ascii_to_shift_lut, c)][key] = c;
+        }
+    }
+    test_rate();
+    test_reordering_host();
+    test_stock_fallback();
+    test_macro();
+    test_overflow();
+    return test_report("fast_send");
+}
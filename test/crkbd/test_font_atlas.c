@@ -0,0 +1,215 @@
+// Glyph atlas against the stock font it is generated from, and the cost
+// of drawing a character against copying it from the stock table.
+//
+// The atlas comes from font_atlas.py with the default glyph list and is
+// read back into the arrays of the stand-in font_atlas_data.h. Text goes
+// into the fake OLED buffer.
+
+#include "font_atlas.c"
+#include "lib/glcdfont.c"
+#define font blank_font
+#include "lib/font_blank.c"
+#undef font
+#include <stdlib.h>
+#include <time.h>
+#include "fake.h"
+#include "test.h"
+
+#define GLYPHS "20-7e,80-94,a0-b4,c0-d4"
+
+static bool atlas_has(uint8_t c) {
+    return (c >= 0x20 && c <= 0x7E) || (c >= 0x80 && c <= 0x94) || (c >= 0xA0 && c <= 0xB4) || (c >= 0xC0 && c <= 0xD4);
+}
+
+// Reads the number list that follows name in a generated header
+static size_t atlas_read_array(const char *text, const char *name, void *out, size_t size) {
+    const char *p     = strstr(text, name);
+    size_t      count = 0;
+    char       *end;
+
+    p = strchr(p, '{') + 1;
+    while (count < FONT_ATLAS_DATA_MAX) {
+        unsigned long value = strtoul(p, &end, 0);
+        if (end == p) {
+            break;
+        }
+        if (size == 1) {
+            ((uint8_t *)out)[count++] = value;
+        } else {
+            ((uint16_t *)out)[count++] = value;
+        }
+        p = end + strspn(end, ", \n");
+    }
+    return count;
+}
+
+static unsigned atlas_read_define(const char *text, const char *name) {
+    return strtoul(strstr(text, name) + strlen(name), NULL, 0);
+}
+
+static size_t atlas_load(void) {
+    char   command[512];
+    char  *text = calloc(1, 1 << 16);
+    FILE  *file;
+    size_t size;
+
+    snprintf(command, sizeof(command), "python3 %s/font_atlas.py %s/lib/glcdfont.c build/font_atlas_data.h " GLYPHS, CRKBD_PATH, CRKBD_PATH);
+    CHECK_EQ(system(command), 0);
+    file = fopen("build/font_atlas_data.h", "r");
+    CHECK(file != NULL);
+    if (file == NULL) {
+        exit(1);
+    }
+    fread(text, 1, (1 << 16) - 1, file);
+    fclose(file);
+    font_atlas_first = atlas_read_define(text, "FONT_ATLAS_FIRST ");
+    font_atlas_last  = atlas_read_define(text, "FONT_ATLAS_LAST ");
+    font_atlas_width = atlas_read_define(text, "FONT_ATLAS_WIDTH ");
+    font_atlas_group = atlas_read_define(text, "FONT_ATLAS_GROUP ");
+    size             = 2 * atlas_read_array(text, "font_atlas_index[]", font_atlas_index, 2);
+    size += atlas_read_array(text, "font_atlas_glyphs[]", font_atlas_glyphs, 1);
+    free(text);
+    return size;
+}
+
+// Every glyph decodes to the stock columns, glyphs left out are blank
+static void test_fixed(void) {
+    font_atlas_set_proportional(false);
+    for (unsigned c = 1; c < 0x100; c++) {
+        if (c == '\n') {
+            continue;
+        }
+        memset(fake_oled, 0xAA, sizeof(fake_oled));
+        font_atlas_set_cursor(0, 1);
+        font_atlas_write_char(c, false);
+        for (uint8_t i = 0; i < FONT_ATLAS_WIDTH; i++) {
+            CHECK_EQ(fake_oled[OLED_DISPLAY_WIDTH + i], atlas_has(c) ? font[c * FONT_ATLAS_WIDTH + i] : 0);
+        }
+        CHECK_EQ(fake_oled[OLED_DISPLAY_WIDTH + FONT_ATLAS_WIDTH], 0xAA);
+        CHECK_EQ(fake_oled[0], 0xAA);
+        CHECK_EQ(font_x, FONT_ATLAS_WIDTH);
+    }
+
+    // Inverted glyphs flip every column
+    font_atlas_set_cursor(0, 0);
+    font_atlas_write_char('A', true);
+    for (uint8_t i = 0; i < FONT_ATLAS_WIDTH; i++) {
+        CHECK_EQ(fake_oled[i], (uint8_t)~font['A' * FONT_ATLAS_WIDTH + i]);
+    }
+}
+
+// Proportional glyphs keep their inked columns and one blank after them
+static void test_proportional(void) {
+    static const char text[] = "Layer: Default";
+    uint8_t           width  = 0;
+
+    font_atlas_set_proportional(true);
+    for (const char *c = text; *c; c++) {
+        const uint8_t *glyph = &font[(uint8_t)*c * FONT_ATLAS_WIDTH];
+        uint8_t        first = 0, last = 0;
+        bool           inked = false;
+
+        for (uint8_t i = 0; i < FONT_ATLAS_WIDTH; i++) {
+            if (glyph[i]) {
+                last  = i;
+                first = inked ? first : i;
+                inked = true;
+            }
+        }
+        font_atlas_set_cursor(10, 2);
+        memset(fake_oled, 0, sizeof(fake_oled));
+        font_atlas_write_char(*c, false);
+        uint8_t advance = inked ? last - first + 2 : FONT_ATLAS_SPACE_WIDTH;
+        CHECK_EQ(font_x, 10 + advance);
+        if (inked) {
+            CHECK(memcmp(&fake_oled[2 * OLED_DISPLAY_WIDTH + 10], &glyph[first], last - first + 1) == 0);
+        }
+        width += advance;
+    }
+    font_atlas_set_cursor(0, 0);
+    font_atlas_write(text, false);
+    CHECK_EQ(font_x, width);
+    CHECK(width < FONT_ATLAS_WIDTH * (sizeof(text) - 1));
+}
+
+// Text wraps at the end of a line, a newline clears the rest of it
+static void test_wrap(void) {
+    font_atlas_set_proportional(false);
+    memset(fake_oled, 0xFF, sizeof(fake_oled));
+    font_atlas_set_cursor(0, 0);
+    for (uint8_t i = 0; i < OLED_DISPLAY_WIDTH / FONT_ATLAS_WIDTH + 1; i++) {
+        font_atlas_write_char('x', false);
+    }
+    CHECK_EQ(font_line, 1);
+    CHECK_EQ(font_x, FONT_ATLAS_WIDTH);
+    // The unused end of the first line was cleared on the way
+    CHECK_EQ(fake_oled[OLED_DISPLAY_WIDTH - 1], 0);
+
+    font_atlas_write_char('\n', false);
+    CHECK_EQ(font_line, 2);
+    CHECK_EQ(font_x, 0);
+    CHECK_EQ(fake_oled[2 * OLED_DISPLAY_WIDTH - 1], 0);
+    CHECK_EQ(fake_oled[2 * OLED_DISPLAY_WIDTH], 0xFF);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// What the driver does for a character: six bytes from the stock table
+static void stock_write_char(uint8_t c, uint16_t index) {
+    for (uint8_t i = 0; i < FONT_ATLAS_WIDTH; i++) {
+        oled_write_raw_byte(pgm_read_byte(&font[c * FONT_ATLAS_WIDTH + i]), index + i);
+    }
+}
+
+static void bench(size_t atlas_size) {
+    static const char text[] = "Layer: Adjust 3x5, k4:a the quick brown fox";
+    enum { ROUNDS = 20000 };
+    uint64_t start, fixed, proportional, stock;
+    size_t   chars = ROUNDS * (sizeof(text) - 1);
+
+    font_atlas_set_proportional(false);
+    start = now_ns();
+    for (uint16_t i = 0; i < ROUNDS; i++) {
+        font_atlas_set_cursor(0, 0);
+        font_atlas_write(text, false);
+    }
+    fixed = now_ns() - start;
+
+    font_atlas_set_proportional(true);
+    start = now_ns();
+    for (uint16_t i = 0; i < ROUNDS; i++) {
+        font_atlas_set_cursor(0, 0);
+        font_atlas_write(text, false);
+    }
+    proportional = now_ns() - start;
+
+    start = now_ns();
+    for (uint16_t i = 0; i < ROUNDS; i++) {
+        uint16_t index = 0;
+        for (const char *c = text; *c; c++) {
+            stock_write_char(*c, index % sizeof(fake_oled));
+            index += FONT_ATLAS_WIDTH;
+        }
+    }
+    stock = now_ns() - start;
+
+    printf("font atlas, %s\n", GLYPHS);
+    printf("  flash: atlas %u bytes and blank driver font %u bytes, stock font %u bytes\n", (unsigned)atlas_size, (unsigned)sizeof(blank_font), (unsigned)sizeof(font));
+    printf("  draw:  atlas %.1f ns/char fixed, %.1f ns/char proportional; stock copy %.1f ns/char\n", (double)fixed / chars, (double)proportional / chars, (double)stock / chars);
+    test_bench("font_atlas/fixed", (double)fixed / chars);
+    test_bench("font_atlas/proportional", (double)proportional / chars);
+    CHECK(atlas_size + sizeof(blank_font) < sizeof(font));
+}
+
+int main(void) {
+    size_t size = atlas_load();
+    test_fixed();
+    test_proportional();
+    test_wrap();
+    bench(size);
+    return test_report("font_atlas");
+}
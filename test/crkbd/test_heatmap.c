@@ -0,0 +1,291 @@
+// Heatmap counting, saving and rendering, on both halves of a split.
+//
+// Each half sees its own rows of the debounced matrix, as the master and
+// the slave do after a scan. The test keeps the half it is not running as
+// on the side and swaps it in to answer RPC transactions, each with its
+// own EEPROM.
+
+#define SPLIT_KEYBOARD
+#define VIA_ENABLE
+#define RGB_MATRIX_ENABLE
+#define EECONFIG_KB_HEATMAP_OFFSET 0
+#define EECONFIG_KB_HEATMAP_SIZE 128
+#include "heatmap.c"
+#include "fake.h"
+#include "test.h"
+
+typedef struct {
+    uint16_t     counts[MATRIX_ROWS][MATRIX_COLS];
+    matrix_row_t last[MATRIX_ROWS];
+    bool         dirty;
+    uint32_t     saved_at;
+    int8_t       save_row;
+    bool         reset_pending;
+    bool         save_pending;
+    matrix_row_t matrix[MATRIX_ROWS];
+    uint8_t      eeprom[EECONFIG_KB_HEATMAP_SIZE];
+} half_t;
+
+static half_t           other;
+static bool             running_master;
+static bool             linked;
+static slave_callback_t heatmap_handler;
+static matrix_row_t     matrix[MATRIX_ROWS];
+static RGB              leds[RGB_MATRIX_LED_COUNT];
+
+led_config_t g_led_config;
+
+matrix_row_t matrix_get_row(uint8_t row) {
+    return matrix[row];
+}
+
+void rgb_matrix_set_color(int index, uint8_t red, uint8_t green, uint8_t blue) {
+    leds[index] = (RGB){red, green, blue};
+}
+
+// The master is the left half
+bool is_keyboard_master(void) {
+    return running_master;
+}
+bool is_keyboard_left(void) {
+    return running_master;
+}
+
+void transaction_register_rpc(int8_t transaction_id, slave_callback_t callback) {
+    if (transaction_id == RPC_ID_KB_HEATMAP) {
+        heatmap_handler = callback;
+    }
+}
+
+static void swap_bytes(void *a, void *b, size_t size) {
+    uint8_t swap[sizeof(half_t)];
+
+    memcpy(swap, a, size);
+    memcpy(a, b, size);
+    memcpy(b, swap, size);
+}
+
+static void swap_halves(void) {
+    bool reset_pending = heat_reset_pending;
+    bool save_pending  = heat_save_pending;
+
+    swap_bytes(heat_counts, other.counts, sizeof(other.counts));
+    swap_bytes(heat_matrix, other.last, sizeof(other.last));
+    swap_bytes(&heat_dirty, &other.dirty, sizeof(other.dirty));
+    swap_bytes(&heat_saved_at, &other.saved_at, sizeof(other.saved_at));
+    swap_bytes(&heat_save_row, &other.save_row, sizeof(other.save_row));
+    swap_bytes(matrix, other.matrix, sizeof(other.matrix));
+    swap_bytes(fake_eeprom, other.eeprom, sizeof(other.eeprom));
+    heat_reset_pending  = other.reset_pending;
+    heat_save_pending   = other.save_pending;
+    other.reset_pending = reset_pending;
+    other.save_pending  = save_pending;
+    running_master      = !running_master;
+}
+
+bool transaction_rpc_exec(int8_t transaction_id, uint8_t initiator2target_buffer_size, const void *initiator2target_buffer, uint8_t target2initiator_buffer_size, void *target2initiator_buffer) {
+    if (!linked || transaction_id != RPC_ID_KB_HEATMAP || !heatmap_handler) {
+        return false;
+    }
+    swap_halves();
+    heatmap_handler(initiator2target_buffer_size, initiator2target_buffer, target2initiator_buffer_size, target2initiator_buffer);
+    swap_halves();
+    return true;
+}
+
+static void boot(void) {
+    memset(&other, 0, sizeof(other));
+    memset(fake_eeprom, 0, sizeof(fake_eeprom));
+    memset(matrix, 0, sizeof(matrix));
+    memset(heat_counts, 0, sizeof(heat_counts));
+    memset(heat_matrix, 0, sizeof(heat_matrix));
+    memset(heat_level, 0, sizeof(heat_level));
+    heat_active_count = 0;
+    heat_save_row     = -1;
+    heat_dirty        = false;
+    other.save_row    = -1;
+    running_master    = false;
+    heatmap_init();
+    swap_halves();
+    heatmap_init();
+    linked = true;
+}
+
+// One press and release, seen by the half that scans the row
+static void tap(uint8_t row, uint8_t col) {
+    matrix[row] |= (matrix_row_t)1 << col;
+    heatmap_scan();
+    test_now += 30;
+    matrix[row] &= ~((matrix_row_t)1 << col);
+    heatmap_scan();
+    test_now += 30;
+}
+
+static bool via(uint8_t command, uint8_t value_id, uint8_t row, uint8_t *data) {
+    memset(data, 0, 32);
+    data[0] = command;
+    data[1] = id_custom_channel;
+    data[2] = value_id;
+    data[3] = row;
+    return heatmap_via_command(data, 32);
+}
+
+static uint16_t via_count(uint8_t row, uint8_t col) {
+    uint8_t data[32];
+
+    CHECK(via(id_custom_get_value, id_heatmap_row, row, data));
+    return data[4 + 2 * col] | data[5 + 2 * col] << 8;
+}
+
+// Each half counts its own rows, the master reads both
+static void test_count(void) {
+    boot();
+    tap(0, 0);
+    tap(0, 0);
+    tap(3, 6);
+    // The slave's rows mirrored on the master are left to the slave
+    tap(ROWS_PER_HAND, 1);
+    swap_halves();
+    tap(ROWS_PER_HAND, 1);
+    tap(ROWS_PER_HAND + 2, 5);
+    swap_halves();
+
+    CHECK_EQ(via_count(0, 0), 2);
+    CHECK_EQ(via_count(3, 6), 1);
+    CHECK_EQ(via_count(ROWS_PER_HAND, 1), 1);
+    CHECK_EQ(via_count(ROWS_PER_HAND + 2, 5), 1);
+    CHECK_EQ(via_count(1, 1), 0);
+
+    // A held key counts once
+    matrix[1] = 1;
+    for (uint8_t i = 0; i < 10; i++) {
+        heatmap_scan();
+    }
+    CHECK_EQ(via_count(1, 0), 1);
+
+    // Counts saturate
+    heat_counts[2][2] = UINT16_MAX - 1;
+    tap(2, 2);
+    tap(2, 2);
+    CHECK_EQ(via_count(2, 2), UINT16_MAX);
+
+    // Without the slave its rows fail instead of reading zero
+    uint8_t data[32];
+    linked = false;
+    CHECK(!via(id_custom_get_value, id_heatmap_row, ROWS_PER_HAND, data));
+}
+
+static void run_task(uint32_t ms) {
+    for (uint32_t i = 0; i < ms; i += 10) {
+        test_now += 10;
+        heatmap_task();
+    }
+}
+
+// Changed counts are saved a row at a time, on both halves
+static void test_save(void) {
+    uint8_t data[32];
+
+    boot();
+    tap(1, 3);
+    run_task(HEATMAP_SAVE_INTERVAL / 2);
+    CHECK_EQ(fake_eeprom_writes, 0);
+    fake_eeprom_largest_write = 0;
+    run_task(HEATMAP_SAVE_INTERVAL);
+    CHECK(fake_eeprom_writes > 0);
+    CHECK(fake_eeprom_largest_write <= HEATMAP_ROW_SIZE);
+    CHECK_EQ(heat_save_row, -1);
+
+    // Nothing changed, nothing written
+    int writes = fake_eeprom_writes;
+    run_task(2 * HEATMAP_SAVE_INTERVAL);
+    CHECK_EQ(fake_eeprom_writes, writes);
+
+    // A VIA save reaches the slave, which writes from housekeeping
+    swap_halves();
+    tap(ROWS_PER_HAND + 1, 4);
+    swap_halves();
+    CHECK(via(id_custom_save, 0, 0, data));
+    CHECK(other.save_pending);
+    swap_halves();
+    run_task(MATRIX_ROWS * 10);
+    swap_halves();
+
+    // Both halves restart with their counts
+    memset(heat_counts, 0, sizeof(heat_counts));
+    memset(other.counts, 0, sizeof(other.counts));
+    heatmap_init();
+    swap_halves();
+    heatmap_init();
+    swap_halves();
+    CHECK_EQ(via_count(1, 3), 1);
+    CHECK_EQ(via_count(ROWS_PER_HAND + 1, 4), 1);
+
+    // Reset clears both halves
+    CHECK(via(id_custom_set_value, id_heatmap_reset, 0, data));
+    swap_halves();
+    run_task(10);
+    swap_halves();
+    CHECK_EQ(via_count(1, 3), 0);
+    CHECK_EQ(via_count(ROWS_PER_HAND + 1, 4), 0);
+}
+
+static bool is_off(uint8_t led) {
+    return leds[led].r == 0 && leds[led].g == 0 && leds[led].b == 0;
+}
+
+// Only warm LEDs are tracked, every LED is written
+static void test_render(void) {
+    boot();
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            g_led_config.matrix_co[row][col] = (row * MATRIX_COLS + col) % RGB_MATRIX_LED_COUNT;
+        }
+    }
+    g_led_config.matrix_co[0][1] = NO_LED;
+    fake_rgb.sat = 255;
+    fake_rgb.val = 200;
+
+    tap(0, 0);
+    tap(0, 1);
+    tap(1, 2);
+    tap(1, 2);
+    CHECK_EQ(heat_active_count, 2);
+    CHECK(heat_level[MATRIX_COLS + 2] > heat_level[0]);
+
+    // Drawn over by an indicator, then put back by the next frame
+    memset(leds, 0xFF, sizeof(leds));
+    heatmap_render(true, 0, RGB_MATRIX_LED_COUNT);
+    CHECK(!is_off(0));
+    CHECK(!is_off(MATRIX_COLS + 2));
+    for (uint8_t led = 0; led < RGB_MATRIX_LED_COUNT; led++) {
+        if (led != 0 && led != MATRIX_COLS + 2) {
+            CHECK(is_off(led));
+        }
+    }
+
+    // Decay by elapsed time, cold LEDs leave the list and go dark
+    test_now += (uint32_t)HEATMAP_HEAT_STEP * heatmap_decay_ms;
+    heatmap_render(true, 0, RGB_MATRIX_LED_COUNT);
+    CHECK_EQ(heat_active_count, 1);
+    CHECK(is_off(0));
+    CHECK(!is_off(MATRIX_COLS + 2));
+    test_now += (uint32_t)HEATMAP_HEAT_STEP * heatmap_decay_ms;
+    heatmap_render(true, 0, RGB_MATRIX_LED_COUNT);
+    CHECK_EQ(heat_active_count, 0);
+    CHECK(is_off(MATRIX_COLS + 2));
+
+    // The slave warms its own LEDs from its own scans
+    swap_halves();
+    tap(ROWS_PER_HAND, 0);
+    swap_halves();
+    CHECK_EQ(heat_active_count, 1);
+    CHECK(heat_level[ROWS_PER_HAND * MATRIX_COLS] > 0);
+}
+
+int main(void) {
+    test_count();
+    test_save();
+    test_render();
+    return test_report("heatmap");
+}
@@ -0,0 +1,152 @@
+// Keymap cache against the plain keymap walk, over random layer changes.
+//
+// Layer changes go through the same calls as the layer state hooks in
+// crkbd.c, with lower and upper raising adjust as tri-layer does. After
+// each change every position is looked up the way the action code does,
+// from the top active layer down to the first non transparent entry, and
+// every layer is also asked directly, active or not. Keymap edits
+// invalidate the cache as the VIA hook does.
+
+#include "keymap_cache.c"
+#include <stdlib.h>
+#include "fake.h"
+#include "test.h"
+
+#define LAYERS 8
+#define LOWER 1
+#define UPPER 2
+#define ADJUST 3
+
+static uint16_t keymap[LAYERS][MATRIX_ROWS][MATRIX_COLS];
+static uint32_t storage_reads;
+
+uint16_t keycode_at_keymap_location(uint8_t layer, uint8_t row, uint8_t col) {
+    storage_reads++;
+    return keymap[layer][row][col];
+}
+
+static uint32_t seed = 1;
+
+static uint32_t random_below(uint32_t limit) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % limit;
+}
+
+static void random_keymap(void) {
+    for (uint8_t layer = 0; layer < LAYERS; layer++) {
+        for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+            for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+                bool transparent   = layer > 0 && random_below(3) != 0;
+                keymap[layer][row][col] = transparent ? KC_TRNS : KC_A + random_below(0x60);
+            }
+        }
+    }
+}
+
+// What the layer state hooks do, tri-layer included
+static void set_layers(layer_state_t state) {
+    state &= ~((layer_state_t)1 << ADJUST);
+    if ((state & (1 << LOWER)) && (state & (1 << UPPER))) {
+        state |= 1 << ADJUST;
+    }
+    keymap_cache_update(state | default_layer_state);
+    layer_state = state;
+}
+
+static void set_default_layer(uint8_t layer) {
+    keymap_cache_update(layer_state | (layer_state_t)1 << layer);
+    default_layer_state = (layer_state_t)1 << layer;
+}
+
+static uint16_t reference(uint8_t row, uint8_t col) {
+    layer_state_t state = layer_state | default_layer_state;
+
+    for (int8_t layer = LAYERS - 1; layer >= 0; layer--) {
+        if ((state & ((layer_state_t)1 << layer)) && keymap[layer][row][col] != KC_TRNS) {
+            return keymap[layer][row][col];
+        }
+    }
+    return keymap[0][row][col];
+}
+
+// As the action code resolves a press
+static uint16_t resolved(uint8_t row, uint8_t col) {
+    layer_state_t state = layer_state | default_layer_state;
+    keypos_t      key   = {.col = col, .row = row};
+
+    for (int8_t layer = LAYERS - 1; layer >= 0; layer--) {
+        if (state & ((layer_state_t)1 << layer)) {
+            uint16_t keycode = keymap_key_to_keycode(layer, key);
+            if (keycode != KC_TRNS) {
+                return keycode;
+            }
+        }
+    }
+    return keymap_key_to_keycode(0, key);
+}
+
+static void check_all(void) {
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            keypos_t key = {.col = col, .row = row};
+            CHECK_EQ(resolved(row, col), reference(row, col));
+            // Any layer asked directly, like the source layer of a release
+            uint8_t layer = random_below(LAYERS);
+            if (!((layer_state | default_layer_state) & ((layer_state_t)1 << layer))) {
+                CHECK_EQ(keymap_key_to_keycode(layer, key), keymap[layer][row][col]);
+            }
+        }
+    }
+}
+
+static void test_random(void) {
+    random_keymap();
+    default_layer_state = 1;
+    layer_state         = 0;
+    keymap_cache_invalidate();
+    keymap_cache_update(default_layer_state);
+
+    for (uint16_t step = 0; step < 5000; step++) {
+        switch (random_below(10)) {
+            case 0:
+                set_default_layer(random_below(2));
+                break;
+            case 1: {
+                // A keymap edit, visible before the next layer change
+                uint8_t layer = random_below(LAYERS), row = random_below(MATRIX_ROWS), col = random_below(MATRIX_COLS);
+                keymap[layer][row][col] = random_below(2) ? KC_TRNS : KC_A + random_below(0x60);
+                keymap_cache_invalidate();
+                break;
+            }
+            case 2:
+            case 3:
+                set_layers(layer_state ^ (1 << (LOWER + random_below(2))));
+                break;
+            default:
+                set_layers(layer_state ^ ((layer_state_t)1 << (4 + random_below(LAYERS - 4))));
+                break;
+        }
+        check_all();
+    }
+}
+
+// With the layers settled, presses resolve without reading storage
+static void test_no_storage_reads(void) {
+    random_keymap();
+    keymap_cache_invalidate();
+    set_layers(1 << LOWER | 1 << UPPER);
+    storage_reads = 0;
+    for (uint8_t row = 0; row < MATRIX_ROWS; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            CHECK_EQ(resolved(row, col), reference(row, col));
+        }
+    }
+    CHECK_EQ(storage_reads, 0);
+    CHECK(layer_state & (1 << ADJUST));
+}
+
+int main(void) {
+    test_random();
+    test_no_storage_reads();
+    return test_report("keymap_cache");
+}
@@ -0,0 +1,163 @@
+// Logo animation played from the frames the via keymap ships, against the
+// frames themselves, and the decoding a late loop costs.
+//
+// The stream comes from logo_anim.py over keymaps/via/logo and is read
+// back into the arrays of the stand-in logo_anim_data.h. Frames go into
+// the fake OLED buffer.
+
+#include "logo_anim.c"
+#include <glob.h>
+#include <stdlib.h>
+#include "fake.h"
+#include "test.h"
+
+#define FRAMES_GLOB CRKBD_PATH "/keymaps/via/logo/*.pbm"
+#define FRAME_SIZE (LOGO_ANIM_WIDTH * LOGO_ANIM_HEIGHT / 8)
+
+static uint8_t  frames[32][FRAME_SIZE];
+static uint8_t  frame_count;
+static uint32_t raw_writes;
+
+void oled_write_raw_byte(const char data, uint16_t index) {
+    raw_writes++;
+    if (index < sizeof(fake_oled)) {
+        fake_oled[index] = data;
+    }
+}
+
+// Reads the number list that follows name in a generated header
+static size_t anim_read_array(const char *text, const char *name, void *out, size_t size, size_t max) {
+    const char *p     = strchr(strstr(text, name), '{') + 1;
+    size_t      count = 0;
+    char       *end;
+
+    while (count < max) {
+        unsigned long value = strtoul(p, &end, 0);
+        if (end == p) {
+            break;
+        }
+        if (size == 1) {
+            ((uint8_t *)out)[count++] = value;
+        } else {
+            ((uint16_t *)out)[count++] = value;
+        }
+        p = end + strspn(end, ", \n");
+    }
+    return count;
+}
+
+// A P4 frame in the OLED layout, a byte per 8 pixel column of a page
+static void read_frame(const char *path, uint8_t *out) {
+    uint8_t raw[LOGO_ANIM_WIDTH * LOGO_ANIM_HEIGHT / 8];
+    char    line[128];
+    int     fields = 0;
+    FILE   *file   = fopen(path, "rb");
+
+    CHECK(file != NULL);
+    if (file == NULL) {
+        exit(1);
+    }
+    // Magic, then the size, comments in between
+    while (fields < 2 && fgets(line, sizeof(line), file)) {
+        fields += line[0] != '#';
+    }
+    CHECK_EQ(fread(raw, 1, sizeof(raw), file), sizeof(raw));
+    fclose(file);
+
+    memset(out, 0, FRAME_SIZE);
+    for (uint8_t y = 0; y < LOGO_ANIM_HEIGHT; y++) {
+        for (uint8_t x = 0; x < LOGO_ANIM_WIDTH; x++) {
+            if (raw[y * LOGO_ANIM_WIDTH / 8 + x / 8] & (0x80 >> x % 8)) {
+                out[y / 8 * LOGO_ANIM_WIDTH + x] |= 1 << y % 8;
+            }
+        }
+    }
+}
+
+static size_t anim_load(void) {
+    char   command[512];
+    char  *text = calloc(1, 1 << 16);
+    FILE  *file;
+    glob_t paths;
+    size_t size;
+
+    CHECK_EQ(glob(FRAMES_GLOB, 0, NULL, &paths), 0);
+    for (size_t i = 0; i < paths.gl_pathc && i < 32; i++) {
+        read_frame(paths.gl_pathv[i], frames[i]);
+    }
+    frame_count = paths.gl_pathc;
+    globfree(&paths);
+    CHECK(frame_count > 1);
+
+    snprintf(command, sizeof(command), "python3 %s/logo_anim.py %d %d build/logo_anim_data.h " FRAMES_GLOB, CRKBD_PATH, LOGO_ANIM_WIDTH, LOGO_ANIM_HEIGHT);
+    CHECK_EQ(system(command), 0);
+    file = fopen("build/logo_anim_data.h", "r");
+    CHECK(file != NULL);
+    if (file == NULL) {
+        exit(1);
+    }
+    fread(text, 1, (1 << 16) - 1, file);
+    fclose(file);
+    logo_anim_frames = strtoul(strstr(text, "LOGO_ANIM_FRAMES ") + strlen("LOGO_ANIM_FRAMES "), NULL, 0);
+    size             = 2 * anim_read_array(text, "logo_anim_offsets[]", logo_anim_offsets, 2, ARRAY_SIZE(logo_anim_offsets));
+    size += anim_read_array(text, "logo_anim_data[]", logo_anim_data, 1, LOGO_ANIM_DATA_MAX);
+    free(text);
+    CHECK_EQ(logo_anim_frames, frame_count);
+    return size;
+}
+
+// Every frame on time, over two loops
+static void test_play(void) {
+    anim_started = false;
+    memset(fake_oled, 0, sizeof(fake_oled));
+    oled_render_logo();
+    CHECK(memcmp(fake_oled, frames[0], FRAME_SIZE) == 0);
+
+    for (uint8_t n = 1; n <= 2 * frame_count; n++) {
+        test_now += LOGO_ANIM_FRAME_MS - 1;
+        oled_render_logo();
+        CHECK(memcmp(fake_oled, frames[(n - 1) % frame_count], FRAME_SIZE) == 0);
+        test_now += 1;
+        oled_render_logo();
+        CHECK(memcmp(fake_oled, frames[n % frame_count], FRAME_SIZE) == 0);
+    }
+}
+
+// A late loop decodes a single delta, however long it stalled
+static void test_late(size_t size) {
+    uint32_t most = 0;
+
+    anim_started = false;
+    oled_render_logo();
+    for (uint8_t n = 1; n <= frame_count; n++) {
+        raw_writes = 0;
+        test_now += LOGO_ANIM_FRAME_MS;
+        oled_render_logo();
+        most = MAX(most, raw_writes);
+    }
+
+    raw_writes = 0;
+    test_now += 25 * LOGO_ANIM_FRAME_MS;
+    oled_render_logo();
+    CHECK(raw_writes <= most);
+    CHECK(memcmp(fake_oled, frames[1], FRAME_SIZE) == 0);
+
+    // The timer restarts from the late frame
+    test_now += LOGO_ANIM_FRAME_MS - 1;
+    oled_render_logo();
+    CHECK(memcmp(fake_oled, frames[1], FRAME_SIZE) == 0);
+    test_now += 1;
+    oled_render_logo();
+    CHECK(memcmp(fake_oled, frames[2], FRAME_SIZE) == 0);
+
+    printf("logo animation, %u frames of keymaps/via/logo\n", frame_count);
+    printf("  flash:  %u bytes, raw frames %u bytes\n", (unsigned)size, (unsigned)(frame_count * FRAME_SIZE));
+    printf("  decode: at most %u bytes written per frame, of %u\n", (unsigned)most, (unsigned)FRAME_SIZE);
+}
+
+int main(void) {
+    size_t size = anim_load();
+    test_play();
+    test_late(size);
+    return test_report("logo_anim");
+}
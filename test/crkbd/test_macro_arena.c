@@ -0,0 +1,235 @@
+// Macro arena encoding, replay, saving, and how many events fit compared
+// with the stock dynamic macros, which keep a keyrecord_t per event.
+
+#define EECONFIG_KB_MACRO_ARENA_OFFSET 0
+#define EECONFIG_KB_MACRO_ARENA_SIZE 512
+#include "macro_arena.c"
+#include <stdlib.h>
+#include "fake.h"
+#include "test.h"
+
+typedef struct {
+    uint16_t keycode;
+    bool     pressed;
+    uint16_t delay;
+} step_t;
+
+static uint32_t seed = 1;
+
+static uint32_t random_below(uint32_t limit) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % limit;
+}
+
+static void reset(void) {
+    memset(arena, 0, sizeof(arena));
+    memset(slot_start, 0, sizeof(slot_start));
+    memset(slot_length, 0, sizeof(slot_length));
+    arena_used   = 0;
+    recording    = -1;
+    replaying    = false;
+    save_pending = false;
+    memset(fake_eeprom, 0, sizeof(fake_eeprom));
+    fake_eeprom_writes        = 0;
+    fake_eeprom_largest_write = 0;
+    fake_key_count            = 0;
+    fake_clears               = 0;
+    replay_realtime           = true;
+}
+
+static bool event(uint16_t keycode, bool pressed) {
+    keyrecord_t record = {.event = {.type = KEY_EVENT, .pressed = pressed, .time = test_now}};
+    return process_macro_arena(keycode, &record);
+}
+
+static void tap(uint16_t keycode) {
+    event(keycode, true);
+    event(keycode, false);
+}
+
+static void record(uint8_t slot, const step_t *steps, uint16_t count) {
+    tap(QK_DYNAMIC_MACRO_RECORD_START_1 + slot);
+    for (uint16_t i = 0; i < count; i++) {
+        test_now += steps[i].delay;
+        event(steps[i].keycode, steps[i].pressed);
+    }
+    tap(QK_DYNAMIC_MACRO_RECORD_STOP);
+}
+
+// Replays slot and checks it against steps, delays included
+static void replay(uint8_t slot, const step_t *steps, uint16_t count) {
+    uint16_t logged = 0;
+    uint32_t last   = 0;
+
+    fake_key_count = 0;
+    tap(QK_DYNAMIC_MACRO_PLAY_1 + slot);
+    while (replaying) {
+        macro_arena_task();
+        while (logged < fake_key_count) {
+            const fake_key_t *key = &fake_keys[logged];
+            if (logged < count) {
+                CHECK_EQ(key->code, steps[logged].keycode);
+                CHECK_EQ(key->action, steps[logged].pressed ? FAKE_PRESS : FAKE_RELEASE);
+                if (logged > 0) {
+                    CHECK_EQ(key->time - last, steps[logged].delay);
+                }
+            }
+            last = key->time;
+            logged++;
+        }
+        test_now++;
+    }
+}
+
+static uint16_t random_steps(step_t *steps, uint16_t count) {
+    uint16_t n = 0;
+
+    while (n + 2 <= count) {
+        uint16_t keycode = random_below(4) ? KC_A + random_below(26) : LSFT(KC_A + random_below(26));
+        uint16_t delay   = random_below(8) ? random_below(200) : random_below(20000);
+        steps[n++]       = (step_t){keycode, true, delay};
+        steps[n++]       = (step_t){keycode, false, random_below(120)};
+    }
+    return n;
+}
+
+static void test_round_trip(void) {
+    step_t   steps[100];
+    uint16_t count = random_steps(steps, 100);
+
+    reset();
+    steps[0].delay = 0;
+    record(0, steps, count);
+    CHECK(slot_length[0] > 0);
+    replay(0, steps, count);
+    CHECK_EQ(fake_key_count, count);
+    CHECK_EQ(fake_clears, 1);
+}
+
+// Keys held when recording stops are released at the end of the slot
+static void test_held_at_stop(void) {
+    step_t steps[] = {{KC_LSFT, true, 0}, {KC_A, true, 50}};
+
+    reset();
+    record(1, steps, 2);
+    replay(1, steps, 2);
+    CHECK_EQ(fake_key_count, 4);
+    CHECK_EQ(fake_keys[2].action, FAKE_RELEASE);
+    CHECK_EQ(fake_keys[3].action, FAKE_RELEASE);
+    CHECK((fake_keys[2].code == KC_A && fake_keys[3].code == KC_LSFT) || (fake_keys[2].code == KC_LSFT && fake_keys[3].code == KC_A));
+    CHECK_EQ(fake_clears, 1);
+
+    // A release without its press is not recorded
+    step_t stray[] = {{KC_B, false, 0}, {KC_C, true, 10}, {KC_C, false, 10}};
+    record(0, stray, 3);
+    replay(0, &stray[1], 2);
+    CHECK_EQ(fake_key_count, 2);
+}
+
+// When the arena fills, held keys still get their releases
+static void test_full(void) {
+    reset();
+    tap(QK_DYNAMIC_MACRO_RECORD_START_1);
+    event(KC_LSFT, true);
+    event(KC_LCTL, true);
+    for (uint16_t i = 0; recording >= 0 && i < 2 * MACRO_ARENA_SIZE; i++) {
+        test_now += 30;
+        event(KC_A + i % 26, i % 2 == 0);
+    }
+    CHECK(recording < 0);
+    CHECK(arena_used <= MACRO_ARENA_SIZE);
+
+    uint8_t down = 0;
+    fake_key_count = 0;
+    tap(QK_DYNAMIC_MACRO_PLAY_1);
+    replay_realtime = false;
+    while (replaying) {
+        macro_arena_task();
+    }
+    for (uint16_t i = 0; i < fake_key_count; i++) {
+        down += fake_keys[i].action == FAKE_PRESS ? 1 : -1;
+    }
+    CHECK_EQ(down, 0);
+}
+
+// The save waits for housekeeping and goes out in chunks
+static void test_save(void) {
+    step_t   steps[200];
+    uint16_t count = random_steps(steps, 200);
+    uint16_t length[MACRO_ARENA_SLOTS];
+    uint8_t  saved[MACRO_ARENA_SIZE];
+
+    reset();
+    record(0, steps, count / 2);
+    record(1, &steps[count / 2], count / 2);
+    CHECK_EQ(fake_eeprom_writes, 0);
+    memcpy(length, slot_length, sizeof(length));
+    memcpy(saved, arena, arena_used);
+
+    // Cut short, the saved header stays invalid
+    for (uint8_t i = 0; i < 3; i++) {
+        macro_arena_task();
+    }
+    CHECK(save_pending);
+    CHECK_EQ(fake_eeprom[0], 0);
+
+    while (save_pending) {
+        macro_arena_task();
+    }
+    CHECK(fake_eeprom_largest_write <= MACRO_ARENA_SAVE_CHUNK);
+    CHECK(fake_eeprom_writes >= (int)(MACRO_ARENA_HEADER_SIZE + arena_used) / MACRO_ARENA_SAVE_CHUNK);
+
+    memset(arena, 0, sizeof(arena));
+    memset(slot_length, 0, sizeof(slot_length));
+    arena_used = 0;
+    macro_arena_init();
+    CHECK_EQ(slot_length[0], length[0]);
+    CHECK_EQ(slot_length[1], length[1]);
+    CHECK(memcmp(arena, saved, arena_used) == 0);
+    replay(1, &steps[count / 2], count / 2);
+}
+
+// Typing at about 200 characters per minute, some shifted
+static void bench_size(void) {
+    step_t   steps[2 * MACRO_ARENA_SIZE];
+    uint16_t count = 0;
+
+    reset();
+    while (count + 4u <= ARRAY_SIZE(steps)) {
+        uint16_t keycode = KC_A + random_below(26);
+        bool     shift   = random_below(10) == 0;
+        if (shift) {
+            steps[count++] = (step_t){KC_LSFT, true, 150 + random_below(300)};
+        }
+        steps[count++] = (step_t){keycode, true, shift ? 40 : 150 + random_below(300)};
+        steps[count++] = (step_t){keycode, false, 60 + random_below(60)};
+        if (shift) {
+            steps[count++] = (step_t){KC_LSFT, false, 20};
+        }
+    }
+
+    tap(QK_DYNAMIC_MACRO_RECORD_START_1);
+    uint16_t recorded = 0;
+    for (; recorded < count && recording >= 0; recorded++) {
+        test_now += steps[recorded].delay;
+        event(steps[recorded].keycode, steps[recorded].pressed);
+    }
+    if (recording >= 0) {
+        tap(QK_DYNAMIC_MACRO_RECORD_STOP);
+    }
+
+    double per_event = (double)slot_length[0] / recorded;
+    printf("macro arena of %u bytes, filled with typing\n", MACRO_ARENA_SIZE);
+    printf("  arena: %u events, %.2f bytes each\n", recorded, per_event);
+    printf("  stock: %u events, %u bytes each\n", (unsigned)(MACRO_ARENA_SIZE / sizeof(keyrecord_t)), (unsigned)sizeof(keyrecord_t));
+    CHECK(per_event < 3);
+}
+
+int main(void) {
+    test_round_trip();
+    test_held_at_stop();
+    test_full();
+    test_save();
+    bench_size();
+    return test_report("macro_arena");
+}
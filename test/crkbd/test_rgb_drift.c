@@ -0,0 +1,120 @@
+// Drift of the slave's synced timer, read from the master, against a model
+// of two halves on crystals that differ by some ppm. The core resends the
+// master's timer every FORCED_SYNC_THROTTLE_MS, the slave's synced timer
+// then matches the master's and runs on its own clock until the next
+// resend. The drift RPC takes RPC_US and the slave answers half way.
+
+#include "rgb_drift.c"
+#include "fake.h"
+#include "test.h"
+
+#define THROTTLE_MS 1000
+#define RPC_US 1500
+
+extern uint32_t test_now;
+
+static uint64_t         now_us;
+static int32_t          ppm;
+static uint64_t         resent_us;
+static uint32_t         resent_ms;
+static bool             on_slave;
+static bool             master = true;
+static slave_callback_t drift_handler;
+static int              reads;
+
+static uint32_t slave_sync_ms(void) {
+    int64_t since = now_us - resent_us;
+
+    return resent_ms + (since + since * ppm / 1000000) / 1000;
+}
+
+uint32_t sync_timer_read32(void) {
+    return on_slave ? slave_sync_ms() : now_us / 1000;
+}
+
+uint32_t timer_read32(void) {
+    return now_us / 1000;
+}
+
+bool is_keyboard_master(void) {
+    return master;
+}
+
+bool is_transport_connected(void) {
+    return true;
+}
+
+void transaction_register_rpc(int8_t transaction_id, slave_callback_t callback) {
+    CHECK_EQ(transaction_id, RPC_ID_KB_RGB_DRIFT);
+    drift_handler = callback;
+}
+
+bool transaction_rpc_exec(int8_t transaction_id, uint8_t initiator2target_buffer_size, const void *initiator2target_buffer, uint8_t target2initiator_buffer_size, void *target2initiator_buffer) {
+    reads++;
+    now_us += RPC_US / 2;
+    on_slave = true;
+    drift_handler(initiator2target_buffer_size, initiator2target_buffer, target2initiator_buffer_size, target2initiator_buffer);
+    on_slave = false;
+    now_us += RPC_US - RPC_US / 2;
+    return true;
+}
+
+// Runs the halves for a while at a millisecond a loop
+static void run(int32_t skew, uint32_t ms) {
+    ppm         = skew;
+    drift_stats = (rgb_drift_stats_t){0};
+    for (uint32_t loop = 0; loop < ms; loop++) {
+        if (now_us - resent_us >= THROTTLE_MS * 1000) {
+            resent_us = now_us;
+            resent_ms = now_us / 1000;
+        }
+        rgb_drift_task();
+        now_us += 1000;
+        test_now = now_us / 1000;
+    }
+}
+
+// Crystals within their tolerance stay in the read window, the drift of a
+// half on a clock that is off shows up with its sign
+static void test_drift(void) {
+    static const int32_t skews[] = {0, 60, -60, 500, 5000, -5000};
+
+    rgb_drift_init();
+    for (uint8_t i = 0; i < sizeof(skews) / sizeof(skews[0]); i++) {
+        int32_t  worst = THROTTLE_MS * skews[i] / 1000000;
+        uint16_t bound = (worst < 0 ? -worst : worst) + 1;
+
+        run(skews[i], 10 * THROTTLE_MS);
+        printf("rgb drift at %5d ppm with the timer resent every %u ms: max %u ms, %u reads over %u ms, window %u ms\n", skews[i], THROTTLE_MS, drift_stats.max, drift_stats.over, RGB_DRIFT_MAX, drift_stats.window);
+        CHECK(drift_stats.max <= bound);
+        CHECK(drift_stats.window <= RPC_US / 1000 + 1);
+        if (bound <= RGB_DRIFT_MAX) {
+            CHECK_EQ(drift_stats.over, 0);
+        } else {
+            CHECK(drift_stats.over > 0);
+            // Short by the read window and the time since the last read
+            CHECK(drift_stats.max + RPC_US / 1000 + 1 + RGB_DRIFT_INTERVAL * (bound - 1) / THROTTLE_MS + 1 >= bound - 1);
+            CHECK(skews[i] < 0 ? drift_stats.last <= 0 : drift_stats.last >= 0);
+        }
+    }
+}
+
+// A read every RGB_DRIFT_INTERVAL, only from the master with the link up
+static void test_interval(void) {
+    reads = 0;
+    run(0, 10 * RGB_DRIFT_INTERVAL);
+    CHECK(reads >= 9);
+    CHECK(reads <= 11);
+
+    reads  = 0;
+    master = false;
+    run(0, 10 * RGB_DRIFT_INTERVAL);
+    master = true;
+    CHECK_EQ(reads, 0);
+}
+
+int main(void) {
+    test_drift();
+    test_interval();
+    return test_report("rgb_drift");
+}
@@ -0,0 +1,211 @@
+// Leader sequences through the trie sequence_trie.py generates, and the
+// cost of a key against a scan of every sequence as the table grows.
+//
+// The keymap's example sequences.txt is compiled with the real generator,
+// and the bench writes tables of random sequences the same way. Each
+// generated header is read back into the arrays of the stand-in
+// sequence_data.h.
+
+#include "sequence.c"
+#include <stdlib.h>
+#include <time.h>
+#include "fake.h"
+#include "test.h"
+
+#define EXAMPLE CRKBD_PATH "/keymaps/via/sequences.txt"
+
+// Reads the byte list that follows name in a generated header
+static size_t sequence_read_array(const char *text, const char *name, uint8_t *out) {
+    const char *p     = strstr(text, name);
+    size_t      count = 0;
+    char       *end;
+
+    p = strchr(p, '{') + 1;
+    while (count < SEQUENCE_DATA_MAX) {
+        unsigned long value = strtoul(p, &end, 16);
+        if (end == p) {
+            break;
+        }
+        out[count++] = value;
+        p            = end + strspn(end, ", \n");
+    }
+    return count;
+}
+
+static void sequence_load(const char *source) {
+    char  command[512];
+    char *text = calloc(1, 1 << 20);
+    FILE *file;
+
+    snprintf(command, sizeof(command), "python3 %s/sequence_trie.py %s build/sequence_data.h", CRKBD_PATH, source);
+    CHECK_EQ(system(command), 0);
+    file = fopen("build/sequence_data.h", "r");
+    CHECK(file != NULL);
+    if (file == NULL) {
+        exit(1);
+    }
+    fread(text, 1, (1 << 20) - 1, file);
+    fclose(file);
+    sequence_read_array(text, "sequence_trie[]", sequence_trie);
+    sequence_read_array(text, "sequence_outputs[]", (uint8_t *)sequence_outputs);
+    free(text);
+    sequence_active = false;
+}
+
+static bool key(uint16_t keycode, uint8_t taps) {
+    keyrecord_t record = {.event = {.type = KEY_EVENT, .pressed = true, .time = test_now}, .tap = {.count = taps}};
+    bool        pass   = process_sequence(keycode, &record);
+
+    record.event.pressed = false;
+    process_sequence(keycode, &record);
+    test_now += 20;
+    sequence_task();
+    return pass;
+}
+
+static void type(const char *keys) {
+    key(QK_LEADER, 0);
+    for (; *keys; keys++) {
+        key(*keys >= 'a' ? KC_A + *keys - 'a' : *keys == '0' ? KC_0 : KC_1 + *keys - '1', 0);
+    }
+}
+
+static void settle(void) {
+    test_now += SEQUENCE_TIMEOUT + 1;
+    sequence_task();
+}
+
+static void test_example(void) {
+    sequence_load(EXAMPLE);
+
+    fake_sends = 0;
+    type("gh");
+    CHECK_EQ(fake_sends, 1);
+    CHECK(strcmp(fake_sent, "https://github.com/") == 0);
+
+    // A prefix of a longer sequence waits for the timeout
+    type("td");
+    CHECK_EQ(fake_sends, 1);
+    settle();
+    CHECK_EQ(fake_sends, 2);
+    CHECK(strcmp(fake_sent, "TODO") == 0);
+    type("tdy");
+    CHECK(strcmp(fake_sent, "Today") == 0);
+
+    // Unknown keys end the sequence without sending
+    type("gx");
+    settle();
+    CHECK_EQ(fake_sends, 3);
+    CHECK(key(KC_G, 0));
+}
+
+// Home row mods and layer-taps advance by their tap keycode, and passing
+// through while held does not end the sequence
+static void test_tap_hold(void) {
+    sequence_load(EXAMPLE);
+
+    fake_sends = 0;
+    key(QK_LEADER, 0);
+    CHECK(!key(MT(MOD_LSFT, KC_B), 1));
+    CHECK(key(LT(1, KC_SPC), 0));
+    CHECK(!key(LT(2, KC_R), 1));
+    CHECK_EQ(fake_sends, 1);
+    CHECK(strcmp(fake_sent, "Best regards,") == 0);
+}
+
+static uint32_t seed = 1;
+
+static uint32_t random_below(uint32_t limit) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % limit;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#define BENCH_MAX 1000
+#define BENCH_ROUNDS 20000
+
+static const char bench_chars[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+static char       bench_keys[BENCH_MAX][8];
+
+// Sequences that share the prefix typed so far, as a flat table scan finds them
+static uint16_t linear_matches(const char *typed, uint8_t length, uint16_t count) {
+    uint16_t matches = 0;
+
+    for (uint16_t i = 0; i < count; i++) {
+        matches += strncmp(bench_keys[i], typed, length) == 0;
+    }
+    return matches;
+}
+
+static void bench(uint16_t count) {
+    FILE    *file = fopen("build/sequences_bench.txt", "w");
+    uint64_t keys = 0, trie = 0, linear = 0, start, sink = 0;
+    char     name[32];
+
+    for (uint16_t i = 0; i < count; i++) {
+        uint8_t length;
+        bool    taken;
+
+        do {
+            length = 2 + random_below(4);
+            for (uint8_t j = 0; j < length; j++) {
+                bench_keys[i][j] = bench_chars[random_below(sizeof(bench_chars) - 1)];
+            }
+            bench_keys[i][length] = 0;
+            taken                 = false;
+            for (uint16_t j = 0; j < i && !taken; j++) {
+                taken = strcmp(bench_keys[i], bench_keys[j]) == 0;
+            }
+        } while (taken);
+        fprintf(file, "%s -> x\n", bench_keys[i]);
+    }
+    fclose(file);
+    sequence_load("build/sequences_bench.txt");
+
+    fake_sends = 0;
+    for (uint32_t round = 0; round < BENCH_ROUNDS; round++) {
+        const char *typed = bench_keys[random_below(count)];
+        uint8_t     length = strlen(typed);
+        keyrecord_t record = {.event = {.type = KEY_EVENT, .pressed = true}};
+
+        process_sequence(QK_LEADER, &record);
+        start = now_ns();
+        for (uint8_t j = 0; j < length; j++) {
+            process_sequence(typed[j] >= 'a' ? KC_A + typed[j] - 'a' : typed[j] == '0' ? KC_0 : KC_1 + typed[j] - '1', &record);
+        }
+        trie += now_ns() - start;
+
+        start = now_ns();
+        for (uint8_t j = 1; j <= length; j++) {
+            sink += linear_matches(typed, j, count);
+        }
+        linear += now_ns() - start;
+        keys += length;
+        if (sequence_active) {
+            sequence_finish();
+        }
+    }
+    CHECK_EQ(fake_sends, BENCH_ROUNDS);
+    CHECK(sink >= keys);
+
+    printf("  %4u sequences: trie %5.1f ns/key; flat table scan %7.1f ns/key\n", count, (double)trie / keys, (double)linear / keys);
+    snprintf(name, sizeof(name), "sequence/key_%u", count);
+    test_bench(name, (double)trie / keys);
+}
+
+int main(void) {
+    test_example();
+    test_tap_hold();
+
+    printf("leader sequence cost per key\n");
+    bench(10);
+    bench(100);
+    bench(500);
+    bench(1000);
+    return test_report("sequence");
+}
@@ -0,0 +1,217 @@
+// Split link over a model of the core transport, for the connection
+// settings of rev4_1 against the ones it had before.
+//
+// The model follows transport_master_if_connected in split_util.c: a
+// failed transaction counts an error, SPLIT_MAX_CONNECTION_ERRORS of them
+// declare the link down, and a link that is down is only tried every
+// SPLIT_CONNECTION_CHECK_INTERVAL. A failed transaction blocks the master
+// for SERIAL_USART_TIMEOUT. Time runs in microseconds, a scan takes
+// SCAN_US and a good transaction TRANSACTION_US, about 12 bytes at
+// 115200 baud.
+
+#define SPLIT_SCHED_ENABLE
+#include "split_link.c"
+#include "fake.h"
+#include "test.h"
+
+#define SCAN_US 1000
+#define TRANSACTION_US 1100
+
+typedef struct {
+    const char *name;
+    uint8_t     max_errors;
+    uint16_t    timeout;
+    uint16_t    check_interval;
+} link_config_t;
+
+// rev4_1 before, its errors with the shorter timeout, then checks more
+// often while the link is down, and rev4_1 now
+static const link_config_t configs[] = {
+    {"10, 20 ms, 100 ms", 10, 20, 100},
+    {"10, 5 ms, 100 ms", 10, 5, 100},
+    {"3, 5 ms, 100 ms", 3, 5, 100},
+    {"3, 5 ms, 10 ms", 3, 5, 10},
+    {"3, 5 ms, 20 ms", 3, 5, 20},
+};
+
+static const link_config_t *config;
+static uint8_t              connection_errors;
+static uint16_t             connection_check_timer;
+static uint64_t             now_us;
+static uint64_t             gone_from, gone_until;
+static uint64_t             blocked_us;
+static int                  resyncs;
+
+void split_sched_resync(void) {
+    resyncs++;
+}
+
+bool is_transport_connected(void) {
+    return connection_errors < config->max_errors;
+}
+
+static void advance(uint64_t us) {
+    now_us += us;
+    test_now = now_us / 1000;
+}
+
+static void core_transport(void) {
+    bool disconnected = !is_transport_connected();
+
+    if (disconnected && timer_elapsed(connection_check_timer) < config->check_interval) {
+        return;
+    }
+    if (now_us < gone_from || now_us >= gone_until) {
+        advance(TRANSACTION_US);
+        connection_errors = 0;
+        return;
+    }
+    advance(config->timeout * 1000);
+    blocked_us += config->timeout * 1000;
+    if (connection_errors < UINT8_MAX) {
+        connection_errors++;
+    }
+    if (disconnected) {
+        connection_check_timer = timer_read();
+    }
+}
+
+static void master_loop(void) {
+    advance(SCAN_US);
+    core_transport();
+    split_link_task();
+}
+
+static void run_until(uint64_t until) {
+    while (now_us < until) {
+        master_loop();
+    }
+}
+
+static void boot(const link_config_t *with) {
+    config            = with;
+    connection_errors = 0;
+    link_up           = true;
+    gone_from         = UINT64_MAX;
+    gone_until        = UINT64_MAX;
+    memset(&link_stats, 0, sizeof(link_stats));
+    resyncs = 0;
+    run_until(now_us + 1000000);
+}
+
+typedef struct {
+    uint32_t stalled_ms; // from the loss until the link is declared down
+    uint32_t found_ms;   // from the return until the link is up again
+    uint32_t lost_pct;   // loop time spent on failed checks, over a long absence
+} absence_t;
+
+// The other half leaves for absence ms, then comes back
+static absence_t absent(uint32_t absence) {
+    absence_t result = {0};
+    uint64_t  down_at;
+
+    gone_from  = now_us + 1234;
+    gone_until = gone_from + (uint64_t)absence * 1000;
+    run_until(gone_from);
+    while (is_transport_connected() && now_us < gone_until) {
+        master_loop();
+    }
+    result.stalled_ms = (now_us - gone_from) / 1000;
+    down_at           = now_us;
+    blocked_us        = 0;
+    run_until(gone_until);
+    if (now_us - down_at >= 1000000) {
+        result.lost_pct = blocked_us * 100 / (now_us - down_at);
+    }
+    while (!is_transport_connected()) {
+        master_loop();
+    }
+    result.found_ms = (now_us - gone_until) / 1000;
+    run_until(now_us + 1000000);
+    return result;
+}
+
+// A glitch as long as this does not take the link down
+static uint32_t glitch_ridden(void) {
+    uint32_t longest = 0;
+
+    for (uint32_t glitch = 1; glitch <= 200; glitch++) {
+        uint16_t drops = link_stats.drops;
+        gone_from      = now_us + 777;
+        gone_until     = gone_from + glitch * 1000;
+        run_until(gone_until + 500000);
+        if (link_stats.drops != drops) {
+            break;
+        }
+        longest = glitch;
+    }
+    return longest;
+}
+
+static void test_absences(void) {
+    static const uint32_t absences[] = {5, 20, 100, 300, 5000};
+
+    printf("split link, rev4_1 transport: errors, timeout, check interval\n");
+    for (uint8_t c = 0; c < ARRAY_SIZE(configs); c++) {
+        uint32_t stalled = 0, found = 0, lost = 0;
+
+        boot(&configs[c]);
+        // Each absence a little longer each time, so returns fall all over
+        // the check interval
+        for (uint8_t a = 0; a < ARRAY_SIZE(absences); a++) {
+            for (uint8_t phase = 0; phase < 16; phase++) {
+                absence_t result = absent(absences[a] + phase * 7);
+                stalled          = MAX(stalled, result.stalled_ms);
+                found            = MAX(found, result.found_ms);
+                lost             = MAX(lost, result.lost_pct);
+            }
+        }
+        uint32_t ridden = glitch_ridden();
+        printf("  %-17s keys stall %3u ms at a loss, found %3u ms after a return, %2u%% of the loop lost while single, glitches up to %2u ms ridden out\n", configs[c].name, (unsigned)stalled, (unsigned)found, (unsigned)lost, (unsigned)ridden);
+
+        // Every absence past the stall is seen as a drop and a resync
+        CHECK(link_stats.drops >= 2 * 16);
+        CHECK_EQ(resyncs, link_stats.drops);
+        CHECK(stalled <= config->max_errors * (config->timeout + SCAN_US / 1000 + 1u));
+        CHECK(found <= config->check_interval + config->timeout + 2u * SCAN_US / 1000);
+        if (c == ARRAY_SIZE(configs) - 1) {
+            // What rev4_1 is set to: a loss stalls keys for tens of ms, not
+            // a fifth of a second, a returning half is found within 30 ms,
+            // a lone half keeps 80% of its loop and a glitch shorter than
+            // the stall goes unnoticed
+            CHECK(stalled < 25);
+            CHECK(found < 30);
+            CHECK(lost <= 20);
+            CHECK(ridden >= 2 * config->timeout);
+        }
+    }
+}
+
+// Recovery times are the declared outage, and a return sends and reads all
+// synced state again
+static void test_stats(void) {
+    split_shared_memory_t sent;
+
+    boot(&configs[ARRAY_SIZE(configs) - 1]);
+    memset(split_shmem, 0x5a, sizeof(split_shared_memory_t));
+    split_shmem->layer_state = 1 << 3;
+    memcpy(&sent, split_shmem, sizeof(sent));
+    absent(300);
+    CHECK_EQ(link_stats.drops, 1);
+    CHECK_EQ(resyncs, 1);
+    for (size_t i = 0; i < sizeof(sent); i++) {
+        CHECK(((uint8_t *)split_shmem)[i] != ((uint8_t *)&sent)[i]);
+    }
+    CHECK(link_stats.recover_last >= 300 - 25);
+    CHECK(link_stats.recover_last <= 300 + configs[ARRAY_SIZE(configs) - 1].check_interval);
+    CHECK_EQ(link_stats.recover_max, link_stats.recover_last);
+    absent(5000);
+    CHECK_EQ(link_stats.drops, 2);
+    CHECK(link_stats.recover_max >= 5000 - 25);
+}
+
+int main(void) {
+    test_absences();
+    test_stats();
+    return test_report("split_link");
+}
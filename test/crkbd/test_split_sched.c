@@ -0,0 +1,265 @@
+// Split scheduler over a simulated link between two halves.
+//
+// The master loop runs once per millisecond. Both halves register the same
+// items, each over its own copies, and the test swaps the half it is not
+// running as in to answer the RPC transaction. Typing comes from a random
+// stream of presses and releases. Staleness is how long the slave's copy
+// has differed from the master's.
+
+#include "split_sched.c"
+#include <stdlib.h>
+#include "fake.h"
+#include "test.h"
+
+typedef struct {
+    uint8_t  layer;
+    uint8_t  keylog[6];
+    uint32_t timer;
+} state_t;
+
+static state_t            master_state;
+static state_t            slave_state;
+static split_sched_item_t other_items[SPLIT_SCHED_ITEMS_MAX];
+static uint8_t            other_count;
+static bool               running_master;
+static bool               connected;
+static slave_callback_t   sched_handler;
+static uint32_t           activity_at;
+static uint32_t           link_bytes;
+static uint32_t           link_sends;
+
+bool is_keyboard_master(void) {
+    return running_master;
+}
+
+bool is_transport_connected(void) {
+    return connected;
+}
+
+uint32_t last_matrix_activity_elapsed(void) {
+    return test_now - activity_at;
+}
+
+void transaction_register_rpc(int8_t transaction_id, slave_callback_t callback) {
+    if (transaction_id == RPC_ID_KB_SPLIT_SCHED) {
+        sched_handler = callback;
+    }
+}
+
+static void swap_halves(void) {
+    split_sched_item_t items[SPLIT_SCHED_ITEMS_MAX];
+    uint8_t            count = sched_count;
+
+    memcpy(items, sched_items, sizeof(items));
+    memcpy(sched_items, other_items, sizeof(items));
+    memcpy(other_items, items, sizeof(items));
+    sched_count    = other_count;
+    other_count    = count;
+    running_master = !running_master;
+}
+
+bool transaction_rpc_send(int8_t transaction_id, uint8_t initiator2target_buffer_size, const void *initiator2target_buffer) {
+    if (!connected || transaction_id != RPC_ID_KB_SPLIT_SCHED) {
+        return false;
+    }
+    link_bytes += initiator2target_buffer_size + SPLIT_SCHED_OVERHEAD;
+    link_sends++;
+    swap_halves();
+    sched_handler(initiator2target_buffer_size, initiator2target_buffer, 0, NULL);
+    swap_halves();
+    return true;
+}
+
+static void register_items(state_t *state) {
+    split_sched_init();
+    CHECK(split_sched_register(&state->layer, sizeof(state->layer), SPLIT_SCHED_HIGH, 0));
+    CHECK(split_sched_register(&state->timer, sizeof(state->timer), SPLIT_SCHED_NORMAL, 1000));
+    CHECK(split_sched_register(state->keylog, sizeof(state->keylog), SPLIT_SCHED_LOW, 100));
+}
+
+static void boot(void) {
+    memset(&master_state, 0, sizeof(master_state));
+    memset(&slave_state, 0, sizeof(slave_state));
+    sched_count  = 0;
+    other_count  = 0;
+    sched_tokens = 0;
+    sched_refill = test_now;
+    sched_held   = false;
+
+    running_master = false;
+    register_items(&slave_state);
+    swap_halves();
+    register_items(&master_state);
+    split_sched_budget    = SPLIT_SCHED_BUDGET;
+    split_sched_key_guard = SPLIT_SCHED_KEY_GUARD;
+    connected             = true;
+    activity_at           = test_now - 1000;
+    link_bytes            = 0;
+    link_sends            = 0;
+}
+
+static void loop(uint32_t ms) {
+    while (ms--) {
+        test_now++;
+        master_state.timer = test_now;
+        split_sched_task();
+    }
+}
+
+static uint32_t seed = 1;
+
+static uint32_t random_below(uint32_t limit) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % limit;
+}
+
+// Due and changed items in priority order, unchanged ones only on refresh
+static void test_pick(void) {
+    uint16_t checksum;
+
+    boot();
+    CHECK_EQ(split_sched_pick(test_now, &checksum), 0);
+    loop(100);
+    CHECK_EQ(link_sends, 3);
+    CHECK_EQ(split_sched_pick(test_now, &checksum), -1);
+
+    // Changed but not yet due
+    master_state.keylog[0] = 'a';
+    CHECK_EQ(split_sched_pick(test_now, &checksum), -1);
+    test_now += 100;
+    CHECK_EQ(split_sched_pick(test_now, &checksum), 2);
+
+    // A higher item that changed goes first, an interval of 0 is always due
+    master_state.layer = 3;
+    CHECK_EQ(split_sched_pick(test_now, &checksum), 0);
+    CHECK_EQ(checksum, split_sched_checksum(&master_state.layer, 1));
+
+    // Unchanged items wait for the refresh
+    loop(50);
+    CHECK_EQ(slave_state.layer, 3);
+    CHECK_EQ(slave_state.keylog[0], 'a');
+    uint32_t sends = link_sends;
+    master_state.timer = 0;
+    test_now += SPLIT_SCHED_REFRESH - 100;
+    CHECK_EQ(split_sched_pick(test_now, &checksum), 1);
+    test_now += 100;
+    master_state.timer = 0;
+    CHECK_EQ(split_sched_pick(test_now, &checksum), 0);
+    loop(50);
+    CHECK(link_sends > sends);
+}
+
+// Keys that keep moving hold state back for at most the max age
+static void test_guard(void) {
+    boot();
+    loop(100);
+    master_state.layer = 1;
+    uint32_t changed = test_now;
+    while (slave_state.layer != 1 && test_now - changed < 10 * SPLIT_SCHED_GUARD_MAX_AGE) {
+        activity_at = test_now;
+        loop(1);
+    }
+    CHECK_EQ(slave_state.layer, 1);
+    CHECK(test_now - changed >= SPLIT_SCHED_GUARD_MAX_AGE);
+    CHECK(test_now - changed <= SPLIT_SCHED_GUARD_MAX_AGE + 2);
+
+    // A short burst only delays it past the burst
+    master_state.layer = 2;
+    changed            = test_now;
+    for (uint8_t i = 0; i < 50; i++) {
+        activity_at = test_now;
+        loop(1);
+    }
+    CHECK_EQ(slave_state.layer, 1);
+    loop(SPLIT_SCHED_KEY_GUARD + 1);
+    CHECK_EQ(slave_state.layer, 2);
+}
+
+// Nothing goes out while the other half is gone, all of it once it is back
+static void test_reconnect(void) {
+    boot();
+    loop(100);
+    uint32_t sends = link_sends;
+    connected              = false;
+    master_state.layer     = 4;
+    master_state.keylog[1] = 'z';
+    loop(1000);
+    CHECK_EQ(link_sends, sends);
+
+    // A rebooted slave lost its copies, a resync sends them all
+    memset(&slave_state, 0, sizeof(slave_state));
+    connected = true;
+    split_sched_resync();
+    loop(100);
+    CHECK_EQ(slave_state.layer, 4);
+    CHECK_EQ(slave_state.keylog[1], 'z');
+    CHECK(slave_state.timer != 0);
+}
+
+typedef struct {
+    uint32_t stale_since;
+    uint32_t worst;
+    uint64_t total;
+    uint32_t count;
+} staleness_t;
+
+static void track(staleness_t *s, const void *master, const void *slave, size_t size) {
+    bool same = memcmp(master, slave, size) == 0;
+
+    if (!same && !s->stale_since) {
+        s->stale_since = test_now;
+    } else if (same && s->stale_since) {
+        uint32_t stale = test_now - s->stale_since;
+        s->worst       = MAX(s->worst, stale);
+        s->total += stale;
+        s->count++;
+        s->stale_since = 0;
+    }
+}
+
+// Typing at a few keys a second with pauses, for a simulated ten minutes
+static void simulate(const char *name, uint16_t key_guard) {
+    enum { MINUTES = 10 };
+    staleness_t layer = {0}, keylog = {0};
+    uint32_t    timer_age = 0;
+    uint32_t    next_key;
+    uint32_t    start;
+
+    boot();
+    split_sched_key_guard = key_guard;
+    start                 = test_now;
+    next_key              = test_now + 100;
+    while (test_now - start < MINUTES * 60000) {
+        if (test_now >= next_key) {
+            activity_at = test_now;
+            master_state.keylog[random_below(6)]++;
+            if (random_below(20) == 0) {
+                master_state.layer = random_below(4);
+            }
+            // Mostly 60 to 260 ms between keys, sometimes a pause
+            next_key = test_now + (random_below(30) ? 60 + random_below(200) : 500 + random_below(5000));
+        }
+        loop(1);
+        track(&layer, &master_state.layer, &slave_state.layer, 1);
+        track(&keylog, master_state.keylog, slave_state.keylog, sizeof(master_state.keylog));
+        if (slave_state.timer) {
+            timer_age = MAX(timer_age, test_now - slave_state.timer);
+        }
+    }
+
+    uint32_t rate = link_bytes / (MINUTES * 60);
+    printf("  %-16s layer stale mean %3u ms max %4u; keylog mean %3u ms max %4u; timer age max %4u ms; %4u B/s\n", name, (unsigned)(layer.total / MAX(layer.count, 1)), (unsigned)layer.worst, (unsigned)(keylog.total / MAX(keylog.count, 1)), (unsigned)keylog.worst, (unsigned)timer_age, (unsigned)rate);
+    CHECK(rate <= SPLIT_SCHED_BUDGET);
+    CHECK(layer.worst <= SPLIT_SCHED_GUARD_MAX_AGE + SPLIT_SCHED_KEY_GUARD);
+    CHECK(timer_age <= 1000 + SPLIT_SCHED_REFRESH);
+}
+
+int main(void) {
+    test_pick();
+    test_guard();
+    test_reconnect();
+    printf("split scheduler over typing, budget %u B/s\n", SPLIT_SCHED_BUDGET);
+    simulate("no key guard", 0);
+    simulate("key guard", SPLIT_SCHED_KEY_GUARD);
+    return test_report("split_sched");
+}
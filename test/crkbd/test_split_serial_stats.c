@@ -0,0 +1,142 @@
+// Soft serial transaction timing of rev1, against a model of Timer0 on a
+// 16 MHz atmega32u4: a tick every 64 cycles, a compare match at 250 ticks
+// that the interrupt counts as a millisecond. The interrupt is held back
+// while a transaction runs, so the read right after one sees the match
+// flag set and the millisecond not counted yet.
+
+#include <stdint.h>
+
+static uint64_t now_cycles;
+static uint32_t counted_ms;
+
+static uint8_t fake_tcnt0(void) {
+    return now_cycles / 64 % 250;
+}
+static uint8_t fake_tifr0(void) {
+    return counted_ms < now_cycles / 16000 ? 1 : 0;
+}
+
+#define TCNT0 fake_tcnt0()
+#define TIFR0 fake_tifr0()
+#define OCR0A 249
+#define OCF0A 0
+#define _BV(bit) (1 << (bit))
+
+#include "split_serial_stats.c"
+#include "fake.h"
+#include "test.h"
+
+static uint32_t transaction_cycles;
+static bool     transaction_ok = true;
+static bool     connected      = true;
+static bool     master         = true;
+static int      transactions;
+static int      wrong_id;
+
+extern uint32_t test_now;
+
+// The millisecond interrupt runs between main loop steps
+static void advance(uint64_t cycles) {
+    now_cycles += cycles;
+    counted_ms = now_cycles / 16000;
+    test_now   = counted_ms;
+}
+
+uint32_t timer_read32(void) {
+    return counted_ms;
+}
+
+bool soft_serial_transaction(int sstd_index) {
+    transactions++;
+    wrong_id += sstd_index != GET_SLAVE_MATRIX_CHECKSUM;
+    now_cycles += transaction_cycles;
+    return transaction_ok;
+}
+
+bool is_transport_connected(void) {
+    return connected;
+}
+
+bool is_keyboard_master(void) {
+    return master;
+}
+
+// Every start phase in a millisecond, with transactions that cross it
+static void test_cycles(void) {
+    static const uint32_t lengths[] = {64, 1800, 3333, 15999};
+
+    for (uint8_t i = 0; i < sizeof(lengths) / sizeof(lengths[0]); i++) {
+        transaction_cycles = lengths[i];
+        for (uint32_t phase = 0; phase < 16000; phase += 37) {
+            advance(16000 - now_cycles % 16000 + phase);
+            stats = (split_serial_stats_t){0};
+            split_serial_stats_probe();
+            CHECK_EQ(stats.count, 1);
+            CHECK(stats.cycles + 64 > lengths[i]);
+            CHECK(stats.cycles < lengths[i] + 64);
+        }
+    }
+    CHECK_EQ(wrong_id, 0);
+}
+
+// SPLIT_SERIAL_STATS_PROBES transactions a report, spread over the interval
+static void test_report_interval(void) {
+    transaction_cycles = 2000;
+    transactions       = 0;
+    stats              = (split_serial_stats_t){0};
+    stats_timer        = timer_read();
+    fake_prints        = 0;
+    for (int ms = 0; ms < 3 * SPLIT_SERIAL_STATS_INTERVAL; ms++) {
+        int before = transactions;
+
+        split_serial_stats_task();
+        if (transactions > before) {
+            CHECK_EQ(transactions - before, 1);
+        }
+        advance(16000);
+    }
+    CHECK_EQ(fake_prints, 3);
+    CHECK(transactions >= 3 * SPLIT_SERIAL_STATS_PROBES - 1);
+    CHECK(transactions <= 3 * SPLIT_SERIAL_STATS_PROBES + 1);
+    CHECK_EQ(split_serial_stats()->count, SPLIT_SERIAL_STATS_PROBES);
+    CHECK_EQ(split_serial_stats()->errors, 0);
+    CHECK(split_serial_stats()->max >= 2000 - 64);
+    CHECK(split_serial_stats()->max <= 2000 + 64);
+    printf("split serial stats, %u transactions a report, %lu cycles average for 2000\n", split_serial_stats()->count, (unsigned long)(split_serial_stats()->cycles / split_serial_stats()->count));
+}
+
+// Failed transactions are counted, nothing is sent by the slave or while the
+// core has the link down
+static void test_errors(void) {
+    transaction_ok = false;
+    stats          = (split_serial_stats_t){0};
+    stats_timer    = timer_read();
+    for (int ms = 0; ms <= SPLIT_SERIAL_STATS_INTERVAL; ms++) {
+        split_serial_stats_task();
+        advance(16000);
+    }
+    CHECK_EQ(split_serial_stats()->errors, split_serial_stats()->count);
+    CHECK(split_serial_stats()->count > 0);
+    transaction_ok = true;
+
+    transactions = 0;
+    connected    = false;
+    for (int ms = 0; ms < SPLIT_SERIAL_STATS_INTERVAL; ms++) {
+        split_serial_stats_task();
+        advance(16000);
+    }
+    connected = true;
+    master    = false;
+    for (int ms = 0; ms < SPLIT_SERIAL_STATS_INTERVAL; ms++) {
+        split_serial_stats_task();
+        advance(16000);
+    }
+    CHECK_EQ(transactions, 0);
+}
+
+int main(void) {
+    test_cycles();
+    test_report_interval();
+    test_errors();
+    return test_report("split_serial_stats");
+}
@@ -0,0 +1,204 @@
+// Tap-hold decision latency, stock against the resolver.
+//
+// Typing is generated as words on plain and mod-tap keys with a layer-tap
+// space, plus deliberate holds: short shifted letters inside the tapping
+// term and long holds past it. Every event goes through the real
+// pre_process_tap_hold, and the policy hooks decide permissive and eager
+// holds. The core's tapping logic is modelled: a tap-hold key is decided
+// when it is released, when TAPPING_TERM runs out, or earlier as the
+// policy allows. The report gives the latency distribution and the presses
+// that came out different from what the typist meant.
+
+#define COMBO_ENABLE
+#define TAP_HOLD_STREAK_ENABLE
+#include "tap_hold.c"
+#include <stdlib.h>
+#include "fake.h"
+#include "test.h"
+
+#define TAPPING_TERM 200
+#define EVENTS_MAX 20000
+
+typedef struct {
+    uint16_t time;
+    uint16_t keycode;
+    uint8_t  row;
+    uint8_t  col;
+    bool     pressed;
+    bool     meant_hold; // on tap-hold presses
+} event_t;
+
+typedef struct {
+    uint16_t latency[EVENTS_MAX];
+    uint16_t count;
+    uint16_t wrong;
+} result_t;
+
+static event_t  events[EVENTS_MAX];
+static uint16_t event_count;
+static uint32_t seed = 1;
+
+static uint32_t random_below(uint32_t limit) {
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) % limit;
+}
+
+static uint16_t around(uint16_t mean, uint16_t spread) {
+    return mean - spread + random_below(2 * spread + 1);
+}
+
+static void add(uint16_t time, uint16_t keycode, uint8_t row, uint8_t col, bool pressed, bool meant_hold) {
+    if (event_count < EVENTS_MAX) {
+        events[event_count++] = (event_t){time, keycode, row, col, pressed, meant_hold};
+    }
+}
+
+static int by_time(const void *a, const void *b) {
+    const event_t *x = a, *y = b;
+    return x->time != y->time ? x->time - y->time : x->pressed - y->pressed;
+}
+
+// Row 0 plain letters, row 1 home row mods, row 3 the layer-tap space
+static void key(uint16_t *now, uint8_t row, uint8_t col) {
+    uint16_t keycode = row == 0 ? KC_E + col : row == 1 ? MT(MOD_LSFT, KC_A + col) : LT(1, KC_SPC);
+    uint16_t hold    = around(85, 35);
+
+    add(*now, keycode, row, col, true, false);
+    add(*now + hold, keycode, row, col, false, false);
+    *now += around(120, 60);
+}
+
+static void shifted_letter(uint16_t *now, uint16_t length) {
+    uint16_t start = *now;
+    uint16_t mod   = MT(MOD_LSFT, KC_A);
+
+    add(start, mod, 1, 0, true, true);
+    add(start + 40, KC_E, 0, 0, true, false);
+    add(start + 40 + length, KC_E, 0, 0, false, false);
+    add(start + 60 + length, mod, 1, 0, false, false);
+    *now = start + 200 + length;
+}
+
+static void generate(void) {
+    uint16_t now = 1000;
+
+    event_count = 0;
+    while (now < 60000 && event_count < EVENTS_MAX - 16) {
+        uint8_t letters = 2 + random_below(6);
+        for (uint8_t i = 0; i < letters; i++) {
+            key(&now, random_below(3) ? 0 : 1, random_below(4));
+        }
+        key(&now, 3, 0);
+        switch (random_below(12)) {
+            case 0:
+                shifted_letter(&now, 60);
+                break;
+            case 1:
+                shifted_letter(&now, TAPPING_TERM + 100);
+                break;
+        }
+        now += around(300, 200);
+    }
+    qsort(events, event_count, sizeof(event_t), by_time);
+}
+
+// Decision time of the tap-hold press at index, and whether it held
+static uint16_t decide(uint16_t index, bool resolver, bool streak, bool *hold) {
+    const event_t *press = &events[index];
+    keyrecord_t    record = {.event = {.key = {.col = press->col, .row = press->row}, .time = press->time, .type = KEY_EVENT, .pressed = true}};
+    bool           permissive = resolver && get_permissive_hold(press->keycode, &record);
+    bool           eager      = resolver && get_hold_on_other_key_press(press->keycode, &record);
+    uint16_t       deadline   = press->time + TAPPING_TERM;
+    matrix_row_t   inside[MATRIX_ROWS] = {0};
+
+    *hold = false;
+    if (streak) {
+        return press->time;
+    }
+    for (uint16_t i = index + 1; i < event_count && events[i].time < deadline; i++) {
+        const event_t *event = &events[i];
+        matrix_row_t   bit   = (matrix_row_t)1 << event->col;
+
+        if (event->row == press->row && event->col == press->col) {
+            return event->time;
+        }
+        if (event->pressed) {
+            inside[event->row] |= bit;
+            if (eager) {
+                *hold = true;
+                return event->time;
+            }
+        } else if (permissive && (inside[event->row] & bit)) {
+            *hold = true;
+            return event->time;
+        }
+    }
+    *hold = true;
+    return deadline;
+}
+
+static void simulate(bool resolver, result_t *result) {
+    memset(streak_keys, 0, sizeof(streak_keys));
+    streak_active = false;
+    result->count = 0;
+    result->wrong = 0;
+
+    for (uint16_t i = 0; i < event_count; i++) {
+        event_t    *event  = &events[i];
+        keyrecord_t record = {.event = {.key = {.col = event->col, .row = event->row}, .time = event->time, .type = KEY_EVENT, .pressed = event->pressed}};
+        bool        streak = false;
+
+        if (resolver) {
+            CHECK(pre_process_tap_hold(event->keycode, &record));
+            streak = record.keycode != 0;
+            // A streak tap is released as the keycode it was pressed as
+            if (streak) {
+                CHECK_EQ(record.keycode, tap_hold_tap_keycode(event->keycode));
+            }
+        }
+        if (!event->pressed || !is_tap_hold_keycode(event->keycode)) {
+            continue;
+        }
+
+        bool     hold;
+        uint16_t decided                   = decide(i, resolver, streak, &hold);
+        result->latency[result->count++] = decided - event->time;
+        result->wrong += hold != event->meant_hold;
+    }
+}
+
+static int by_value(const void *a, const void *b) {
+    return *(const uint16_t *)a - *(const uint16_t *)b;
+}
+
+static uint16_t percentile(result_t *result, uint8_t percent) {
+    return result->latency[(uint32_t)(result->count - 1) * percent / 100];
+}
+
+static void report(const char *name, result_t *result) {
+    uint32_t sum = 0;
+
+    qsort(result->latency, result->count, sizeof(uint16_t), by_value);
+    for (uint16_t i = 0; i < result->count; i++) {
+        sum += result->latency[i];
+    }
+    printf("  %-8s %u presses, latency mean %lu ms, p50 %u, p90 %u, p99 %u, max %u, %u not as meant\n", name, result->count, (unsigned long)(sum / result->count), percentile(result, 50), percentile(result, 90), percentile(result, 99), result->latency[result->count - 1], result->wrong);
+}
+
+static result_t stock, resolver;
+
+int main(void) {
+    generate();
+    simulate(false, &stock);
+    simulate(true, &resolver);
+
+    printf("tap-hold decision latency over %u events\n", event_count);
+    report("stock", &stock);
+    report("resolver", &resolver);
+
+    CHECK_EQ(stock.count, resolver.count);
+    CHECK(percentile(&resolver, 50) < percentile(&stock, 50));
+    CHECK(percentile(&resolver, 90) <= percentile(&stock, 90));
+    CHECK(resolver.wrong < stock.wrong);
+    return test_report("tap_hold");
+}
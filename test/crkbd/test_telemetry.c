@@ -0,0 +1,219 @@
+// Telemetry frames over a virtual serial port whose host end can be open,
+// closed, or open and not reading.
+//
+// virtser_send collects what the host reads. Nobody reads a port that is
+// not open: each byte blocks for the core's 100 ms send timeout, which the
+// test adds to the clock.
+
+#define TELEMETRY_INTERVAL 100
+#include "telemetry.c"
+#include "fake.h"
+#include "test.h"
+
+#define SEND_TIMEOUT_MS 100
+
+static uint8_t  host[4096];
+static uint16_t host_length;
+static bool     host_reading;
+static uint32_t blocked_bytes;
+
+void virtser_send(const uint8_t byte) {
+    if (!host_reading) {
+        blocked_bytes++;
+        test_now += SEND_TIMEOUT_MS;
+        return;
+    }
+    if (host_length < sizeof(host)) {
+        host[host_length++] = byte;
+    }
+}
+
+matrix_row_t matrix_get_row(uint8_t row) {
+    return 0;
+}
+
+static void loop(uint32_t ms) {
+    while (ms--) {
+        test_now++;
+        telemetry_task();
+    }
+}
+
+static void boot(void) {
+    tele_open          = false;
+    tele_head          = 0;
+    tele_tail          = 0;
+    tele_mid_frame     = false;
+    tele_seq           = 0;
+    telemetry_interval = TELEMETRY_INTERVAL;
+    host_length        = 0;
+    host_reading       = false;
+    blocked_bytes      = 0;
+}
+
+// The zero ended chunk of what the host read that starts at start,
+// decoded into out. Returns its decoded length and whether it is a frame.
+static bool decode(uint16_t start, uint16_t end, uint8_t *out, uint8_t *out_length) {
+    uint8_t  length = 0;
+    uint16_t i      = start;
+
+    while (i < end) {
+        uint8_t code = host[i++];
+        for (uint8_t n = 1; n < code && i < end; n++) {
+            out[length++] = host[i++];
+        }
+        if (code < 0xFF && i < end) {
+            out[length++] = 0;
+        }
+    }
+    uint8_t crc = 0;
+    for (uint8_t n = 0; n + 1 < length; n++) {
+        crc = telemetry_crc8(crc, out[n]);
+    }
+    *out_length = length;
+    return length > 1 && crc == out[length - 1];
+}
+
+// Frames the host read, decoded. Returns the length of the first status
+// frame in out, 0 if there was none.
+static uint8_t first_status(uint8_t *out) {
+    uint16_t start = 0;
+    uint8_t  length;
+
+    for (uint16_t end = 0; end < host_length; end++) {
+        if (host[end] != 0) {
+            continue;
+        }
+        if (decode(start, end, out, &length) && out[0] == TELEMETRY_STATUS) {
+            return length;
+        }
+        start = end + 1;
+    }
+    return 0;
+}
+
+static uint16_t status_loop_max(const uint8_t *frame) {
+    return frame[16] | frame[17] << 8;
+}
+
+// Nothing is framed or sent before the host writes to the port
+static void test_closed(void) {
+    keyrecord_t record = {.event = {.pressed = true}};
+
+    boot();
+    loop(1000);
+    telemetry_key(KC_A, &record);
+    CHECK_EQ(tele_head, 0);
+    CHECK_EQ(blocked_bytes, 0);
+}
+
+// The first frame covers only the loops since sending started
+static void test_open(void) {
+    uint8_t frame[256];
+
+    boot();
+    loop(10000);
+    host_reading = true;
+    telemetry_port_open();
+    loop(2 * TELEMETRY_INTERVAL);
+    CHECK(first_status(frame) > 0);
+    CHECK(status_loop_max(frame) <= 1000);
+
+    // Turned off and on again from the knob
+    telemetry_interval = 0;
+    loop(5000);
+    host_length        = 0;
+    telemetry_interval = TELEMETRY_INTERVAL;
+    loop(2 * TELEMETRY_INTERVAL);
+    CHECK(first_status(frame) > 0);
+    CHECK(status_loop_max(frame) <= 1000);
+}
+
+// A host that stops reading costs one blocked byte, then nothing until it
+// writes again
+static void test_stall(void) {
+    uint8_t frame[256];
+
+    boot();
+    host_reading = true;
+    telemetry_port_open();
+    loop(500);
+    CHECK(host_length > 0);
+
+    host_reading = false;
+    loop(5000);
+    CHECK_EQ(blocked_bytes, 1);
+    CHECK(!tele_open);
+    CHECK_EQ(tele_head, tele_tail);
+
+    host_reading = true;
+    host_length  = 0;
+    telemetry_port_open();
+    loop(2 * TELEMETRY_INTERVAL);
+    CHECK_EQ(blocked_bytes, 1);
+    CHECK(first_status(frame) > 0);
+    CHECK(status_loop_max(frame) <= 1000);
+}
+
+// A knob reply printed while a frame is half sent comes after that frame
+// and ends with a zero, so no frame is lost to it
+static void test_text(void) {
+    static const char reply[] = "telemetry_ms 100 (0..10000)\r\n";
+    keyrecord_t       record  = {.event = {.pressed = true}};
+    uint8_t           out[256];
+    uint8_t           length;
+    uint16_t          start  = 0;
+    uint8_t           frames = 0;
+    uint8_t           texts  = 0;
+
+    boot();
+    host_reading = true;
+    telemetry_port_open();
+    loop(TELEMETRY_INTERVAL - 1);
+    for (uint8_t i = 0; i < 8; i++) {
+        telemetry_key(KC_A + i, &record);
+    }
+    loop(1);
+    CHECK(tele_mid_frame);
+
+    telemetry_text_begin();
+    CHECK(!tele_mid_frame);
+    for (const char *c = reply; *c; c++) {
+        virtser_send(*c);
+    }
+    telemetry_text_end();
+    loop(2 * TELEMETRY_INTERVAL);
+
+    for (uint16_t end = 0; end < host_length; end++) {
+        if (host[end] != 0) {
+            continue;
+        }
+        if (end - start == sizeof(reply) - 1 && memcmp(&host[start], reply, end - start) == 0) {
+            texts++;
+        } else {
+            CHECK(decode(start, end, out, &length));
+            CHECK_EQ(out[1], frames);
+            frames++;
+        }
+        start = end + 1;
+    }
+    CHECK_EQ(texts, 1);
+    CHECK_EQ(frames, tele_seq);
+    CHECK(frames >= 11);
+
+    // Without frames going out the text is left as it is
+    telemetry_interval = 0;
+    loop(TELEMETRY_INTERVAL);
+    host_length = 0;
+    telemetry_text_begin();
+    telemetry_text_end();
+    CHECK_EQ(host_length, 0);
+}
+
+int main(void) {
+    test_closed();
+    test_open();
+    test_stall();
+    test_text();
+    return test_report("telemetry");
+}
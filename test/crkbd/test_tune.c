@@ -0,0 +1,157 @@
+// Runtime knobs over the virtual serial port and the VIA custom channel,
+// saved to and loaded from the fake EEPROM.
+//
+// Lines are typed into virtser_recv a byte at a time and the replies
+// collected from virtser_send. The knobs are the debounce bounds, which
+// bound each other, and the streak term, whose range starts at 0.
+
+#define VIRTSER_ENABLE
+#define VIA_ENABLE
+#define ADAPTIVE_DEBOUNCE_ENABLE
+#define TAP_HOLD_RESOLVER_ENABLE
+#define TAP_HOLD_STREAK_ENABLE
+#define EECONFIG_KB_TUNE_OFFSET 0
+#define EECONFIG_KB_TUNE_SIZE 34
+#include "tune.c"
+#include "fake.h"
+#include "test.h"
+
+uint8_t  adaptive_debounce_min = ADAPTIVE_DEBOUNCE_MIN;
+uint8_t  adaptive_debounce_max = ADAPTIVE_DEBOUNCE_MAX;
+uint16_t tap_hold_streak_term  = TAP_HOLD_STREAK_TERM;
+
+static char     reply[512];
+static uint16_t reply_length;
+
+void virtser_send(const uint8_t byte) {
+    if (reply_length < sizeof(reply) - 1) {
+        reply[reply_length++] = byte;
+        reply[reply_length]   = '\0';
+    }
+}
+
+static const char *type(const char *line) {
+    reply_length = 0;
+    reply[0]     = '\0';
+    while (*line) {
+        virtser_recv(*line++);
+    }
+    virtser_recv('\r');
+    return reply;
+}
+
+static bool replied(const char *line, const char *expected) {
+    return strcmp(type(line), expected) == 0;
+}
+
+// Compiled defaults, then whatever the EEPROM holds
+static void boot(void) {
+    adaptive_debounce_min = ADAPTIVE_DEBOUNCE_MIN;
+    adaptive_debounce_max = ADAPTIVE_DEBOUNCE_MAX;
+    tap_hold_streak_term  = TAP_HOLD_STREAK_TERM;
+    tune_load();
+}
+
+// Every set is checked against its range, the debounce bounds against
+// each other, and a rejected one changes nothing
+static void test_serial(void) {
+    boot();
+    CHECK(replied("set debounce_min 8", "debounce_min 8 (1..20)\r\n"));
+    CHECK(replied("set debounce_max 7", "conflicts with another value\r\n"));
+    CHECK_EQ(adaptive_debounce_max, ADAPTIVE_DEBOUNCE_MAX);
+    CHECK(replied("set debounce_max 8", "debounce_max 8 (1..20)\r\n"));
+    CHECK(replied("set debounce_min 9", "conflicts with another value\r\n"));
+    CHECK_EQ(adaptive_debounce_min, 8);
+
+    CHECK(replied("set debounce_min 0", "out of range\r\n"));
+    CHECK(replied("set debounce_max 21", "out of range\r\n"));
+    CHECK(replied("set streak_term 1001", "out of range\r\n"));
+    CHECK(replied("set streak_term 65536", "out of range\r\n"));
+    CHECK(replied("set streak_term -1", "out of range\r\n"));
+    CHECK(replied("set streak_term 1x", "out of range\r\n"));
+    CHECK_EQ(tap_hold_streak_term, TAP_HOLD_STREAK_TERM);
+    CHECK_EQ(adaptive_debounce_min, 8);
+    CHECK_EQ(adaptive_debounce_max, 8);
+
+    // The bottom of a range is a value like any other
+    CHECK(replied("set streak_term 0", "streak_term 0 (0..1000)\r\n"));
+    CHECK_EQ(tap_hold_streak_term, 0);
+
+    CHECK(replied("set nothing 3", "unknown name\r\n"));
+    CHECK(replied("get nothing", "unknown name\r\n"));
+    CHECK(replied("get streak_term", "streak_term 0 (0..1000)\r\n"));
+    CHECK(strncmp(type("set streak_term 5 6"), "list |", 6) == 0);
+    CHECK(strncmp(type("set streak_term"), "list |", 6) == 0);
+    CHECK_EQ(tap_hold_streak_term, 0);
+}
+
+static uint8_t via_set(uint8_t index, uint16_t value) {
+    uint8_t data[32] = {id_custom_set_value, id_custom_channel, id_tune_param, index, value & 0xFF, value >> 8};
+
+    CHECK(tune_via_command(data, sizeof(data)));
+    return data[6];
+}
+
+// A set answers with its status, the value stays unless it was applied
+static void test_via(void) {
+    boot();
+    CHECK_EQ(via_set(0, 10), TUNE_OK);
+    CHECK_EQ(adaptive_debounce_min, 10);
+    CHECK_EQ(via_set(1, 9), TUNE_CONFLICT);
+    CHECK_EQ(adaptive_debounce_max, ADAPTIVE_DEBOUNCE_MAX);
+    CHECK_EQ(via_set(1, 300), TUNE_OUT_OF_RANGE);
+    CHECK_EQ(via_set(2, 1001), TUNE_OUT_OF_RANGE);
+    CHECK_EQ(via_set(2, 0), TUNE_OK);
+    CHECK_EQ(tap_hold_streak_term, 0);
+    CHECK_EQ(via_set(TUNE_COUNT, 1), TUNE_UNKNOWN);
+
+    // Reads back the value with its range and name
+    uint8_t data[32] = {id_custom_get_value, id_custom_channel, id_tune_param, 0};
+    CHECK(tune_via_command(data, sizeof(data)));
+    CHECK_EQ(data[4], 10);
+    CHECK_EQ(data[6], 1);
+    CHECK_EQ(data[8], ADAPTIVE_DEBOUNCE_MAX);
+    CHECK(strcmp((char *)&data[10], "debounce_min") == 0);
+}
+
+// Saved values come back at boot, unless any of them is out of range or
+// they conflict, then none of them do
+static void test_load(void) {
+    uint16_t table[1 + TUNE_COUNT];
+
+    boot();
+    CHECK(replied("set debounce_max 12", "debounce_max 12 (1..20)\r\n"));
+    CHECK(replied("set debounce_min 11", "debounce_min 11 (1..20)\r\n"));
+    CHECK(replied("save", "saved\r\n"));
+    boot();
+    CHECK_EQ(adaptive_debounce_min, 11);
+    CHECK_EQ(adaptive_debounce_max, 12);
+
+    // Written by a build with the same knobs and a looser check
+    memcpy(table, fake_eeprom, sizeof(table));
+    table[1] = 15;
+    memcpy(fake_eeprom, table, sizeof(table));
+    adaptive_debounce_min = ADAPTIVE_DEBOUNCE_MIN;
+    adaptive_debounce_max = ADAPTIVE_DEBOUNCE_MAX;
+    tune_load();
+    CHECK_EQ(adaptive_debounce_min, ADAPTIVE_DEBOUNCE_MIN);
+    CHECK_EQ(adaptive_debounce_max, ADAPTIVE_DEBOUNCE_MAX);
+
+    table[1] = 11;
+    table[3] = 2000;
+    memcpy(fake_eeprom, table, sizeof(table));
+    tune_load();
+    CHECK_EQ(adaptive_debounce_min, ADAPTIVE_DEBOUNCE_MIN);
+    CHECK_EQ(tap_hold_streak_term, TAP_HOLD_STREAK_TERM);
+
+    CHECK(replied("reset", "defaults\r\n"));
+    tune_load();
+    CHECK_EQ(adaptive_debounce_max, ADAPTIVE_DEBOUNCE_MAX);
+}
+
+int main(void) {
+    test_serial();
+    test_via();
+    test_load();
+    return test_report("tune");
+}
@@ -0,0 +1,39 @@
+// The keyboard code of one half, with what it exports named after HALF,
+// left or right, so both link into the simulator. rev4_1 is the revision
+// with the UART pin swap.
+
+#define QMK_KEYBOARD_H "quantum.h"
+#define SPLIT_KEYBOARD
+#define SPLIT_LINK_ENABLE
+#include "rev4_1/config.h"
+
+#define HALF_CAT(half, name) half##_##name
+#define HALF_NAME_(half, name) HALF_CAT(half, name)
+#define HALF_NAME(name) HALF_NAME_(HALF, name)
+
+#define keyboard_pre_init_user HALF_NAME(keyboard_pre_init_user)
+#define keyboard_post_init_kb HALF_NAME(keyboard_post_init_kb)
+#define keyboard_post_init_user HALF_NAME(keyboard_post_init_user)
+#define housekeeping_task_kb HALF_NAME(housekeeping_task_kb)
+#define housekeeping_task_user HALF_NAME(housekeeping_task_user)
+#define pre_process_record_kb HALF_NAME(pre_process_record_kb)
+#define process_record_kb HALF_NAME(process_record_kb)
+#define split_link_task HALF_NAME(split_link_task)
+#define split_link_stats HALF_NAME(split_link_stats)
+#define split_shmem HALF_NAME(split_shmem)
+
+#include "half.h"
+
+#include "crkbd.c"
+#include "split_link.c"
+
+static split_shared_memory_t shmem;
+split_shared_memory_t *const split_shmem = &shmem;
+
+const half_code_t HALF_NAME(code) = {
+    .pre_init     = keyboard_pre_init_user,
+    .post_init    = keyboard_post_init_kb,
+    .housekeeping = housekeeping_task_kb,
+    .link_stats   = split_link_stats,
+    .shmem        = &shmem,
+};
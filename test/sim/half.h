@@ -0,0 +1,19 @@
+#pragma once
+
+// One half's keyboard code as the simulator calls it. sim/half.c is built
+// once per half, so each has its own copy of the code and its statics, as
+// each half has its own MCU.
+
+#include "transport.h"
+#include "split_link.h"
+
+typedef struct {
+    void (*pre_init)(void);     // keyboard_pre_init_user
+    void (*post_init)(void);    // keyboard_post_init_kb
+    void (*housekeeping)(void); // housekeeping_task_kb
+    const split_link_stats_t *(*link_stats)(void);
+    split_shared_memory_t *shmem;
+} half_code_t;
+
+extern const half_code_t left_code;
+extern const half_code_t right_code;
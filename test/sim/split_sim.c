@@ -0,0 +1,572 @@
+// Both halves of rev4_1 running their own keyboard code, each in its own
+// thread with its own clock, joined by a virtual UART. split_sim.py feeds
+// it key events and reads what reached the master.
+//
+// A half boots through keyboard_pre_init_user, which reads the hand pin
+// and puts the UART on the pins of its side. The cable joins the left
+// half's GP4 to the right half's GP25 and GP5 to GP24, and on the RP2040 a
+// pin with n % 4 == 0 is a UART TX and n % 4 == 1 an RX, so bytes only get
+// through when both halves picked their side's pins.
+//
+// The master runs the core transport as a loop of scan, transactions and
+// housekeeping_task_kb, with split_link.c on top of it. The slave answers
+// each request from its matrix as of the time the request reached it. A
+// byte takes 10 bit times plus the line latency, its data bits flip at the
+// bit error rate and it is gone inside a disconnect window. A half waiting
+// on a byte waits until the other half has sent it or can no longer send
+// it in time, so the run only depends on the options, not on the threads.
+//
+// Events come on stdin as "time_us row col pressed". Out come the pins
+// each half set up, a "latency <us>" line for each event that reached the
+// master, and the totals.
+
+#include <getopt.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "quantum.h"
+#include "gpio.h"
+#include "hal.h"
+#include "transactions.h"
+#include "half.h"
+#include "rev4_1/config.h"
+
+#define NUM_PINS 30
+#define LINE_BYTES 32
+#define MAX_WINDOWS 16
+
+enum { PIN_INPUT, PIN_OUTPUT };
+
+typedef struct {
+    uint64_t arrival;
+    uint8_t  byte;
+} line_byte_t;
+
+// Bytes on their way to one half, in the order they arrive
+typedef struct {
+    line_byte_t queue[LINE_BYTES];
+    uint8_t     head;
+    uint8_t     count;
+    uint64_t    free_at; // when the sender's UART is done with its last byte
+} line_t;
+
+typedef struct half {
+    const char        *name;
+    const half_code_t *code;
+    bool               left; // side of the cable
+    bool               master;
+    bool               hand; // level the hand pin reads
+    uint8_t            mode[NUM_PINS];
+    uint64_t           now; // ns
+    bool               reading;
+    line_t             rx;
+    struct half       *peer;
+    uint64_t           rng;
+
+    uint8_t  matrix[ROWS_PER_HAND]; // slave, as of snapshot_at
+    uint64_t snapshot_at;
+} half_t;
+
+typedef struct {
+    uint64_t time; // ns
+    uint8_t  row;
+    uint8_t  col;
+    bool     pressed;
+} event_t;
+
+static struct {
+    uint32_t baud;
+    uint64_t latency;
+    double   ber;
+    uint64_t scan;
+    uint64_t timeout;
+    uint8_t  max_errors;
+    uint64_t check_interval;
+    uint64_t windows[MAX_WINDOWS][2];
+    uint8_t  num_windows;
+    bool     verbose;
+} opt = {
+    .baud           = SERIAL_USART_SPEED,
+    .scan           = 300000,
+    .timeout        = SERIAL_USART_TIMEOUT * 1000000ull,
+    .max_errors     = SPLIT_MAX_CONNECTION_ERRORS,
+    .check_interval = SPLIT_CONNECTION_CHECK_INTERVAL * 1000000ull,
+};
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  changed = PTHREAD_COND_INITIALIZER;
+static bool            done;
+
+static half_t             left = {.name = "left", .code = &left_code, .left = true};
+static half_t             right = {.name = "right", .code = &right_code};
+static _Thread_local half_t *self;
+
+static event_t *events;
+static size_t   num_events;
+
+static uint64_t byte_ns(void) {
+    return 10000000000ull / opt.baud;
+}
+
+// Cable ends, left pin to right pin
+static const uint8_t wires[][2] = {{GP4, GP25}, {GP5, GP24}};
+
+static bool uart_pin(const half_t *half, uint8_t pin, uint8_t role) {
+    return half->mode[pin] == PAL_MODE_ALTERNATE_UART && pin % 4 == role;
+}
+
+static bool wired(const half_t *from, const half_t *to) {
+    for (size_t i = 0; i < ARRAY_SIZE(wires); i++) {
+        uint8_t out = wires[i][!from->left], in = wires[i][!to->left];
+
+        if (uart_pin(from, out, 0) && uart_pin(to, in, 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool disconnected(uint64_t time) {
+    for (uint8_t i = 0; i < opt.num_windows; i++) {
+        if (time >= opt.windows[i][0] && time < opt.windows[i][0] + opt.windows[i][1]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static double random_unit(half_t *half) {
+    half->rng ^= half->rng << 13;
+    half->rng ^= half->rng >> 7;
+    half->rng ^= half->rng << 17;
+    return (half->rng >> 11) * (1.0 / (1ull << 53));
+}
+
+// Called with the lock held
+static void send_byte(uint8_t byte) {
+    line_t  *line   = &self->peer->rx;
+    uint64_t depart = MAX(self->now, line->free_at);
+
+    line->free_at = depart + byte_ns();
+    self->now     = line->free_at;
+    if (!wired(self, self->peer) || disconnected(depart)) {
+        return;
+    }
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        if (random_unit(self) < opt.ber) {
+            byte ^= 1 << bit;
+        }
+    }
+    if (line->count < LINE_BYTES) {
+        line->queue[(line->head + line->count++) % LINE_BYTES] = (line_byte_t){line->free_at + opt.latency, byte};
+    }
+    pthread_cond_broadcast(&changed);
+}
+
+static bool take_byte(uint8_t *byte, uint64_t deadline) {
+    line_t *line = &self->rx;
+
+    if (!line->count || line->queue[line->head].arrival > deadline) {
+        return false;
+    }
+    *byte     = line->queue[line->head].byte;
+    self->now = MAX(self->now, line->queue[line->head].arrival);
+    line->head = (line->head + 1) % LINE_BYTES;
+    line->count--;
+    return true;
+}
+
+// Whether the peer might still send a byte that arrives by the deadline
+static bool peer_may_send(uint64_t deadline) {
+    const half_t *peer = self->peer;
+
+    if (done || (deadline != UINT64_MAX && peer->reading && !peer->rx.count)) {
+        return false;
+    }
+    return deadline == UINT64_MAX || peer->now + byte_ns() + opt.latency <= deadline;
+}
+
+// Called with the lock held
+static bool receive_byte(uint8_t *byte, uint64_t deadline) {
+    bool ok;
+
+    self->reading = true;
+    pthread_cond_broadcast(&changed);
+    while (!(ok = take_byte(byte, deadline)) && !self->rx.count && peer_may_send(deadline)) {
+        pthread_cond_wait(&changed, &lock);
+    }
+    self->reading = false;
+    if (!ok) {
+        self->now = MAX(self->now, deadline);
+    }
+    pthread_cond_broadcast(&changed);
+    return ok;
+}
+
+static uint8_t crc8(const uint8_t *data, size_t size) {
+    uint8_t crc = 0;
+
+    while (size--) {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = crc & 0x80 ? crc << 1 ^ 0x07 : crc << 1;
+        }
+    }
+    return crc;
+}
+
+// The keyboard code's view of its own half
+
+bool is_keyboard_master(void) {
+    return self->master;
+}
+bool is_keyboard_left(void) {
+    return self->hand;
+}
+
+uint16_t timer_read(void) {
+    return self->now / 1000000;
+}
+uint32_t timer_read32(void) {
+    return self->now / 1000000;
+}
+
+unsigned long readPin(pin_t pin) {
+    return pin == SPLIT_HAND_PIN ? self->hand : 1;
+}
+void setPinOutput(pin_t pin) {
+    self->mode[pin] = PIN_OUTPUT;
+}
+void setPinInputHigh(pin_t pin) {
+    self->mode[pin] = PIN_INPUT;
+}
+void palSetPadMode(uint32_t port, uint8_t pad, uint32_t mode) {
+    self->mode[pad] = mode;
+}
+unsigned long palReadPad(uint32_t port, uint8_t pad) {
+    return 1;
+}
+
+bool pre_process_record_user(uint16_t keycode, keyrecord_t *record) {
+    return true;
+}
+bool process_record_user(uint16_t keycode, keyrecord_t *record) {
+    return true;
+}
+
+int xprintf(const char *fmt, ...) {
+    if (opt.verbose) {
+        va_list args;
+
+        va_start(args, fmt);
+        fprintf(stderr, "%s %" PRIu64 " us: ", self->name, self->now / 1000);
+        vfprintf(stderr, fmt, args);
+        va_end(args);
+    }
+    return 0;
+}
+
+// Master, the core transport
+
+static uint8_t  errors;
+static bool     tried_down;
+static uint64_t check_at;
+
+bool is_transport_connected(void) {
+    return !self->master || errors < opt.max_errors;
+}
+
+// As transport_master_if_connected: a link that is down is tried once per
+// check interval, timed from the last failed try while down
+static bool should_try(void) {
+    tried_down = !is_transport_connected();
+    return !tried_down || self->now - check_at >= opt.check_interval;
+}
+
+static void result(bool ok) {
+    if (ok) {
+        errors = 0;
+        return;
+    }
+    errors = MIN(errors + 1, 255);
+    if (tried_down) {
+        check_at = self->now;
+    }
+}
+
+// One request byte and its reply, after the bytes that came in late for
+// earlier ones are cleared
+static bool transaction(uint8_t id, uint8_t *reply, uint8_t size) {
+    bool ok = true;
+
+    pthread_mutex_lock(&lock);
+    while (self->rx.count && self->rx.queue[self->rx.head].arrival <= self->now) {
+        self->rx.head = (self->rx.head + 1) % LINE_BYTES;
+        self->rx.count--;
+    }
+    send_byte(id);
+    uint64_t deadline = self->now + opt.timeout;
+    for (uint8_t i = 0; ok && i < size; i++) {
+        ok = receive_byte(&reply[i], deadline);
+    }
+    pthread_mutex_unlock(&lock);
+    return ok;
+}
+
+typedef struct {
+    uint16_t changes; // since the last delivery
+    uint64_t last;
+    bool     state;
+} key_state_t;
+
+static key_state_t    keys[ROWS_PER_HAND][MATRIX_COLS];
+static size_t   master_index;
+static uint32_t delivered;
+static uint32_t lost;
+
+// Events the slave's reply covered either reached the master or were
+// undone before it
+static void deliver(const uint8_t *matrix, uint64_t snapshot_at) {
+    for (; master_index < num_events && events[master_index].time <= snapshot_at; master_index++) {
+        key_state_t *key = &keys[events[master_index].row][events[master_index].col];
+
+        key->changes++;
+        key->last = events[master_index].time;
+    }
+    for (uint8_t row = 0; row < ROWS_PER_HAND; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            key_state_t *key   = &keys[row][col];
+            bool   state = matrix[row] >> col & 1;
+
+            if (!key->changes) {
+                continue;
+            }
+            if (state != key->state) {
+                printf("latency %" PRIu64 "\n", (self->now - key->last) / 1000);
+                delivered++;
+                key->changes--;
+            }
+            lost += key->changes;
+            key->changes = 0;
+            key->state   = state;
+        }
+    }
+}
+
+static bool read_slave(void) {
+    split_shared_memory_t *shmem = self->code->shmem;
+    uint8_t                checksum, matrix[ROWS_PER_HAND];
+
+    if (!transaction(GET_SLAVE_MATRIX_CHECKSUM, &checksum, 1)) {
+        return false;
+    }
+    if (checksum == shmem->matrix_checksum) {
+        return true;
+    }
+    if (!transaction(GET_SLAVE_MATRIX_DATA, matrix, sizeof(matrix)) || crc8(matrix, sizeof(matrix)) != checksum) {
+        return false;
+    }
+    memcpy(shmem->matrix, matrix, sizeof(matrix));
+    shmem->matrix_checksum = checksum;
+
+    pthread_mutex_lock(&lock);
+    uint64_t snapshot_at = self->peer->snapshot_at;
+    pthread_mutex_unlock(&lock);
+    deliver(matrix, snapshot_at);
+    return true;
+}
+
+static void *run_master(void *half) {
+    uint64_t end = (num_events ? events[num_events - 1].time : 0) + 1000000000ull;
+
+    self = half;
+    while (self->now < end) {
+        self->now += opt.scan;
+        if (should_try()) {
+            result(read_slave());
+        }
+        self->code->housekeeping();
+    }
+    pthread_mutex_lock(&lock);
+    done = true;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+// Slave, answering from its matrix as of when each request came in
+
+static void *run_slave(void *half) {
+    size_t  index = 0;
+    uint8_t id;
+
+    self = half;
+    pthread_mutex_lock(&lock);
+    while (!done) {
+        if (!receive_byte(&id, UINT64_MAX)) {
+            continue;
+        }
+        if (id == GET_SLAVE_MATRIX_CHECKSUM) {
+            for (; index < num_events && events[index].time <= self->now; index++) {
+                uint8_t bit = 1 << events[index].col;
+
+                self->matrix[events[index].row] = events[index].pressed ? self->matrix[events[index].row] | bit : self->matrix[events[index].row] & ~bit;
+            }
+            self->snapshot_at = self->now;
+            send_byte(crc8(self->matrix, sizeof(self->matrix)));
+        } else if (id == GET_SLAVE_MATRIX_DATA) {
+            for (uint8_t row = 0; row < ROWS_PER_HAND; row++) {
+                send_byte(self->matrix[row]);
+            }
+        }
+        pthread_mutex_unlock(&lock);
+        self->code->housekeeping();
+        pthread_mutex_lock(&lock);
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+static void read_events(void) {
+    size_t   size = 0;
+    uint64_t time;
+    unsigned row, col, pressed;
+
+    while (scanf("%" SCNu64 " %u %u %u", &time, &row, &col, &pressed) == 4) {
+        if (num_events == size) {
+            size   = size ? 2 * size : 1024;
+            events = realloc(events, size * sizeof(event_t));
+            if (!events) {
+                perror("split_sim");
+                exit(1);
+            }
+        }
+        events[num_events++] = (event_t){time * 1000, row % ROWS_PER_HAND, col % MATRIX_COLS, pressed};
+    }
+}
+
+static void boot(half_t *half) {
+    self = half;
+    half->code->pre_init();
+    half->code->post_init();
+    printf("pins %s", half->name);
+    for (uint8_t pin = 0; pin < NUM_PINS; pin++) {
+        if (half->mode[pin] == PAL_MODE_ALTERNATE_UART) {
+            printf(" GP%u", pin);
+        }
+    }
+    printf("\n");
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "usage: split_sim [--slave left|right] [--hand-pin wired|high|low] [--baud N] [--latency US] [--ber RATE]\n"
+            "                 [--disconnect START_MS:MS]... [--scan US] [--timeout MS] [--max-errors N]\n"
+            "                 [--check-interval MS] [--seed N] [--verbose] < events\n");
+    exit(2);
+}
+
+int main(int argc, char **argv) {
+    static const struct option options[] = {
+        {"slave", required_argument, NULL, 's'},   {"hand-pin", required_argument, NULL, 'h'}, {"baud", required_argument, NULL, 'b'},
+        {"latency", required_argument, NULL, 'l'}, {"ber", required_argument, NULL, 'e'},      {"disconnect", required_argument, NULL, 'd'},
+        {"scan", required_argument, NULL, 'c'},    {"timeout", required_argument, NULL, 't'},  {"max-errors", required_argument, NULL, 'm'},
+        {"check-interval", required_argument, NULL, 'i'}, {"seed", required_argument, NULL, 'r'}, {"verbose", no_argument, NULL, 'v'},
+        {0},
+    };
+    const char *hand_pin = "wired";
+    bool        slave_right = true;
+    uint64_t    seed        = 1;
+    int         c;
+
+    while ((c = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (c) {
+            case 's':
+                slave_right = strcmp(optarg, "left") != 0;
+                break;
+            case 'h':
+                hand_pin = optarg;
+                break;
+            case 'b':
+                opt.baud = strtoul(optarg, NULL, 10);
+                break;
+            case 'l':
+                opt.latency = strtod(optarg, NULL) * 1000;
+                break;
+            case 'e':
+                opt.ber = strtod(optarg, NULL);
+                break;
+            case 'd': {
+                unsigned long start, length;
+
+                if (opt.num_windows == MAX_WINDOWS || sscanf(optarg, "%lu:%lu", &start, &length) != 2) {
+                    usage();
+                }
+                opt.windows[opt.num_windows][0]   = start * 1000000ull;
+                opt.windows[opt.num_windows++][1] = length * 1000000ull;
+                break;
+            }
+            case 'c':
+                opt.scan = strtoull(optarg, NULL, 10) * 1000;
+                break;
+            case 't':
+                opt.timeout = strtoull(optarg, NULL, 10) * 1000000;
+                break;
+            case 'm':
+                opt.max_errors = strtoul(optarg, NULL, 10);
+                break;
+            case 'i':
+                opt.check_interval = strtoull(optarg, NULL, 10) * 1000000;
+                break;
+            case 'r':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'v':
+                opt.verbose = true;
+                break;
+            default:
+                usage();
+        }
+    }
+    if (!opt.baud || optind != argc) {
+        usage();
+    }
+    read_events();
+
+    half_t *master = slave_right ? &left : &right;
+    half_t *slave  = master == &left ? &right : &left;
+
+    left.peer    = &right;
+    right.peer   = &left;
+    left.hand    = strcmp(hand_pin, "low") != 0;
+    right.hand   = strcmp(hand_pin, "high") == 0;
+    master->master = true;
+    left.rng     = 2 * seed + 1;
+    right.rng    = 2 * seed + 2;
+    boot(&left);
+    boot(&right);
+
+    pthread_t master_thread, slave_thread;
+
+    pthread_create(&slave_thread, NULL, run_slave, slave);
+    pthread_create(&master_thread, NULL, run_master, master);
+    pthread_join(master_thread, NULL);
+    pthread_join(slave_thread, NULL);
+
+    self = master;
+    lost += num_events - master_index;
+    for (uint8_t row = 0; row < ROWS_PER_HAND; row++) {
+        for (uint8_t col = 0; col < MATRIX_COLS; col++) {
+            lost += keys[row][col].changes;
+        }
+    }
+
+    const split_link_stats_t *stats = master->code->link_stats();
+
+    printf("events %zu\n", num_events);
+    printf("delivered %" PRIu32 " lost %" PRIu32 "\n", delivered, lost);
+    printf("drops %u recover_max %u\n", stats->drops, stats->recover_max);
+    return 0;
+}
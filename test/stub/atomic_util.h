@@ -0,0 +1,4 @@
+#pragma once
+
+// Stand-in for atomic_util.h, the tests run on one thread
+#define ATOMIC_BLOCK_FORCEON
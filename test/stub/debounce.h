@@ -0,0 +1,9 @@
+#pragma once
+
+// Stand-in for debounce.h, the custom debounce interface
+
+#include "quantum.h"
+
+void debounce_init(uint8_t num_rows);
+void debounce_free(void);
+bool debounce(matrix_row_t raw[], matrix_row_t cooked[], uint8_t num_rows, bool changed);
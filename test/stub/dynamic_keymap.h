@@ -0,0 +1,12 @@
+#pragma once
+
+// Stand-in for dynamic_keymap.h. Vial takes a uint8_t combo index, a
+// wider one here lets tests fill larger tables
+
+#include "quantum.h"
+#include "vial.h"
+
+uint16_t dynamic_keymap_get_keycode(uint8_t layer, uint8_t row, uint8_t column);
+int      dynamic_keymap_get_combo(uint16_t index, vial_combo_entry_t *entry);
+uint16_t dynamic_keymap_macro_get_buffer_size(void);
+void     dynamic_keymap_macro_get_buffer(uint16_t offset, uint16_t size, uint8_t *data);
@@ -0,0 +1,10 @@
+#pragma once
+
+// Stand-in for eeconfig.h, the kb datablock lives in fake_eeprom
+
+#include <stdbool.h>
+#include <stdint.h>
+
+bool eeconfig_is_kb_datablock_valid(void);
+void eeconfig_read_kb_datablock(void *data, uint32_t offset, uint32_t length);
+void eeconfig_update_kb_datablock(const void *data, uint32_t offset, uint32_t length);
@@ -0,0 +1,20 @@
+#pragma once
+
+// Stand-in for QMK's encoder.h, with the custom driver interface
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define NUM_ENCODERS_LEFT (sizeof((pin_t[])ENCODER_A_PINS) / sizeof(pin_t))
+#ifdef ENCODER_A_PINS_RIGHT
+#    define NUM_ENCODERS_RIGHT (sizeof((pin_t[])ENCODER_A_PINS_RIGHT) / sizeof(pin_t))
+#else
+#    define NUM_ENCODERS_RIGHT NUM_ENCODERS_LEFT
+#endif
+#define NUM_ENCODERS_MAX_PER_SIDE MAX(NUM_ENCODERS_LEFT, NUM_ENCODERS_RIGHT)
+
+// False when the event queue is full
+bool encoder_queue_event(uint8_t index, bool clockwise);
+
+void encoder_driver_init(void);
+void encoder_driver_task(void);
@@ -0,0 +1,263 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "quantum.h"
+#include "send_string.h"
+#include "eeconfig.h"
+#include "transactions.h"
+#include "transport.h"
+#include "host.h"
+#include "fake.h"
+#include "test.h"
+
+// Default fakes of the QMK functions the keyboard code calls. They are
+// weak, a test that needs different behaviour defines its own.
+
+#define FAKE __attribute__((weak))
+
+static int test_checks;
+static int test_failures;
+
+bool test_check(bool ok, const char *what, const char *file, int line) {
+    test_checks++;
+    if (!ok) {
+        test_failures++;
+        fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+    }
+    return ok;
+}
+
+int test_report(const char *name) {
+    printf("%s: %d checks, %d failed\n", name, test_checks, test_failures);
+    return test_failures ? 1 : 0;
+}
+
+void test_bench(const char *name, double ns) {
+    if (getenv("TEST_BENCH")) {
+        printf("bench %s %.2f\n", name, ns);
+    }
+}
+
+uint32_t test_now;
+
+FAKE uint16_t timer_read(void) {
+    return test_now;
+}
+FAKE uint32_t timer_read32(void) {
+    return test_now;
+}
+FAKE systime_t chVTGetSystemTimeX(void) {
+    return test_now * 1000;
+}
+FAKE uint32_t last_matrix_activity_elapsed(void) {
+    return UINT32_MAX;
+}
+FAKE uint32_t last_input_activity_elapsed(void) {
+    return UINT32_MAX;
+}
+FAKE uint16_t timer_elapsed(uint16_t last) {
+    return TIMER_DIFF_16(timer_read(), last);
+}
+FAKE uint32_t timer_elapsed32(uint32_t last) {
+    return TIMER_DIFF_32(timer_read32(), last);
+}
+
+fake_key_t fake_keys[FAKE_KEYS_MAX];
+uint16_t   fake_key_count;
+
+static void fake_key(uint16_t code, uint8_t action) {
+    if (fake_key_count < FAKE_KEYS_MAX) {
+        fake_keys[fake_key_count++] = (fake_key_t){.code = code, .action = action, .time = test_now};
+    }
+}
+
+FAKE void tap_code(uint8_t code) {
+    fake_key(code, FAKE_TAP);
+}
+FAKE void tap_code16(uint16_t code) {
+    fake_key(code, FAKE_TAP);
+}
+FAKE void register_code(uint8_t code) {
+    fake_key(code, FAKE_PRESS);
+}
+FAKE void unregister_code(uint8_t code) {
+    fake_key(code, FAKE_RELEASE);
+}
+FAKE void register_code16(uint16_t code) {
+    fake_key(code, FAKE_PRESS);
+}
+FAKE void unregister_code16(uint16_t code) {
+    fake_key(code, FAKE_RELEASE);
+}
+
+uint8_t fake_mods;
+
+FAKE uint8_t get_mods(void) {
+    return fake_mods;
+}
+FAKE void set_mods(uint8_t mods) {
+    fake_mods = mods;
+}
+FAKE void clear_mods(void) {
+    fake_mods = 0;
+}
+FAKE uint8_t get_oneshot_mods(void) {
+    return 0;
+}
+
+int fake_prints;
+
+FAKE bool debug_enable;
+
+FAKE int xprintf(const char *fmt, ...) {
+    fake_prints++;
+    if (getenv("TEST_VERBOSE")) {
+        va_list args;
+        va_start(args, fmt);
+        vprintf(fmt, args);
+        va_end(args);
+    }
+    return 0;
+}
+
+FAKE void wait_us(uint16_t us) {}
+FAKE void wait_ms(uint16_t ms) {
+    test_now += ms;
+}
+
+fake_rgb_t fake_rgb = {.mode = 1};
+
+FAKE uint8_t rgb_matrix_get_mode(void) {
+    return fake_rgb.mode;
+}
+FAKE uint8_t rgb_matrix_get_hue(void) {
+    return fake_rgb.hue;
+}
+FAKE uint8_t rgb_matrix_get_sat(void) {
+    return fake_rgb.sat;
+}
+FAKE uint8_t rgb_matrix_get_val(void) {
+    return fake_rgb.val;
+}
+FAKE void rgb_matrix_mode_noeeprom(uint8_t mode) {
+    fake_rgb.mode = mode;
+}
+FAKE void rgb_matrix_mode(uint8_t mode) {
+    fake_rgb.mode = mode;
+    fake_rgb.eeprom_writes++;
+}
+FAKE void rgb_matrix_sethsv_noeeprom(uint8_t hue, uint8_t sat, uint8_t val) {
+    fake_rgb.hue = hue;
+    fake_rgb.sat = sat;
+    fake_rgb.val = val;
+}
+FAKE void rgb_matrix_sethsv(uint8_t hue, uint8_t sat, uint8_t val) {
+    rgb_matrix_sethsv_noeeprom(hue, sat, val);
+    fake_rgb.eeprom_writes++;
+}
+FAKE void eeconfig_update_rgb_matrix(void) {
+    fake_rgb.eeprom_writes++;
+}
+
+// Hue, saturation and value straight through, enough to tell colors apart
+FAKE RGB hsv_to_rgb(HSV hsv) {
+    return (RGB){hsv.h, hsv.s, hsv.v};
+}
+FAKE void rgb_matrix_set_color(int index, uint8_t red, uint8_t green, uint8_t blue) {}
+
+FAKE layer_state_t layer_state;
+FAKE layer_state_t default_layer_state = 1;
+
+FAKE void action_exec(keyevent_t event) {}
+
+// Records the core would process, logged as presses and releases of their
+// keycode
+FAKE void process_record(keyrecord_t *record) {
+    fake_key(record->keycode, record->event.pressed ? FAKE_PRESS : FAKE_RELEASE);
+}
+FAKE void action_tapping_process(keyrecord_t record) {
+    process_record(&record);
+}
+
+char fake_sent[256];
+int  fake_sends;
+
+FAKE void send_string(const char *string) {
+    snprintf(fake_sent, sizeof(fake_sent), "%s", string);
+    fake_sends++;
+}
+FAKE void send_string_P(const char *string) {
+    send_string(string);
+}
+
+FAKE keymap_config_t keymap_config;
+
+FAKE void set_weak_mods(uint8_t mods) {}
+FAKE void clear_weak_mods(void) {}
+FAKE void add_key(uint8_t key) {}
+FAKE void del_key(uint8_t key) {}
+FAKE void send_keyboard_report(void) {}
+FAKE void send_char(char ascii_code) {}
+
+uint8_t  fake_eeprom[FAKE_EEPROM_SIZE];
+bool     fake_eeprom_valid = true;
+int      fake_eeprom_writes;
+uint32_t fake_eeprom_largest_write;
+
+FAKE bool eeconfig_is_kb_datablock_valid(void) {
+    return fake_eeprom_valid;
+}
+FAKE void eeconfig_read_kb_datablock(void *data, uint32_t offset, uint32_t length) {
+    memcpy(data, &fake_eeprom[offset], length);
+}
+FAKE void eeconfig_update_kb_datablock(const void *data, uint32_t offset, uint32_t length) {
+    memcpy(&fake_eeprom[offset], data, length);
+    fake_eeprom_writes++;
+    if (length > fake_eeprom_largest_write) {
+        fake_eeprom_largest_write = length;
+    }
+}
+
+int fake_clears;
+
+FAKE void clear_keyboard(void) {
+    fake_clears++;
+}
+
+// A master on the left half with no link to the other half
+FAKE bool is_keyboard_master(void) {
+    return true;
+}
+FAKE bool is_keyboard_left(void) {
+    return true;
+}
+FAKE bool is_transport_connected(void) {
+    return false;
+}
+static host_driver_t *fake_host_driver;
+
+FAKE host_driver_t *host_get_driver(void) {
+    return fake_host_driver;
+}
+FAKE void host_set_driver(host_driver_t *driver) {
+    fake_host_driver = driver;
+}
+
+static split_shared_memory_t fake_shmem;
+split_shared_memory_t *const split_shmem = &fake_shmem;
+
+FAKE void transaction_register_rpc(int8_t transaction_id, slave_callback_t callback) {}
+FAKE bool transaction_rpc_send(int8_t transaction_id, uint8_t initiator2target_buffer_size, const void *initiator2target_buffer) {
+    return false;
+}
+FAKE bool transaction_rpc_exec(int8_t transaction_id, uint8_t initiator2target_buffer_size, const void *initiator2target_buffer, uint8_t target2initiator_buffer_size, void *target2initiator_buffer) {
+    return false;
+}
+
+uint8_t fake_oled[OLED_DISPLAY_WIDTH * OLED_DISPLAY_HEIGHT / 8];
+
+FAKE void oled_write_raw_byte(const char data, uint16_t index) {
+    if (index < sizeof(fake_oled)) {
+        fake_oled[index] = data;
+    }
+}
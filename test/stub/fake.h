@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "oled_driver.h"
+
+// What the fakes in fake.c saw, for tests to check
+
+#define FAKE_KEYS_MAX 1024
+
+enum { FAKE_TAP, FAKE_PRESS, FAKE_RELEASE };
+
+typedef struct {
+    uint16_t code;
+    uint8_t  action;
+    uint32_t time;
+} fake_key_t;
+
+extern fake_key_t fake_keys[FAKE_KEYS_MAX];
+extern uint16_t   fake_key_count;
+extern uint8_t    fake_mods;
+extern int        fake_prints;
+
+typedef struct {
+    uint8_t mode;
+    uint8_t hue;
+    uint8_t sat;
+    uint8_t val;
+    int     eeprom_writes;
+} fake_rgb_t;
+
+extern fake_rgb_t fake_rgb;
+
+// Last string send_string() was given
+extern char fake_sent[256];
+extern int  fake_sends;
+
+// The kb datablock, with the writes it took
+#define FAKE_EEPROM_SIZE 4096
+extern uint8_t  fake_eeprom[FAKE_EEPROM_SIZE];
+extern bool     fake_eeprom_valid;
+extern int      fake_eeprom_writes;
+extern uint32_t fake_eeprom_largest_write;
+
+extern int fake_clears;
+
+// The OLED buffer, a byte per 8 pixel column of a page
+extern uint8_t fake_oled[OLED_DISPLAY_WIDTH * OLED_DISPLAY_HEIGHT / 8];
@@ -0,0 +1,20 @@
+#pragma once
+
+// Stand-in for the header font_atlas.py generates. Tests fill the arrays
+// and the layout at run time from a generated header, see atlas_load()
+
+#include <stdint.h>
+
+#define FONT_ATLAS_DATA_MAX 4096
+
+#define FONT_ATLAS_FIRST font_atlas_first
+#define FONT_ATLAS_LAST font_atlas_last
+#define FONT_ATLAS_WIDTH font_atlas_width
+#define FONT_ATLAS_GROUP font_atlas_group
+
+static uint8_t  font_atlas_first;
+static uint8_t  font_atlas_last;
+static uint8_t  font_atlas_width;
+static uint8_t  font_atlas_group;
+static uint16_t font_atlas_index[FONT_ATLAS_DATA_MAX];
+static uint8_t  font_atlas_glyphs[FONT_ATLAS_DATA_MAX];
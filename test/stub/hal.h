@@ -0,0 +1,12 @@
+#pragma once
+
+// Stand-in for the ChibiOS PAL calls the keyboard code makes itself
+
+#include "quantum.h"
+
+#define PAL_PORT(pin) IOPORT1
+#define PAL_PAD(pin) (pin)
+#define PAL_MODE_ALTERNATE_UART 2
+
+void          palSetPadMode(uint32_t port, uint8_t pad, uint32_t mode);
+unsigned long palReadPad(uint32_t port, uint8_t pad);
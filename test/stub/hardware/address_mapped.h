@@ -0,0 +1,20 @@
+#pragma once
+
+// Stand-in for the pico-sdk register access the keyboard code uses, over
+// plain memory
+
+#include <stdint.h>
+
+typedef volatile uint32_t io_rw_32;
+
+static inline void hw_set_bits(io_rw_32 *addr, uint32_t mask) {
+    *addr |= mask;
+}
+
+static inline void hw_clear_bits(io_rw_32 *addr, uint32_t mask) {
+    *addr &= ~mask;
+}
+
+static inline void hw_write_masked(io_rw_32 *addr, uint32_t values, uint32_t write_mask) {
+    *addr = (*addr & ~write_mask) | (values & write_mask);
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+// Stand-in for pico-sdk hardware/clocks.h. The registers are plain memory
+// and clock_configure is left to the test.
+
+#include <stdbool.h>
+#include "hardware/address_mapped.h"
+
+enum clock_index { clk_gpout0, clk_gpout1, clk_gpout2, clk_gpout3, clk_ref, clk_sys, clk_peri, clk_usb, clk_adc, clk_rtc, CLK_COUNT };
+
+typedef struct {
+    io_rw_32 ctrl;
+    io_rw_32 div;
+    io_rw_32 selected;
+} clock_hw_t;
+
+typedef struct {
+    clock_hw_t clk[CLK_COUNT];
+} clocks_hw_t;
+
+extern clocks_hw_t fake_clocks;
+#define clocks_hw (&fake_clocks)
+
+#define CLOCKS_CLK_SYS_CTRL_SRC_VALUE_CLKSRC_CLK_SYS_AUX 0x1
+#define CLOCKS_CLK_SYS_CTRL_AUXSRC_VALUE_CLKSRC_PLL_SYS 0x0
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_LSB 5
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_BITS 0x000000e0
+#define CLOCKS_CLK_PERI_CTRL_AUXSRC_VALUE_CLK_SYS 0x0
+
+bool     clock_configure(enum clock_index clk_index, uint32_t src, uint32_t auxsrc, uint32_t src_freq, uint32_t freq);
+uint32_t clock_get_hz(enum clock_index clk_index);
@@ -0,0 +1,61 @@
+#pragma once
+
+// Stand-in for pico-sdk hardware/pio.h. The state machine config is kept
+// in a struct, the calls that touch a state machine are left to the test.
+
+#include <stdbool.h>
+#include "hardware/pio_instructions.h"
+#include "hardware/structs/pio.h"
+
+typedef pio_hw_t *PIO;
+#define pio0 pio0_hw
+#define pio1 pio1_hw
+
+typedef struct {
+    const uint16_t *instructions;
+    uint8_t         length;
+    int8_t          origin;
+} pio_program_t;
+
+typedef struct {
+    uint8_t  wrap_target;
+    uint8_t  wrap;
+    uint8_t  in_base;
+    uint8_t  jmp_pin;
+    bool     in_shift_right;
+    bool     out_shift_right;
+    uint16_t clkdiv_int;
+} pio_sm_config;
+
+static inline pio_sm_config pio_get_default_sm_config(void) {
+    return (pio_sm_config){.wrap = 31, .in_shift_right = true, .out_shift_right = true, .clkdiv_int = 1};
+}
+static inline void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap) {
+    c->wrap_target = wrap_target;
+    c->wrap        = wrap;
+}
+static inline void sm_config_set_in_pins(pio_sm_config *c, uint in_base) {
+    c->in_base = in_base;
+}
+static inline void sm_config_set_jmp_pin(pio_sm_config *c, uint pin) {
+    c->jmp_pin = pin;
+}
+static inline void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold) {
+    c->in_shift_right = shift_right;
+}
+static inline void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold) {
+    c->out_shift_right = shift_right;
+}
+static inline void sm_config_set_clkdiv_int_frac(pio_sm_config *c, uint16_t div_int, uint8_t div_frac) {
+    c->clkdiv_int = div_int;
+}
+
+bool     pio_can_add_program(PIO pio, const pio_program_t *program);
+uint     pio_add_program(PIO pio, const pio_program_t *program);
+int      pio_claim_unused_sm(PIO pio, bool required);
+void     pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config);
+void     pio_sm_exec(PIO pio, uint sm, uint instr);
+void     pio_sm_set_enabled(PIO pio, uint sm, bool enabled);
+void     pio_sm_put(PIO pio, uint sm, uint32_t data);
+bool     pio_sm_is_rx_fifo_empty(PIO pio, uint sm);
+uint32_t pio_sm_get(PIO pio, uint sm);
@@ -0,0 +1,55 @@
+#pragma once
+
+// Stand-in for pico-sdk hardware/pio_instructions.h, with its encodings
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+// Field values, the source and destination of one operand share a number
+enum pio_src_dest {
+    pio_pins    = 0,
+    pio_x       = 1,
+    pio_y       = 2,
+    pio_null    = 3,
+    pio_pindirs = 4,
+    pio_pc      = 5,
+    pio_status  = 5,
+    pio_isr     = 6,
+    pio_osr     = 7,
+};
+
+static inline uint pio_encode_instr(uint bits, uint arg1, uint arg2) {
+    return bits | arg1 << 5 | (arg2 & 0x1f);
+}
+static inline uint pio_encode_jmp(uint addr) {
+    return pio_encode_instr(0x0000, 0, addr);
+}
+static inline uint pio_encode_jmp_y_dec(uint addr) {
+    return pio_encode_instr(0x0000, 4, addr);
+}
+static inline uint pio_encode_jmp_pin(uint addr) {
+    return pio_encode_instr(0x0000, 6, addr);
+}
+static inline uint pio_encode_in(enum pio_src_dest src, uint count) {
+    return pio_encode_instr(0x4000, src, count);
+}
+static inline uint pio_encode_out(enum pio_src_dest dest, uint count) {
+    return pio_encode_instr(0x6000, dest, count);
+}
+static inline uint pio_encode_push(bool if_full, bool block) {
+    return pio_encode_instr(0x8000, (if_full ? 2 : 0) | (block ? 1 : 0), 0);
+}
+static inline uint pio_encode_pull(bool if_empty, bool block) {
+    return pio_encode_instr(0x8080, (if_empty ? 2 : 0) | (block ? 1 : 0), 0);
+}
+static inline uint pio_encode_mov(enum pio_src_dest dest, enum pio_src_dest src) {
+    return pio_encode_instr(0xa000, dest, src);
+}
+static inline uint pio_encode_mov_not(enum pio_src_dest dest, enum pio_src_dest src) {
+    return pio_encode_instr(0xa000, dest, 1 << 3 | src);
+}
+static inline uint pio_encode_set(enum pio_src_dest dest, uint value) {
+    return pio_encode_instr(0xe000, dest, value);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+// Stand-in for pico-sdk hardware/structs/i2c.h, both blocks in plain memory
+
+#include "hardware/address_mapped.h"
+
+#define I2C_IC_ENABLE_ENABLE_BITS 0x00000001
+#define I2C_IC_SDA_HOLD_IC_SDA_TX_HOLD_BITS 0x0000ffff
+
+typedef struct {
+    io_rw_32 ss_scl_hcnt;
+    io_rw_32 ss_scl_lcnt;
+    io_rw_32 fs_scl_hcnt;
+    io_rw_32 fs_scl_lcnt;
+    io_rw_32 enable;
+    io_rw_32 sda_hold;
+    io_rw_32 fs_spklen;
+} i2c_hw_t;
+
+extern i2c_hw_t fake_i2c[2];
+#define i2c0_hw (&fake_i2c[0])
+#define i2c1_hw (&fake_i2c[1])
@@ -0,0 +1,29 @@
+#pragma once
+
+// Stand-in for pico-sdk hardware/structs/pio.h, both blocks in plain memory
+
+#include "hardware/address_mapped.h"
+
+#define NUM_PIO_STATE_MACHINES 4
+
+#define PIO_CTRL_SM_ENABLE_LSB 0
+#define PIO_CTRL_SM_ENABLE_BITS 0x0000000f
+#define PIO_SM0_CLKDIV_FRAC_LSB 8
+
+typedef struct {
+    io_rw_32 clkdiv;
+    io_rw_32 execctrl;
+    io_rw_32 shiftctrl;
+    io_rw_32 addr;
+    io_rw_32 instr;
+    io_rw_32 pinctrl;
+} pio_sm_hw_t;
+
+typedef struct {
+    io_rw_32    ctrl;
+    pio_sm_hw_t sm[NUM_PIO_STATE_MACHINES];
+} pio_hw_t;
+
+extern pio_hw_t fake_pio[2];
+#define pio0_hw (&fake_pio[0])
+#define pio1_hw (&fake_pio[1])
@@ -0,0 +1,19 @@
+#pragma once
+
+// Stand-in for pico-sdk hardware/structs/uart.h, both UARTs in plain memory
+
+#include "hardware/address_mapped.h"
+
+#define UART_UARTCR_UARTEN_BITS 0x00000001
+
+typedef struct {
+    io_rw_32 dr;
+    io_rw_32 ibrd;
+    io_rw_32 fbrd;
+    io_rw_32 lcr_h;
+    io_rw_32 cr;
+} uart_hw_t;
+
+extern uart_hw_t fake_uart[2];
+#define uart0_hw (&fake_uart[0])
+#define uart1_hw (&fake_uart[1])
@@ -0,0 +1,17 @@
+#pragma once
+
+// Stand-in for pico-sdk hardware/structs/vreg_and_chip_reset.h
+
+#include "hardware/address_mapped.h"
+
+#define VREG_AND_CHIP_RESET_VREG_VSEL_LSB 4
+#define VREG_AND_CHIP_RESET_VREG_VSEL_BITS 0x000000f0
+
+typedef struct {
+    io_rw_32 vreg;
+    io_rw_32 bod;
+    io_rw_32 chip_reset;
+} vreg_and_chip_reset_hw_t;
+
+extern vreg_and_chip_reset_hw_t fake_vreg;
+#define vreg_and_chip_reset_hw (&fake_vreg)
@@ -0,0 +1,7 @@
+#pragma once
+
+// Stand-in for pico-sdk hardware/timer.h, the test keeps the time
+
+#include <stdint.h>
+
+uint32_t time_us_32(void);
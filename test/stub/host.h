@@ -0,0 +1,27 @@
+#pragma once
+
+// Stand-in for host.h, the driver reports go out through
+
+#include <stdint.h>
+
+typedef struct {
+    uint8_t mods;
+    uint8_t reserved;
+    uint8_t keys[6];
+} report_keyboard_t;
+
+typedef struct {
+    uint8_t  report_id;
+    uint16_t usage;
+} report_extra_t;
+
+typedef struct {
+    uint8_t (*keyboard_leds)(void);
+    void (*send_keyboard)(report_keyboard_t *);
+    void (*send_nkro)(void *);
+    void (*send_mouse)(void *);
+    void (*send_extra)(report_extra_t *);
+} host_driver_t;
+
+host_driver_t *host_get_driver(void);
+void           host_set_driver(host_driver_t *driver);
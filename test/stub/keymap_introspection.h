@@ -0,0 +1,7 @@
+#pragma once
+
+// Stand-in for keymap_introspection.h, tests provide the keymap
+
+#include "quantum.h"
+
+uint16_t keycode_at_keymap_location(uint8_t layer_num, uint8_t row, uint8_t column);
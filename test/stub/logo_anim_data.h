@@ -0,0 +1,16 @@
+#pragma once
+
+// Stand-in for the header logo_anim.py generates. Tests fill the arrays
+// and the frame count at run time from a generated header, see anim_load()
+
+#include <stdint.h>
+
+#define LOGO_ANIM_DATA_MAX 8192
+
+#define LOGO_ANIM_WIDTH 128
+#define LOGO_ANIM_HEIGHT 32
+#define LOGO_ANIM_FRAMES logo_anim_frames
+
+static uint8_t  logo_anim_frames;
+static uint16_t logo_anim_offsets[256];
+static uint8_t  logo_anim_data[LOGO_ANIM_DATA_MAX];
@@ -0,0 +1,8 @@
+#pragma once
+
+// Stand-in for matrix.h, the hooks of a custom matrix
+
+#include "quantum.h"
+
+void matrix_init_custom(void);
+bool matrix_scan_custom(matrix_row_t current_matrix[]);
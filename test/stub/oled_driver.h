@@ -0,0 +1,14 @@
+#pragma once
+
+// Stand-in for oled_driver.h, the buffer is fake_oled in fake.c
+
+#include <stdint.h>
+
+#ifndef OLED_DISPLAY_WIDTH
+#    define OLED_DISPLAY_WIDTH 128
+#endif
+#ifndef OLED_DISPLAY_HEIGHT
+#    define OLED_DISPLAY_HEIGHT 32
+#endif
+
+void oled_write_raw_byte(const char data, uint16_t index);
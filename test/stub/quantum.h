@@ -0,0 +1,269 @@
+#pragma once
+
+// Stand-in for the parts of QMK's quantum.h the keyboard code uses. Types
+// and keycodes follow QMK, functions are faked in fake.c and record what
+// the code under test did.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef MATRIX_ROWS
+#    define MATRIX_ROWS 8
+#endif
+#ifndef MATRIX_COLS
+#    define MATRIX_COLS 7
+#endif
+#ifndef NUM_ENCODERS
+#    define NUM_ENCODERS 2
+#endif
+
+#include "progmem.h"
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+
+// timer.h
+#define TIMER_DIFF_16(a, b) ((uint16_t)((a) - (b)))
+#define TIMER_DIFF_32(a, b) ((uint32_t)((a) - (b)))
+extern uint32_t test_now;
+uint16_t        timer_read(void);
+uint32_t        timer_read32(void);
+uint16_t        timer_elapsed(uint16_t last);
+uint32_t        timer_elapsed32(uint32_t last);
+
+// ChibiOS system timer, ticking in microseconds as on the RP2040
+typedef uint32_t systime_t;
+typedef uint32_t sysinterval_t;
+systime_t        chVTGetSystemTimeX(void);
+#define chTimeDiffX(start, end) ((sysinterval_t)((end) - (start)))
+#define TIME_I2US(interval) (interval)
+#define chVTTimeElapsedSinceX(start) chTimeDiffX((start), chVTGetSystemTimeX())
+
+// RP2040 HAL peripheral resets
+#define RESETS_ALLREG_PIO0 (1u << 10)
+#define RESETS_ALLREG_PIO1 (1u << 11)
+void hal_lld_peripheral_unreset(uint32_t mask);
+
+// keyboard.h, action.h
+typedef uint32_t matrix_row_t;
+typedef uint32_t layer_state_t;
+typedef uint8_t  pin_t;
+
+uint32_t last_matrix_activity_elapsed(void);
+uint32_t last_input_activity_elapsed(void);
+bool     is_keyboard_master(void);
+bool     is_keyboard_left(void);
+
+// gpio.h and the ChibiOS port read, the test defines the board
+#define IOPORT1 0
+uint32_t palReadPort(uint32_t port);
+void     setPinInputHigh(pin_t pin);
+void     setPinOutput(pin_t pin);
+void     writePinLow(pin_t pin);
+void     waitInputPinDelay(void);
+void     gpio_set_pin_input_high(pin_t pin);
+uint8_t  gpio_read_pin(pin_t pin);
+
+// split_util.h
+bool is_transport_connected(void);
+
+typedef struct {
+    uint8_t col;
+    uint8_t row;
+} keypos_t;
+
+typedef enum { TICK_EVENT, KEY_EVENT, ENCODER_CW_EVENT, ENCODER_CCW_EVENT, COMBO_EVENT, DIP_SWITCH_ON_EVENT, DIP_SWITCH_OFF_EVENT } keyevent_type_t;
+
+typedef struct {
+    keypos_t key;
+    uint16_t time;
+    uint8_t  type;
+    bool     pressed;
+} keyevent_t;
+
+typedef struct {
+    bool    interrupted : 1;
+    bool    reserved2 : 1;
+    bool    reserved1 : 1;
+    bool    reserved0 : 1;
+    uint8_t count : 4;
+} tap_t;
+
+typedef struct {
+    keyevent_t event;
+    tap_t      tap;
+    uint16_t   keycode;
+} keyrecord_t;
+
+#define KEYLOC_COMBO 254
+#define MAKE_KEYPOS(row_num, col_num) ((keypos_t){.row = (row_num), .col = (col_num)})
+
+void action_exec(keyevent_t event);
+void action_tapping_process(keyrecord_t record);
+void process_record(keyrecord_t *record);
+
+// keyboard.h, quantum.h hooks
+void keyboard_post_init_user(void);
+void housekeeping_task_user(void);
+bool pre_process_record_user(uint16_t keycode, keyrecord_t *record);
+bool process_record_user(uint16_t keycode, keyrecord_t *record);
+
+// action_layer.h, keymap.h
+extern layer_state_t layer_state;
+extern layer_state_t default_layer_state;
+uint8_t              layer_switch_get_layer(keypos_t key);
+uint16_t             keymap_key_to_keycode(uint8_t layer, keypos_t key);
+#define get_highest_layer(state) ((state) ? 31 - __builtin_clz(state) : 0)
+
+// process_combo.h
+#ifndef COMBO_TERM
+#    define COMBO_TERM 50
+#endif
+typedef struct {
+    const uint16_t *keys;
+    uint16_t        keycode;
+} combo_t;
+
+#define IS_KEYEVENT(e) ((e).type == KEY_EVENT)
+#define IS_ENCODEREVENT(e) ((e).type == ENCODER_CW_EVENT || (e).type == ENCODER_CCW_EVENT)
+
+// keycodes.h, values as in QMK
+enum {
+    KC_NO                           = 0x0000,
+    KC_TRNS                         = 0x0001,
+    KC_A                            = 0x0004,
+    KC_B,
+    KC_C,
+    KC_D,
+    KC_E,
+    KC_F,
+    KC_G,
+    KC_H,
+    KC_I,
+    KC_J,
+    KC_K,
+    KC_L,
+    KC_M,
+    KC_N,
+    KC_O,
+    KC_P,
+    KC_Q,
+    KC_R,
+    KC_S,
+    KC_T,
+    KC_U,
+    KC_V,
+    KC_W,
+    KC_X,
+    KC_Y,
+    KC_Z,
+    KC_1                            = 0x001E,
+    KC_0                            = 0x0027,
+    KC_ENT                          = 0x0028,
+    KC_ESC                          = 0x0029,
+    KC_BSPC                         = 0x002A,
+    KC_TAB                          = 0x002B,
+    KC_SPC                          = 0x002C,
+    KC_VOLU                         = 0x0080,
+    KC_VOLD                         = 0x0081,
+    KC_LCTL                         = 0x00E0,
+    KC_LSFT                         = 0x00E1,
+    KC_LALT                         = 0x00E2,
+    KC_LGUI                         = 0x00E3,
+    KC_RCTL                         = 0x00E4,
+    KC_RSFT                         = 0x00E5,
+    KC_RALT                         = 0x00E6,
+    KC_RGUI                         = 0x00E7,
+    QK_MODS                         = 0x0100,
+    QK_MOD_TAP                      = 0x2000,
+    QK_LAYER_TAP                    = 0x4000,
+    QK_LAYER_TAP_MAX                = 0x4FFF,
+    QK_MACRO                        = 0x7700,
+    QK_MACRO_MAX                    = 0x777F,
+    QK_DYNAMIC_MACRO_RECORD_START_1 = 0x7C53,
+    QK_DYNAMIC_MACRO_RECORD_START_2,
+    QK_DYNAMIC_MACRO_RECORD_STOP,
+    QK_DYNAMIC_MACRO_PLAY_1,
+    QK_DYNAMIC_MACRO_PLAY_2,
+    QK_LEADER                       = 0x7C58,
+    QK_COMBO_ON                     = 0x7C50,
+    QK_COMBO_OFF,
+    QK_COMBO_TOGGLE,
+    RGB_TOG                         = 0x7820,
+    RGB_MOD,
+    RGB_RMOD,
+    RGB_HUI,
+    RGB_HUD,
+    RGB_SAI,
+    RGB_SAD,
+    RGB_VAI,
+    RGB_VAD,
+    QK_KB_0                         = 0x7E00,
+    QK_USER_0                       = 0x7E40,
+};
+
+#define KC_LEFT_SHIFT KC_LSFT
+#define KC_RIGHT_ALT KC_RALT
+#define LSFT(kc) (0x0200 | (kc))
+#define MT(mod, kc) (QK_MOD_TAP | ((mod) << 8) | (kc))
+#define LT(layer, kc) (QK_LAYER_TAP | ((layer) << 8) | (kc))
+#define MOD_LCTL 0x01
+#define MOD_LSFT 0x02
+#define MOD_LALT 0x04
+#define MOD_LGUI 0x08
+
+#define IS_QK_BASIC(k) ((k) <= 0x00FF)
+#define IS_BASIC_KEYCODE(k) ((k) >= KC_A && (k) <= 0x00A4)
+#define IS_MODIFIER_KEYCODE(k) ((k) >= KC_LCTL && (k) <= KC_RGUI)
+#define IS_QK_MODS(k) ((k) >= QK_MODS && (k) <= 0x1FFF)
+#define IS_QK_MOD_TAP(k) ((k) >= QK_MOD_TAP && (k) <= 0x3FFF)
+#define IS_QK_LAYER_TAP(k) ((k) >= QK_LAYER_TAP && (k) <= QK_LAYER_TAP_MAX)
+#define QK_MOD_TAP_GET_TAP_KEYCODE(k) ((k) & 0xFF)
+#define QK_LAYER_TAP_GET_TAP_KEYCODE(k) ((k) & 0xFF)
+
+// action_util.h, modifiers
+#define MOD_BIT(k) (1 << ((k) & 7))
+#define MOD_MASK_SHIFT (MOD_BIT(KC_LSFT) | MOD_BIT(KC_RSFT))
+uint8_t get_mods(void);
+void    set_mods(uint8_t mods);
+void    clear_mods(void);
+uint8_t get_oneshot_mods(void);
+void    set_weak_mods(uint8_t mods);
+void    clear_weak_mods(void);
+
+// report.h, keymap_config
+void add_key(uint8_t key);
+void del_key(uint8_t key);
+void send_keyboard_report(void);
+void clear_keyboard(void);
+typedef struct {
+    bool nkro;
+} keymap_config_t;
+extern keymap_config_t keymap_config;
+
+// Key output, logged by fake.c
+void tap_code(uint8_t code);
+void tap_code16(uint16_t code);
+void register_code(uint8_t code);
+void unregister_code(uint8_t code);
+void register_code16(uint16_t code);
+void unregister_code16(uint16_t code);
+
+// Console. stdio.h first, its dprintf is replaced below
+#include <stdio.h>
+int xprintf(const char *fmt, ...);
+#define dprintf xprintf
+#define uprintf xprintf
+
+void wait_us(uint16_t us);
+void wait_ms(uint16_t ms);
+
+// matrix.h
+matrix_row_t matrix_get_row(uint8_t row);
+
+#include "rgb_matrix.h"
+#include "oled_driver.h"
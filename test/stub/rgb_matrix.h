@@ -0,0 +1,56 @@
+#pragma once
+
+// Stand-in for rgb_matrix.h and the color helpers it pulls in
+
+#include "quantum.h"
+
+#ifndef RGB_MATRIX_LED_COUNT
+#    define RGB_MATRIX_LED_COUNT 46
+#endif
+#define NO_LED 255
+#define RGB_OFF 0x00, 0x00, 0x00
+
+#define RGB_MATRIX_EFFECT_MAX 44
+#define RGB_MATRIX_HUE_STEP 8
+#define RGB_MATRIX_SAT_STEP 16
+#define RGB_MATRIX_VAL_STEP 16
+#define RGB_MATRIX_MAXIMUM_BRIGHTNESS 200
+uint8_t rgb_matrix_get_mode(void);
+uint8_t rgb_matrix_get_hue(void);
+uint8_t rgb_matrix_get_sat(void);
+uint8_t rgb_matrix_get_val(void);
+void    rgb_matrix_mode(uint8_t mode);
+void    rgb_matrix_mode_noeeprom(uint8_t mode);
+void    rgb_matrix_sethsv(uint8_t hue, uint8_t sat, uint8_t val);
+void    rgb_matrix_sethsv_noeeprom(uint8_t hue, uint8_t sat, uint8_t val);
+void    eeconfig_update_rgb_matrix(void);
+
+typedef struct {
+    uint8_t h;
+    uint8_t s;
+    uint8_t v;
+} HSV;
+
+typedef struct {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} RGB;
+
+typedef struct {
+    uint8_t matrix_co[MATRIX_ROWS][MATRIX_COLS];
+} led_config_t;
+
+extern led_config_t g_led_config;
+
+RGB  hsv_to_rgb(HSV hsv);
+void rgb_matrix_set_color(int index, uint8_t red, uint8_t green, uint8_t blue);
+
+static inline uint8_t qadd8(uint8_t i, uint8_t j) {
+    unsigned sum = i + j;
+    return sum > UINT8_MAX ? UINT8_MAX : sum;
+}
+
+static inline uint8_t scale8(uint8_t i, uint8_t scale) {
+    return (i * (1 + scale)) >> 8;
+}
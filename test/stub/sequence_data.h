@@ -0,0 +1,11 @@
+#pragma once
+
+// Stand-in for the header sequence_trie.py generates. Tests fill the
+// arrays at run time from a generated header, see sequence_load()
+
+#include <stdint.h>
+
+#define SEQUENCE_DATA_MAX 65536
+
+static uint8_t sequence_trie[SEQUENCE_DATA_MAX];
+static char    sequence_outputs[SEQUENCE_DATA_MAX];
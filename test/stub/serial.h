@@ -0,0 +1,6 @@
+#pragma once
+
+// Stand-in for the split serial driver
+#include <stdbool.h>
+
+bool soft_serial_transaction(int sstd_index);
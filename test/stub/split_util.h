@@ -0,0 +1,4 @@
+#pragma once
+
+// Stand-in for split_util.h, declared with the rest in quantum.h
+#include "quantum.h"
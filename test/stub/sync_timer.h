@@ -0,0 +1,6 @@
+#pragma once
+
+// Stand-in for sync_timer.h, the timer the core keeps in step on both halves
+#include <stdint.h>
+
+uint32_t sync_timer_read32(void);
@@ -0,0 +1,27 @@
+#pragma once
+
+// Stand-in for transactions.h. The kb transaction ids are the ones the
+// keyboard config.h lists.
+
+#include "quantum.h"
+
+#define ROWS_PER_HAND (MATRIX_ROWS / 2)
+
+#ifndef RPC_M2S_BUFFER_SIZE
+#    define RPC_M2S_BUFFER_SIZE 32
+#endif
+#ifndef RPC_S2M_BUFFER_SIZE
+#    define RPC_S2M_BUFFER_SIZE 32
+#endif
+
+enum { RPC_ID_KB_SPLIT_SCHED, RPC_ID_KB_DEBOUNCE, RPC_ID_KB_HEATMAP, RPC_ID_KB_RGB_DRIFT, RPC_ID_KB_COUNT };
+
+typedef void (*slave_callback_t)(uint8_t initiator2target_buffer_size, const void *initiator2target_buffer, uint8_t target2initiator_buffer_size, void *target2initiator_buffer);
+
+void transaction_register_rpc(int8_t transaction_id, slave_callback_t callback);
+bool transaction_rpc_send(int8_t transaction_id, uint8_t initiator2target_buffer_size, const void *initiator2target_buffer);
+bool transaction_rpc_exec(int8_t transaction_id, uint8_t initiator2target_buffer_size, const void *initiator2target_buffer, uint8_t target2initiator_buffer_size, void *target2initiator_buffer);
+
+
+// The core transactions the keyboard code runs itself
+enum { GET_SLAVE_MATRIX_CHECKSUM = 1, GET_SLAVE_MATRIX_DATA };
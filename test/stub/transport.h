@@ -0,0 +1,16 @@
+#pragma once
+
+// Stand-in for the split transport's shared memory, the buffers the core
+// transactions go through
+#include <stdint.h>
+
+typedef struct {
+    uint8_t  matrix_checksum;
+    uint8_t  matrix[4];
+    uint32_t layer_state;
+    uint32_t default_layer_state;
+    uint8_t  led_state;
+    uint8_t  mods[4];
+} split_shared_memory_t;
+
+extern split_shared_memory_t *const split_shmem;
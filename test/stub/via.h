@@ -0,0 +1,12 @@
+#pragma once
+
+// Stand-in for via.h: the command and channel ids, values as in VIA
+
+enum {
+    id_custom_set_value = 0x07,
+    id_custom_get_value = 0x08,
+    id_custom_save      = 0x09,
+    id_unhandled        = 0xFF,
+};
+
+enum { id_custom_channel = 0 };
@@ -0,0 +1,17 @@
+#pragma once
+
+// Stand-in for vial.h: the combo entry and the command ids
+
+#include <stdint.h>
+
+#ifndef VIAL_COMBO_ENTRIES
+#    define VIAL_COMBO_ENTRIES 16
+#endif
+
+typedef struct {
+    uint16_t input[4];
+    uint16_t output;
+} vial_combo_entry_t;
+
+enum { vial_dynamic_entry_op = 0x0D };
+enum { dynamic_vial_combo_set = 0x04 };
@@ -0,0 +1,8 @@
+#pragma once
+
+// Stand-in for virtser.h, the test defines both ends of the port
+
+#include <stdint.h>
+
+void virtser_send(const uint8_t byte);
+void virtser_recv(const uint8_t ch);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdio.h>
+
+// Checks count failures and go on, so one run lists all of them
+#define CHECK(cond) test_check((cond), #cond, __FILE__, __LINE__)
+#define CHECK_EQ(a, b)                                                                                           \
+    do {                                                                                                         \
+        long long check_a = (long long)(a), check_b = (long long)(b);                                            \
+        if (!test_check(check_a == check_b, #a " == " #b, __FILE__, __LINE__)) {                                 \
+            fprintf(stderr, "    %lld != %lld\n", check_a, check_b);                                             \
+        }                                                                                                        \
+    } while (0)
+
+bool test_check(bool ok, const char *what, const char *file, int line);
+int  test_report(const char *name);
+
+// Host time of a hot path of the firmware, printed as "bench <name> <ns>"
+// when TEST_BENCH is set in the environment, for footprint.py to collect
+void test_bench(const char *name, double ns);